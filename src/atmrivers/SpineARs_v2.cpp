@@ -19,6 +19,9 @@
 #include "Exception.h"
 #include "Announce.h"
 #include "SimpleGrid.h"
+#include "GraphSearchWorkspace.h"
+#include "AsyncVariableReader.h"
+#include "MPIFileScheduler.h"
 
 #include "DataVector.h"
 #include "DataMatrix.h"
@@ -28,6 +31,7 @@
 
 #include <set>
 #include <queue>
+#include <algorithm>
 
 #if defined(TEMPEST_MPIOMP)
 #include <mpi.h>
@@ -248,48 +252,19 @@ bool SatisfiesThreshold(
 		_EXCEPTIONT("MaxDist must be less than 180.0");
 	}
 
-	// Queue of nodes that remain to be visited
-	std::queue<int> queueNodes;
-	queueNodes.push(ix0);
+	// Nodes that remain to be visited
+	GraphSearchWorkspace & ws = GraphSearchWorkspace::GetForThread();
+	ws.Begin(grid.GetSize(), ix0);
 
-	// Set of nodes that have already been visited
-	std::set<int> setNodesVisited;
-
-	// Latitude and longitude at the origin
-	double dLat0 = grid.m_dLat[ix0];
-	double dLon0 = grid.m_dLon[ix0];
+	// Distance threshold
+	const SimpleGrid::DistanceThreshold distMax(dMaxDist);
 
 	// Loop through all latlon elements
-	while (queueNodes.size() != 0) {
-		int ix = queueNodes.front();
-		queueNodes.pop();
-
-		if (setNodesVisited.find(ix) != setNodesVisited.end()) {
-			continue;
-		}
-
-		setNodesVisited.insert(ix);
-
-		// Great circle distance to this element
-		double dLatThis = grid.m_dLat[ix];
-		double dLonThis = grid.m_dLon[ix];
-
-		double dR =
-			sin(dLat0) * sin(dLatThis)
-			+ cos(dLat0) * cos(dLatThis) * cos(dLonThis - dLon0);
+	while (!ws.Empty()) {
+		int ix = ws.Pop();
 
-		if (dR >= 1.0) {
-			dR = 0.0;
-		} else if (dR <= -1.0) {
-			dR = 180.0;
-		} else {
-			dR = 180.0 / M_PI * acos(dR);
-		}
-		if (dR != dR) {
-			_EXCEPTIONT("NaN value detected");
-		}
-
-		if ((ix != ix0) && (dR > dMaxDist)) {
+		// Distance to this element
+		if ((ix != ix0) && !grid.IsWithinDistance(ix0, ix, distMax)) {
 			continue;
 		}
 
@@ -337,8 +312,10 @@ bool SatisfiesThreshold(
 		}
 
 		// Add all neighbors of this point
-		for (int n = 0; n < grid.m_vecConnectivity[ix].size(); n++) {
-			queueNodes.push(grid.m_vecConnectivity[ix][n]);
+		const SimpleGrid::NeighborRange neighbors =
+			grid.GetNeighbors(ix);
+		for (int n = 0; n < neighbors.size(); n++) {
+			ws.Visit(neighbors[n]);
 		}
 	}
 
@@ -425,11 +402,12 @@ public:
 ///////////////////////////////////////////////////////////////////////////////
 
 ///	<summary>
-///		Parse the list of input files.
+///		Parse the list of input files.  Files are opened when they are
+///		first accessed.
 ///	</summary>
 void ParseInputFiles(
 	const std::string & strInputFile,
-	std::vector<NcFile *> & vecFiles
+	NcFileVector & vecFiles
 ) {
 	int iLast = 0;
 	for (int i = 0; i <= strInputFile.length(); i++) {
@@ -439,14 +417,7 @@ void ParseInputFiles(
 			std::string strFile =
 				strInputFile.substr(iLast, i - iLast);
 
-			NcFile * pNewFile = new NcFile(strFile.c_str());
-
-			if (!pNewFile->is_valid()) {
-				_EXCEPTION1("Cannot open input file \"%s\"",
-					strFile.c_str());
-			}
-
-			vecFiles.push_back(pNewFile);
+			vecFiles.AddFile(strFile);
 			iLast = i+1;
 		}
 	}
@@ -472,6 +443,7 @@ public:
 		dMinLaplacian(0.0),
 		dMinAbsLat(0.0),
 		fRegional(false),
+		nReadThreadDepth(0),
 		iVerbosityLevel(0),
 		pvecThresholdOp(NULL),
 		pvecOutputOp(NULL)
@@ -496,6 +468,9 @@ public:
 	// Regional (do not wrap longitudinal boundaries)
 	bool fRegional;
 
+	// Number of time slices read ahead in a background thread
+	int nReadThreadDepth;
+
 	// Verbosity level
 	int iVerbosityLevel;
 
@@ -742,6 +717,25 @@ void SpineARs(
 	// Tagged cell array
 	DataVector<int> bIWVtag(grid.GetSize());
 
+	// Read input data in a background thread
+	AsyncVariableReader reader(
+		varreg, vecFiles, grid, std::max(param.nReadThreadDepth, 1));
+
+	if (param.nReadThreadDepth > 0) {
+		for (int tc = 0; tc < vecThresholdOp.size(); tc++) {
+			reader.AddVariable(vecThresholdOp[tc].m_varix);
+		}
+		for (int oc = 0; oc < param.pvecOutputOp->size(); oc++) {
+			reader.AddVariable((*param.pvecOutputOp)[oc].m_varix);
+		}
+
+		std::vector<int> vecTimes;
+		for (int t = 0; t < nTime; t++) {
+			vecTimes.push_back(t);
+		}
+		reader.Start(vecTimes);
+	}
+
 	// Loop through all times
 	for (int t = 0; t < nTime; t ++) {
 
@@ -749,6 +743,11 @@ void SpineARs(
 		char szBuffer[20];
 		sprintf(szBuffer, "Time %i", t);
 		AnnounceStartBlock(szBuffer);
+
+		// Wait for input data from the reader thread
+		if (param.nReadThreadDepth > 0) {
+			reader.WaitForTime(t);
+		}
 /*
 		// Load in data at this time slice
 		AnnounceStartBlock("Reading data");
@@ -852,6 +851,10 @@ void SpineARs(
 
 		// Output tagged cell array
 		AnnounceStartBlock("Writing results");
+
+		// The reader thread may be accessing NetCDF files
+		std::lock_guard<std::recursive_mutex> lock(GetNetCDFMutex());
+
 		if (dimTimeOut != NULL) {
 /*
 			if (varLaplacian != NULL) {
@@ -1020,6 +1023,12 @@ try {
 	// Output file list
 	std::string strOutputCmd;
 
+	// Number of time slices to read at once
+	int nReadAhead;
+
+	// Memory used for time slices read ahead (in MB)
+	int nReadAheadMB;
+
 	// Parse the command line
 	BeginCommandLine()
 		CommandLineString(strInputFile, "in_data", "");
@@ -1040,6 +1049,9 @@ try {
 		//CommandLineString(strAddTimeDimUnits, "addtimedimunits", "");
 		//CommandLineBool(sarparam.fOutputLaplacian, "laplacianout");
 		CommandLineBool(sarparam.fRegional, "regional");
+		CommandLineInt(sarparam.nReadThreadDepth, "readthread_depth", 0);
+		CommandLineInt(nReadAhead, "readahead", 1);
+		CommandLineInt(nReadAheadMB, "readahead_mb", 1024);
 		CommandLineInt(sarparam.iVerbosityLevel, "verbosity", 0);
 
 		ParseCommandLine(argc, argv);
@@ -1050,6 +1062,18 @@ try {
 	// Create Variable registry
 	VariableRegistry varreg;
 
+	// Read ahead multiple time slices
+	if (nReadAhead < 1) {
+		_EXCEPTIONT("--readahead must be at least 1");
+	}
+	if (nReadAheadMB < 0) {
+		_EXCEPTIONT("--readahead_mb must be nonnegative");
+	}
+
+	varreg.SetTimeSlabSize(
+		nReadAhead,
+		static_cast<size_t>(nReadAheadMB) * 1024 * 1024);
+
 	// Set verbosity level
 	AnnounceSetVerbosityLevel(sarparam.iVerbosityLevel);
 
@@ -1175,15 +1199,6 @@ try {
 		AnnounceEndBlock("Done");
 	}
 
-#if defined(TEMPEST_MPIOMP)
-	// Spread files across nodes
-	int nMPIRank;
-	MPI_Comm_rank(MPI_COMM_WORLD, &nMPIRank);
-
-	int nMPISize;
-	MPI_Comm_size(MPI_COMM_WORLD, &nMPISize);
-#endif
-
 	AnnounceStartBlock("Begin search operation");
 	if (vecInputFiles.size() != 1) {
 		if (vecOutputFiles.size() != 0) {
@@ -1197,13 +1212,13 @@ try {
 		Announce("Logs will be written to logXXXXXX.txt");
 	}
 
+	// Distribute files among ranks on demand
+	MPIFileScheduler scheduler(vecInputFiles);
+
 	// Loop over all files to be processed
-	for (int f = 0; f < vecInputFiles.size(); f++) {
-#if defined(TEMPEST_MPIOMP)
-		if (f % nMPISize != nMPIRank) {
-			continue;
-		}
-#endif
+	int f;
+	while (scheduler.Next(f)) {
+
 		// Generate output file name
 		std::string strOutputFile;
 		if (vecInputFiles.size() == 1) {
@@ -1252,10 +1267,29 @@ try {
 
 	AnnounceEndBlock("Done");
 
+	scheduler.Summarize();
+	scheduler.Free();
+
 	AnnounceBanner();
 
 } catch(Exception & e) {
 	Announce(e.ToString().c_str());
+
+#if defined(TEMPEST_MPIOMP)
+	// Other ranks may be waiting for this rank in a collective operation
+	int nMPISize;
+	MPI_Comm_size(MPI_COMM_WORLD, &nMPISize);
+	if (nMPISize > 1) {
+		// Announce may be restricted to rank 0, so report the error
+		// of this rank before aborting
+		int nMPIRank;
+		MPI_Comm_rank(MPI_COMM_WORLD, &nMPIRank);
+		fprintf(stderr, "[rank %i] %s\n", nMPIRank, e.ToString().c_str());
+
+		fflush(NULL);
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	}
+#endif
 }
 
 #if defined(TEMPEST_MPIOMP)
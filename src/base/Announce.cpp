@@ -68,6 +68,13 @@ static int s_nIndentationLevel = 0;
 ///	</summary>
 static bool s_fBlockFlag = false;
 
+///	<summary>
+///		Rank of this process, determined when output is restricted to rank
+///		zero so that announcements do not call MPI (possibly from threads
+///		other than the main thread).
+///	</summary>
+static int s_nRank = 0;
+
 ///////////////////////////////////////////////////////////////////////////////
 
 FILE * AnnounceGetOutputBuffer() {
@@ -88,7 +95,21 @@ void AnnounceSetVerbosityLevel(int iVerbosityLevel) {
 
 ///////////////////////////////////////////////////////////////////////////////
 
+int AnnounceGetVerbosityLevel() {
+	return g_iVerbosityLevel;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
 void AnnounceOnlyOutputOnRankZero() {
+#ifdef TEMPEST_MPIOMP
+	int fInitialized;
+	MPI_Initialized(&fInitialized);
+	if (fInitialized) {
+		MPI_Comm_rank(MPI_COMM_WORLD, &s_nRank);
+	}
+#endif
+
 	g_fOnlyOutputOnRankZero = true;
 }
 
@@ -115,14 +136,8 @@ void AnnounceStartBlock(
 
 #ifdef TEMPEST_MPIOMP
 	// Only output on rank zero
-	if (g_fOnlyOutputOnRankZero) {
-		int nRank;
-
-		MPI_Comm_rank(MPI_COMM_WORLD, &nRank);
-
-		if (nRank > 0) {
-			return;
-		}
+	if (g_fOnlyOutputOnRankZero && (s_nRank > 0)) {
+		return;
 	}
 #endif
 
@@ -180,14 +195,8 @@ void AnnounceEndBlock(const char * szText) {
 
 #ifdef TEMPEST_MPIOMP
 	// Only output on rank zero
-	if (g_fOnlyOutputOnRankZero) {
-		int nRank;
-
-		MPI_Comm_rank(MPI_COMM_WORLD, &nRank);
-
-		if (nRank > 0) {
-			return;
-		}
+	if (g_fOnlyOutputOnRankZero && (s_nRank > 0)) {
+		return;
 	}
 #endif
 
@@ -229,14 +238,8 @@ void Announce(const char * szText, ...) {
 
 #ifdef TEMPEST_MPIOMP
 	// Only output on rank zero
-	if (g_fOnlyOutputOnRankZero) {
-		int nRank;
-
-		MPI_Comm_rank(MPI_COMM_WORLD, &nRank);
-
-		if (nRank > 0) {
-			return;
-		}
+	if (g_fOnlyOutputOnRankZero && (s_nRank > 0)) {
+		return;
 	}
 #endif
 
@@ -284,24 +287,18 @@ void Announce(
 	...
 ) {
 
-#ifdef TEMPEST_MPIOMP
-	// Only output on rank zero
-	if (g_fOnlyOutputOnRankZero) {
-		int nRank;
-
-		MPI_Comm_rank(MPI_COMM_WORLD, &nRank);
-
-		if (nRank > 0) {
-			return;
-		}
-	}
-#endif
-
 	// Check verbosity
 	if (iVerbosity > g_iVerbosityLevel) {
 		return;
 	}
 
+#ifdef TEMPEST_MPIOMP
+	// Only output on rank zero
+	if (g_fOnlyOutputOnRankZero && (s_nRank > 0)) {
+		return;
+	}
+#endif
+
 	// Turn off the block flag
 	if (s_fBlockFlag) {
 		fprintf(g_fpAnnounceOutput, "\n");
@@ -344,14 +341,8 @@ void AnnounceBanner(const char * szText) {
 
 #ifdef TEMPEST_MPIOMP
 	// Only output on rank zero
-	if (g_fOnlyOutputOnRankZero) {
-		int nRank;
-
-		MPI_Comm_rank(MPI_COMM_WORLD, &nRank);
-
-		if (nRank > 0) {
-			return;
-		}
+	if (g_fOnlyOutputOnRankZero && (s_nRank > 0)) {
+		return;
 	}
 #endif
 
@@ -49,7 +49,13 @@ void AnnounceSetOutputBuffer(FILE * fpOutputBuffer);
 void AnnounceSetVerbosityLevel(int iVerbosityLevel);
 
 ///	<summary>
-///		Only output on rank zero.
+///		Get the verbosity level.
+///	</summary>
+int AnnounceGetVerbosityLevel();
+
+///	<summary>
+///		Only output on rank zero.  Must be called on the main thread after
+///		MPI has been initialized.
 ///	</summary>
 void AnnounceOnlyOutputOnRankZero();
 
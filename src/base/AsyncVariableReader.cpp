@@ -0,0 +1,224 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+///	\file    AsyncVariableReader.cpp
+///	\author  Paul Ullrich
+///	\version October 16, 2026
+///
+///	<remarks>
+///		Copyright 2000-2018 Paul Ullrich
+///
+///		This file is distributed as part of the Tempest source code package.
+///		Permission is granted to use, copy, modify and distribute this
+///		source code and its documentation under the terms of the GNU General
+///		Public License.  This software is provided "as is" without express
+///		or implied warranty.
+///	</remarks>
+
+#include "AsyncVariableReader.h"
+#include "Exception.h"
+
+#include <exception>
+
+///////////////////////////////////////////////////////////////////////////////
+
+AsyncVariableReader::AsyncVariableReader(
+	VariableRegistry & varreg,
+	NcFileVector & vecFiles,
+	const SimpleGrid & grid,
+	int nQueueDepth
+) :
+	m_varreg(varreg),
+	m_vecFiles(vecFiles),
+	m_grid(grid),
+	m_nQueueDepth(nQueueDepth),
+	m_fStop(false),
+	m_fError(false)
+{
+	if (nQueueDepth < 1) {
+		_EXCEPTIONT("Queue depth must be at least 1");
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+AsyncVariableReader::~AsyncVariableReader() {
+	Stop();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void AsyncVariableReader::AddVariable(
+	VariableIndex varix
+) {
+	Variable & var = m_varreg.Get(varix);
+
+	// Read all NetCDF variables that are arguments of this operator
+	if (var.m_fOp) {
+		for (int i = 0; i < var.m_varArg.size(); i++) {
+			AddVariable(var.m_varArg[i]);
+		}
+		return;
+	}
+	if (var.IsConstant()) {
+		return;
+	}
+
+	for (int i = 0; i < m_vecVarIx.size(); i++) {
+		if (m_vecVarIx[i] == varix) {
+			return;
+		}
+	}
+	m_vecVarIx.push_back(varix);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void AsyncVariableReader::Start(
+	const std::vector<int> & vecTimes
+) {
+	if (m_thread.joinable()) {
+		_EXCEPTIONT("AsyncVariableReader has already been started");
+	}
+
+	// Variables without a time dimension are only loaded once and are
+	// left to the processing thread
+	m_vecVariables.clear();
+	for (int i = 0; i < m_vecVarIx.size(); i++) {
+		const Variable & var = m_varreg.Get(m_vecVarIx[i]);
+		if (var.m_fNoTimeInNcFile) {
+			continue;
+		}
+		m_vecVariables.push_back(var);
+		m_vecVariables.back().UnloadGridData();
+	}
+
+	m_varregReader.SetTimeSlabSize(
+		m_varreg.GetTimeSlabSize(),
+		m_varreg.GetTimeSlabMemory());
+
+	m_vecTimes = vecTimes;
+	m_queue.clear();
+	m_fStop = false;
+	m_fError = false;
+
+	m_thread = std::thread(&AsyncVariableReader::ReadTimes, this);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void AsyncVariableReader::WaitForTime(
+	int iTime
+) {
+	TimeSliceData data;
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		while ((m_queue.size() == 0) && (!m_fError)) {
+			m_cond.wait(lock);
+		}
+		if (m_queue.size() == 0) {
+			_EXCEPTION1("Error in reader thread:\n%s", m_strError.c_str());
+		}
+		if (m_queue.front().iTime != iTime) {
+			_EXCEPTION2("Time slice %i requested out of order (expected %i)",
+				iTime, m_queue.front().iTime);
+		}
+
+		data.iTime = m_queue.front().iTime;
+		data.vecSlabs.swap(m_queue.front().vecSlabs);
+		m_queue.pop_front();
+	}
+	m_cond.notify_all();
+
+	m_varreg.SetPrefetchedTimeSlabs(data.vecSlabs);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void AsyncVariableReader::Stop() {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_fStop = true;
+	}
+	m_cond.notify_all();
+
+	if (m_thread.joinable()) {
+		m_thread.join();
+	}
+
+	m_queue.clear();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void AsyncVariableReader::ReadTimes() {
+try {
+	for (int t = 0; t < m_vecTimes.size(); t++) {
+
+		// Wait for space in the queue
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			while ((m_queue.size() >= m_nQueueDepth) && (!m_fStop)) {
+				m_cond.wait(lock);
+			}
+			if (m_fStop) {
+				return;
+			}
+		}
+
+		// Read all variables at this time
+		TimeSliceData data;
+		data.iTime = m_vecTimes[t];
+
+		for (int i = 0; i < m_vecVariables.size(); i++) {
+			Variable & var = m_vecVariables[i];
+			var.LoadGridData(m_varregReader, m_vecFiles, m_grid, data.iTime);
+
+			if (var.m_fNoTimeInNcFile) {
+				continue;
+			}
+
+			data.vecSlabs.push_back(VariableTimeSlab());
+
+			VariableTimeSlab & slab = data.vecSlabs.back();
+			slab.m_strKey = var.ToString(m_varregReader);
+			slab.m_iTimeBegin = data.iTime;
+			slab.m_nTimes = 1;
+			slab.m_sSliceSize = m_grid.GetSize();
+			slab.m_data = var.GetData();
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_queue.push_back(TimeSliceData());
+			m_queue.back().iTime = data.iTime;
+			m_queue.back().vecSlabs.swap(data.vecSlabs);
+		}
+		m_cond.notify_all();
+	}
+
+} catch(Exception & e) {
+	SetError(e.ToString());
+
+} catch(std::exception & e) {
+	SetError(e.what());
+
+} catch(...) {
+	SetError("Unknown exception");
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void AsyncVariableReader::SetError(
+	const std::string & strError
+) {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_fError = true;
+		m_strError = strError;
+	}
+	m_cond.notify_all();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
@@ -0,0 +1,203 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+///	\file    AsyncVariableReader.h
+///	\author  Paul Ullrich
+///	\version October 16, 2026
+///
+///	<remarks>
+///		Copyright 2000-2018 Paul Ullrich
+///
+///		This file is distributed as part of the Tempest source code package.
+///		Permission is granted to use, copy, modify and distribute this
+///		source code and its documentation under the terms of the GNU General
+///		Public License.  This software is provided "as is" without express
+///		or implied warranty.
+///	</remarks>
+
+#ifndef _ASYNCVARIABLEREADER_H_
+#define _ASYNCVARIABLEREADER_H_
+
+#include "Variable.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		A background thread that reads the NetCDF variables needed by a
+///		sequence of time slices ahead of the thread that processes them.
+///		Variables are registered by index in the VariableRegistry; for
+///		operators, all NetCDF variables among their arguments are read.
+///		At most a fixed number of time slices are held in memory at once.
+///		Before processing a time slice the processing thread calls
+///		WaitForTime(), which installs that time slice in the registry so
+///		that Variable::LoadGridData() serves it from memory.
+///
+///		Calls into the NetCDF library from the reader thread are guarded
+///		by GetNetCDFMutex(); while the reader is running any other use of
+///		the NetCDF library must hold the same mutex.
+///	</summary>
+class AsyncVariableReader {
+
+public:
+	///	<summary>
+	///		Constructor.
+	///	</summary>
+	///	<param name="nQueueDepth">
+	///		Maximum number of time slices that have been read but not yet
+	///		installed.
+	///	</param>
+	AsyncVariableReader(
+		VariableRegistry & varreg,
+		NcFileVector & vecFiles,
+		const SimpleGrid & grid,
+		int nQueueDepth
+	);
+
+	///	<summary>
+	///		Destructor.  Stops the reader thread.
+	///	</summary>
+	~AsyncVariableReader();
+
+private:
+	///	<summary>
+	///		Copy constructor (not implemented).
+	///	</summary>
+	AsyncVariableReader(const AsyncVariableReader &);
+
+	///	<summary>
+	///		Assignment operator (not implemented).
+	///	</summary>
+	AsyncVariableReader & operator=(const AsyncVariableReader &);
+
+public:
+	///	<summary>
+	///		Add a variable to be read.  Must be called before Start().
+	///	</summary>
+	void AddVariable(VariableIndex varix);
+
+	///	<summary>
+	///		Start reading the given time indices, in order.
+	///	</summary>
+	void Start(const std::vector<int> & vecTimes);
+
+	///	<summary>
+	///		Wait until the given time slice has been read and install it
+	///		in the VariableRegistry.  Time slices must be requested in the
+	///		order given to Start().  Exceptions raised by the reader thread
+	///		are rethrown here.
+	///	</summary>
+	void WaitForTime(int iTime);
+
+	///	<summary>
+	///		Stop the reader thread and discard any time slices that have
+	///		not been installed.
+	///	</summary>
+	void Stop();
+
+protected:
+	///	<summary>
+	///		Main loop of the reader thread.
+	///	</summary>
+	void ReadTimes();
+
+	///	<summary>
+	///		Record an error raised by the reader thread and wake up the
+	///		processing thread.
+	///	</summary>
+	void SetError(const std::string & strError);
+
+protected:
+	///	<summary>
+	///		A time slice that has been read.
+	///	</summary>
+	struct TimeSliceData {
+		int iTime;
+		std::vector<VariableTimeSlab> vecSlabs;
+	};
+
+	///	<summary>
+	///		VariableRegistry in which time slices are installed.
+	///	</summary>
+	VariableRegistry & m_varreg;
+
+	///	<summary>
+	///		Files from which variables are read.
+	///	</summary>
+	NcFileVector & m_vecFiles;
+
+	///	<summary>
+	///		Grid on which variables are defined.
+	///	</summary>
+	const SimpleGrid & m_grid;
+
+	///	<summary>
+	///		Maximum number of time slices in the queue.
+	///	</summary>
+	int m_nQueueDepth;
+
+	///	<summary>
+	///		VariableRegistry used by the reader thread.
+	///	</summary>
+	VariableRegistry m_varregReader;
+
+	///	<summary>
+	///		Indices of the NetCDF variables to read.
+	///	</summary>
+	std::vector<VariableIndex> m_vecVarIx;
+
+	///	<summary>
+	///		Copies of the NetCDF variables used by the reader thread.
+	///	</summary>
+	VariableVector m_vecVariables;
+
+	///	<summary>
+	///		Time indices to read.
+	///	</summary>
+	std::vector<int> m_vecTimes;
+
+	///	<summary>
+	///		Reader thread.
+	///	</summary>
+	std::thread m_thread;
+
+	///	<summary>
+	///		Mutex protecting the queue and flags.
+	///	</summary>
+	std::mutex m_mutex;
+
+	///	<summary>
+	///		Condition variable signaled when the queue changes.
+	///	</summary>
+	std::condition_variable m_cond;
+
+	///	<summary>
+	///		Time slices that have been read.
+	///	</summary>
+	std::deque<TimeSliceData> m_queue;
+
+	///	<summary>
+	///		Flag indicating the reader thread should stop.
+	///	</summary>
+	bool m_fStop;
+
+	///	<summary>
+	///		Flag indicating the reader thread raised an exception.
+	///	</summary>
+	bool m_fError;
+
+	///	<summary>
+	///		Description of the exception raised by the reader thread.
+	///	</summary>
+	std::string m_strError;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+#endif // _ASYNCVARIABLEREADER_H_
+
@@ -16,60 +16,217 @@
 
 #include "AutoCurator.h"
 #include "Exception.h"
+#include "Announce.h"
 #include "DataVector.h"
 #include "Variable.h"
 
 #include "netcdfcpp.h"
 
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <sys/stat.h>
+#include <unistd.h>
+
 ///////////////////////////////////////////////////////////////////////////////
 
-void AutoCurator::InsertTimeToFileTimeIx(
-	const Time & time,
-	const int & iFileIx,
-	const int & iTimeIx
-) {
-	TimeToFileTimeIxMap::iterator iter =
-		m_mapTimeToTimeFileIx.find(time);
+///	<summary>
+///		Magic string identifying an AutoCurator index file.
+///	</summary>
+static const char IndexFileMagic[8] = {'T','E','M','P','A','C','I','X'};
 
-	if (iter == m_mapTimeToTimeFileIx.end()) {
-		iter = m_mapTimeToTimeFileIx.insert(
-			TimeToFileTimeIxMap::value_type(
-				time, FileTimeIxVector())).first;
-	}
+///	<summary>
+///		Version of the AutoCurator index file format.  Increment when the
+///		format or the decoding of time axes changes.
+///	</summary>
+static const int32_t IndexFileVersion = 1;
+
+///	<summary>
+///		Number of fields stored for each time in a FileIndexRecord.
+///	</summary>
+static const int TimeFieldCount = 5;
 
-	//std::cout << time.ToString() << " " << iFileIx << " " << iTimeIx << std::endl;
+///////////////////////////////////////////////////////////////////////////////
 
-	iter->second.push_back(FileTimeIx(iFileIx, iTimeIx));
+///	<summary>
+///		Get the modification time and size of a file.  Returns false if
+///		the file cannot be accessed.
+///	</summary>
+static bool GetFileModTimeAndSize(
+	const std::string & strFile,
+	int64_t & iModTime,
+	int64_t & iSize
+) {
+	struct stat statFile;
+	if (stat(strFile.c_str(), &statFile) != 0) {
+		return false;
+	}
+	iModTime = static_cast<int64_t>(statFile.st_mtime);
+	iSize = static_cast<int64_t>(statFile.st_size);
+	return true;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
-void AutoCurator::IndexFiles(
-	const std::string & strFile
+void AutoCurator::SetIndexFile(
+	const std::string & strIndexFile
 ) {
-	// Search for semi-colons in strFile and break up accordingly
-	int iLast = 0;
-	for (int i = 0; i < strFile.length(); i++) {
-		if (strFile[i] == ';') {
-			IndexFiles(strFile.substr(iLast, i-iLast));
-			iLast = i+1;
+	if (m_vecFiles.size() != 0) {
+		_EXCEPTIONT("SetIndexFile() must be called before IndexFiles()");
+	}
+
+	m_strIndexFile = strIndexFile;
+	m_mapIndexRecords.clear();
+	m_fIndexFileModified = false;
+
+	FILE * fp = fopen(strIndexFile.c_str(), "rb");
+	if (fp == NULL) {
+		m_fIndexFileModified = true;
+		return;
+	}
+
+	char szMagic[8];
+	int32_t iVersion;
+	int32_t nRecords;
+
+	bool fSuccess =
+		(fread(szMagic, sizeof(char), 8, fp) == 8)
+		&& (memcmp(szMagic, IndexFileMagic, 8) == 0)
+		&& (fread(&iVersion, sizeof(int32_t), 1, fp) == 1)
+		&& (iVersion == IndexFileVersion)
+		&& (fread(&nRecords, sizeof(int32_t), 1, fp) == 1)
+		&& (nRecords >= 0);
+
+	for (int r = 0; fSuccess && (r < nRecords); r++) {
+		int32_t nNameLength;
+		fSuccess =
+			(fread(&nNameLength, sizeof(int32_t), 1, fp) == 1)
+			&& (nNameLength >= 0);
+		if (!fSuccess) {
+			break;
+		}
+
+		std::string strFile(nNameLength, '\0');
+		FileIndexRecord record;
+		int32_t nFields;
+
+		fSuccess =
+			((nNameLength == 0) ||
+			 (fread(&(strFile[0]), sizeof(char), nNameLength, fp)
+				== static_cast<size_t>(nNameLength)))
+			&& (fread(&(record.iModTime), sizeof(int64_t), 1, fp) == 1)
+			&& (fread(&(record.iSize), sizeof(int64_t), 1, fp) == 1)
+			&& (fread(&(record.iTimeAxisType), sizeof(int32_t), 1, fp) == 1)
+			&& (fread(&(record.iCalendarType), sizeof(int32_t), 1, fp) == 1)
+			&& (fread(&(record.nTimes), sizeof(int32_t), 1, fp) == 1)
+			&& (fread(&nFields, sizeof(int32_t), 1, fp) == 1)
+			&& (record.nTimes >= 0)
+			&& ((nFields == 0) || (nFields == TimeFieldCount * record.nTimes));
+		if (!fSuccess) {
+			break;
+		}
+
+		record.vecTimeFields.resize(nFields);
+		if (nFields != 0) {
+			fSuccess =
+				(fread(&(record.vecTimeFields[0]), sizeof(int32_t), nFields, fp)
+					== static_cast<size_t>(nFields));
+		}
+
+		if (fSuccess) {
+			m_mapIndexRecords[strFile] = record;
 		}
 	}
-	if (iLast != 0) {
-		IndexFiles(strFile.substr(iLast));
+
+	fclose(fp);
+
+	if (!fSuccess) {
+		Announce("WARNING: Ignoring invalid index file \"%s\"",
+			strIndexFile.c_str());
+		m_mapIndexRecords.clear();
+		m_fIndexFileModified = true;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void AutoCurator::WriteIndexFile() {
+	if ((m_strIndexFile == "") || (!m_fIndexFileModified)) {
 		return;
 	}
 
-	// Make sure file doesn't exist already
-	for (int f = 0; f < m_vecFiles.size(); f++) {
-		if (m_vecFiles[f] == strFile) {
-			_EXCEPTION1("Duplicated filename \"%s\"", strFile.c_str());
+	// Write under a temporary name and rename into place so that
+	// concurrent processes never observe a partially written file
+	char szSuffix[32];
+	snprintf(szSuffix, 32, ".tmp%i", static_cast<int>(getpid()));
+	std::string strTempFile = m_strIndexFile + szSuffix;
+
+	FILE * fp = fopen(strTempFile.c_str(), "wb");
+	if (fp == NULL) {
+		Announce("WARNING: Unable to write index file \"%s\"",
+			m_strIndexFile.c_str());
+		return;
+	}
+
+	int32_t nRecords = static_cast<int32_t>(m_mapIndexRecords.size());
+
+	bool fSuccess =
+		(fwrite(IndexFileMagic, sizeof(char), 8, fp) == 8)
+		&& (fwrite(&IndexFileVersion, sizeof(int32_t), 1, fp) == 1)
+		&& (fwrite(&nRecords, sizeof(int32_t), 1, fp) == 1);
+
+	FileIndexRecordMap::const_iterator iter = m_mapIndexRecords.begin();
+	for (; fSuccess && (iter != m_mapIndexRecords.end()); iter++) {
+		const std::string & strFile = iter->first;
+		const FileIndexRecord & record = iter->second;
+
+		int32_t nNameLength = static_cast<int32_t>(strFile.length());
+		int32_t nFields = static_cast<int32_t>(record.vecTimeFields.size());
+
+		fSuccess =
+			(fwrite(&nNameLength, sizeof(int32_t), 1, fp) == 1)
+			&& (fwrite(strFile.c_str(), sizeof(char), nNameLength, fp)
+				== static_cast<size_t>(nNameLength))
+			&& (fwrite(&(record.iModTime), sizeof(int64_t), 1, fp) == 1)
+			&& (fwrite(&(record.iSize), sizeof(int64_t), 1, fp) == 1)
+			&& (fwrite(&(record.iTimeAxisType), sizeof(int32_t), 1, fp) == 1)
+			&& (fwrite(&(record.iCalendarType), sizeof(int32_t), 1, fp) == 1)
+			&& (fwrite(&(record.nTimes), sizeof(int32_t), 1, fp) == 1)
+			&& (fwrite(&nFields, sizeof(int32_t), 1, fp) == 1);
+
+		if (fSuccess && (nFields != 0)) {
+			fSuccess =
+				(fwrite(&(record.vecTimeFields[0]), sizeof(int32_t), nFields, fp)
+					== static_cast<size_t>(nFields));
 		}
 	}
 
-	// Add file to list of files indexed
-	int iFileIx = static_cast<int>(m_vecFiles.size());
-	m_vecFiles.push_back(strFile);
+	if (fclose(fp) != 0) {
+		fSuccess = false;
+	}
+	if (fSuccess) {
+		fSuccess = (rename(strTempFile.c_str(), m_strIndexFile.c_str()) == 0);
+	}
+	if (!fSuccess) {
+		remove(strTempFile.c_str());
+		Announce("WARNING: Unable to write index file \"%s\"",
+			m_strIndexFile.c_str());
+		return;
+	}
+
+	m_fIndexFileModified = false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void AutoCurator::ReadFileIndexRecord(
+	const std::string & strFile,
+	FileIndexRecord & record
+) {
+	record.iTimeAxisType = FileIndexRecord::TimeAxisNone;
+	record.iCalendarType = Time::CalendarUnknown;
+	record.nTimes = 0;
+	record.vecTimeFields.clear();
 
 	// Open file
 	NcFile ncFile(strFile.c_str());
@@ -89,9 +246,116 @@ void AutoCurator::IndexFiles(
 		return;
 	}
 
-	// Check for time variable; if not present use CalendarNone and
-	// fill in FileTimePairs.
+	record.nTimes = dimTime->size();
+
+	// No time variable; times are generated from the file and time index
 	if (varTime == NULL) {
+		record.iTimeAxisType = FileIndexRecord::TimeAxisNoVariable;
+		return;
+	}
+
+	// If time variable is present make sure it is CF-compliant
+	if (varTime->num_dims() != 1) {
+		_EXCEPTION1("\"time\" variable requires one dimension "
+			"with name \"time\" in file \"%s\"",
+			strFile.c_str());
+	}
+	if (strcmp(varTime->get_dim(0)->name(), "time") != 0) {
+		_EXCEPTION1("\"time\" variable requires one dimension "
+			"with name \"time\" in file \"%s\"",
+			strFile.c_str());
+	}
+
+	NcAtt * attCalendar = varTime->get_att("calendar");
+	NcAtt * attUnits = varTime->get_att("units");
+	if (attCalendar == NULL) {
+		_EXCEPTION1("\"time\" variable in \"%s\" missing "
+			"\"calendar\" attribute", strFile.c_str());
+	}
+	if (attUnits == NULL) {
+		_EXCEPTION1("\"time\" variable in \"%s\" missing "
+			"\"units\" attribute", strFile.c_str());
+	}
+
+	Time::CalendarType eCalendarType =
+		Time::CalendarTypeFromString(attCalendar->as_string(0));
+
+	if (eCalendarType == Time::CalendarUnknown) {
+		_EXCEPTION2("Unknown calendar \"%s\" in \"%s\"",
+			attCalendar->as_string(0), strFile.c_str());
+	}
+
+	record.iTimeAxisType = FileIndexRecord::TimeAxisCF;
+	record.iCalendarType = static_cast<int32_t>(eCalendarType);
+
+	DataVector<int> vecTimeInt;
+	DataVector<float> vecTimeFloat;
+	DataVector<double> vecTimeDouble;
+	if (varTime->type() == ncInt) {
+		vecTimeInt.Initialize(dimTime->size());
+		varTime->set_cur((long)0);
+		varTime->get(&(vecTimeInt[0]), dimTime->size());
+
+	} else if (varTime->type() == ncFloat) {
+		vecTimeFloat.Initialize(dimTime->size());
+		varTime->set_cur((long)0);
+		varTime->get(&(vecTimeFloat[0]), dimTime->size());
+
+	} else if (varTime->type() == ncDouble) {
+		vecTimeDouble.Initialize(dimTime->size());
+		varTime->set_cur((long)0);
+		varTime->get(&(vecTimeDouble[0]), dimTime->size());
+
+	} else {
+		_EXCEPTION1("Variable \"time\" has invalid type in file \"%s\"",
+			strFile.c_str());
+	}
+
+	record.vecTimeFields.resize(TimeFieldCount * dimTime->size());
+
+	for (int t = 0; t < dimTime->size(); t++) {
+		Time time(eCalendarType);
+		if (varTime->type() == ncInt) {
+			time.FromCFCompliantUnitsOffsetInt(
+				attUnits->as_string(0),
+				vecTimeInt[t]);
+
+		} else if (varTime->type() == ncFloat) {
+			time.FromCFCompliantUnitsOffsetDouble(
+				attUnits->as_string(0),
+				static_cast<double>(vecTimeFloat[t]));
+
+		} else if (varTime->type() == ncDouble) {
+			time.FromCFCompliantUnitsOffsetDouble(
+				attUnits->as_string(0),
+				vecTimeDouble[t]);
+		}
+
+		int32_t * pFields = &(record.vecTimeFields[TimeFieldCount * t]);
+		pFields[0] = time.GetYear();
+		pFields[1] = time.GetMonth() - 1;
+		pFields[2] = time.GetDay() - 1;
+		pFields[3] = time.GetSecond();
+		pFields[4] = time.GetMicroSecond();
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void AutoCurator::InsertFileIndexRecord(
+	const std::string & strFile,
+	int iFileIx,
+	const FileIndexRecord & record
+) {
+	if (record.iTimeAxisType == FileIndexRecord::TimeAxisNone) {
+		return;
+	}
+
+	size_t sFirstNew = m_vecTimeIndex.size();
+
+	// No time variable; use CalendarNone and generate times from the
+	// file and time index
+	if (record.iTimeAxisType == FileIndexRecord::TimeAxisNoVariable) {
 		if (m_eCalendarType == Time::CalendarUnknown) {
 			m_eCalendarType = Time::CalendarNone;
 
@@ -100,93 +364,124 @@ void AutoCurator::IndexFiles(
 				"although \"time\" dimension is present", strFile.c_str());
 		}
 
-		for (int t = 0; t < dimTime->size(); t++) {
-			Time time(m_eCalendarType);
-			time.SetYear(iFileIx);
-			time.SetMonth(t);
+		for (int t = 0; t < record.nTimes; t++) {
+			TimeIndexEntry entry;
+			entry.time = Time(m_eCalendarType);
+			entry.time.SetYear(iFileIx);
+			entry.time.SetMonth(t);
+			entry.iFileIx = iFileIx;
+			entry.iTimeIx = t;
 
-			InsertTimeToFileTimeIx(time, iFileIx, t);
+			m_vecTimeIndex.push_back(entry);
 		}
 
-	// If time variable is present make sure it is CF-compliant and
-	// fill in FileTimePairs.
+	// CF-compliant time variable
 	} else {
-		if (varTime->num_dims() != 1) {
-			_EXCEPTION1("\"time\" variable requires one dimension "
-				"with name \"time\" in file \"%s\"",
-				strFile.c_str());
-		}
-		if (strcmp(varTime->get_dim(0)->name(), "time") != 0) {
-			_EXCEPTION1("\"time\" variable requires one dimension "
-				"with name \"time\" in file \"%s\"",
-				strFile.c_str());
-		}
-
-		NcAtt * attCalendar = varTime->get_att("calendar");
-		NcAtt * attUnits = varTime->get_att("units");
-		if (attCalendar == NULL) {
-			_EXCEPTION1("\"time\" variable in \"%s\" missing "
-				"\"calendar\" attribute", strFile.c_str());
-		}
-		if (attUnits == NULL) {
-			_EXCEPTION1("\"time\" variable in \"%s\" missing "
-				"\"units\" attribute", strFile.c_str());
-		}
-
 		Time::CalendarType eCalendarType =
-			Time::CalendarTypeFromString(attCalendar->as_string(0));
+			static_cast<Time::CalendarType>(record.iCalendarType);
 
 		if (m_eCalendarType == Time::CalendarUnknown) {
 			m_eCalendarType = eCalendarType;
 		} else if (m_eCalendarType != eCalendarType) {
 			_EXCEPTION2("CalendarType mismatch in \"%s\", found \"%s\"",
-				strFile.c_str(), attCalendar->as_string(0));
+				strFile.c_str(), Time(eCalendarType).GetCalendarName().c_str());
 		}
 
-		DataVector<int> vecTimeInt;
-		DataVector<float> vecTimeFloat;
-		DataVector<double> vecTimeDouble;
-		if (varTime->type() == ncInt) {
-			vecTimeInt.Initialize(dimTime->size());
-			varTime->set_cur((long)0);
-			varTime->get(&(vecTimeInt[0]), dimTime->size());
+		for (int t = 0; t < record.nTimes; t++) {
+			const int32_t * pFields =
+				&(record.vecTimeFields[TimeFieldCount * t]);
+
+			TimeIndexEntry entry;
+			entry.time = Time(m_eCalendarType);
+			entry.time.SetYear(pFields[0]);
+			entry.time.SetMonth(pFields[1]);
+			entry.time.SetDay(pFields[2]);
+			entry.time.SetSecond(pFields[3]);
+			entry.time.SetMicroSecond(pFields[4]);
+			entry.iFileIx = iFileIx;
+			entry.iTimeIx = t;
+
+			m_vecTimeIndex.push_back(entry);
+		}
+	}
 
-		} else if (varTime->type() == ncFloat) {
-			vecTimeFloat.Initialize(dimTime->size());
-			varTime->set_cur((long)0);
-			varTime->get(&(vecTimeFloat[0]), dimTime->size());
+	// Keep the index sorted; files are usually indexed in chronological
+	// order, in which case no entries are moved
+	std::vector<TimeIndexEntry>::iterator iterFirstNew =
+		m_vecTimeIndex.begin() + sFirstNew;
 
-		} else if (varTime->type() == ncDouble) {
-			vecTimeDouble.Initialize(dimTime->size());
-			varTime->set_cur((long)0);
-			varTime->get(&(vecTimeDouble[0]), dimTime->size());
+	if (!std::is_sorted(iterFirstNew, m_vecTimeIndex.end())) {
+		std::sort(iterFirstNew, m_vecTimeIndex.end());
+	}
+	if ((sFirstNew != 0) &&
+	    (iterFirstNew != m_vecTimeIndex.end()) &&
+	    (*iterFirstNew < *(iterFirstNew - 1))
+	) {
+		std::inplace_merge(
+			m_vecTimeIndex.begin(), iterFirstNew, m_vecTimeIndex.end());
+	}
+}
 
-		} else {
-			_EXCEPTION1("Variable \"time\" has invalid type in file \"%s\"",
-				strFile.c_str());
+///////////////////////////////////////////////////////////////////////////////
+
+void AutoCurator::IndexFiles(
+	const std::string & strFile
+) {
+	// Search for semi-colons in strFile and break up accordingly
+	int iLast = 0;
+	for (int i = 0; i < strFile.length(); i++) {
+		if (strFile[i] == ';') {
+			IndexFiles(strFile.substr(iLast, i-iLast));
+			iLast = i+1;
 		}
+	}
+	if (iLast != 0) {
+		IndexFiles(strFile.substr(iLast));
+		return;
+	}
 
-		for (int t = 0; t < dimTime->size(); t++) {
-			Time time(m_eCalendarType);
-			if (varTime->type() == ncInt) {
-				time.FromCFCompliantUnitsOffsetInt(
-					attUnits->as_string(0),
-					vecTimeInt[t]);
-
-			} else if (varTime->type() == ncFloat) {
-				time.FromCFCompliantUnitsOffsetDouble(
-					attUnits->as_string(0),
-					static_cast<double>(vecTimeFloat[t]));
-
-			} else if (varTime->type() == ncDouble) {
-				time.FromCFCompliantUnitsOffsetDouble(
-					attUnits->as_string(0),
-					vecTimeDouble[t]);
-			}
-
-			InsertTimeToFileTimeIx(time, iFileIx, t);
+	// Make sure file doesn't exist already
+	for (int f = 0; f < m_vecFiles.size(); f++) {
+		if (m_vecFiles[f] == strFile) {
+			_EXCEPTION1("Duplicated filename \"%s\"", strFile.c_str());
 		}
 	}
+
+	// Add file to list of files indexed
+	int iFileIx = static_cast<int>(m_vecFiles.size());
+	m_vecFiles.push_back(strFile);
+
+	// Without an index file, read the time axis from the file
+	if (m_strIndexFile == "") {
+		FileIndexRecord record;
+		ReadFileIndexRecord(strFile, record);
+		InsertFileIndexRecord(strFile, iFileIx, record);
+		return;
+	}
+
+	// Use the record in the index file if the file is unchanged
+	int64_t iModTime;
+	int64_t iSize;
+	if (!GetFileModTimeAndSize(strFile, iModTime, iSize)) {
+		_EXCEPTION1("Unable to open input file \"%s\"", strFile.c_str());
+	}
+
+	FileIndexRecordMap::iterator iter = m_mapIndexRecords.find(strFile);
+	if ((iter == m_mapIndexRecords.end()) ||
+	    (iter->second.iModTime != iModTime) ||
+	    (iter->second.iSize != iSize)
+	) {
+		FileIndexRecord & record = m_mapIndexRecords[strFile];
+		ReadFileIndexRecord(strFile, record);
+		record.iModTime = iModTime;
+		record.iSize = iSize;
+
+		m_fIndexFileModified = true;
+
+		iter = m_mapIndexRecords.find(strFile);
+	}
+
+	InsertFileIndexRecord(strFile, iFileIx, iter->second);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -196,20 +491,24 @@ AutoCurator::FilenameTimePairVector AutoCurator::Find(
 ) const {
 	FilenameTimePairVector vec;
 
-	TimeToFileTimeIxMap::const_iterator iter =
-		m_mapTimeToTimeFileIx.find(time);
-
-	if (iter == m_mapTimeToTimeFileIx.end()) {
+	if (m_vecTimeIndex.size() == 0) {
 		return vec;
 	}
 
-	const FileTimeIxVector & vecFileTimeIx = iter->second;
+	std::pair<
+		std::vector<TimeIndexEntry>::const_iterator,
+		std::vector<TimeIndexEntry>::const_iterator> range =
+			std::equal_range(
+				m_vecTimeIndex.begin(),
+				m_vecTimeIndex.end(),
+				time,
+				TimeIndexEntryTimeLess());
 
-	for (int f = 0; f < vecFileTimeIx.size(); f++) {
+	for (; range.first != range.second; range.first++) {
 		vec.push_back(
 			FilenameTimePair(
-				m_vecFiles[vecFileTimeIx[f].first],
-				vecFileTimeIx[f].second));
+				m_vecFiles[range.first->iFileIx],
+				range.first->iTimeIx));
 	}
 
 	return vec;
@@ -228,15 +527,7 @@ void AutoCurator::Find(
 	iTime = (-1);
 
 	for (int i = 0; i < vec.size(); i++) {
-		NcFile * pncfile = new NcFile(vec[i].first.c_str());
-		if (pncfile == NULL) {
-			_EXCEPTIONT("Unable to allocate new NcFile");
-		}
-		if (!pncfile->is_valid()) {
-			_EXCEPTION1("Unable to open data file \"%s\"", vec[i].first.c_str());
-		}
-
-		vecFiles.push_back(pncfile);
+		vecFiles.AddSharedFile(m_poolFiles.Open(vec[i].first));
 
 		if (iTime == (-1)) {
 			iTime = vec[i].second;
@@ -20,8 +20,10 @@
 #include <vector>
 #include <map>
 #include <string>
+#include <stdint.h>
 
 #include "TimeObj.h"
+#include "NcFilePool.h"
 
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -29,6 +31,16 @@ class NcFileVector;
 
 ///////////////////////////////////////////////////////////////////////////////
 
+///	<summary>
+///		An index of the times available in a collection of NetCDF files.
+///		The index is stored as a flat array of (Time, file, local time
+///		index) entries sorted by Time, so lookups are a binary search.
+///
+///		The time axis of each file can be stored in a persistent index
+///		file (see SetIndexFile()), so later runs only open files that are
+///		new or whose modification time or size has changed.  Data files
+///		returned by Find() are kept open in a bounded pool.
+///	</summary>
 class AutoCurator {
 
 public:
@@ -42,11 +54,6 @@ public:
 	///	</summary>
 	typedef std::vector<FileTimeIx> FileTimeIxVector;
 
-	///	<summary>
-	///		A map from a Time to a vector of (file index, local time index) pairs.
-	///	</summary>
-	typedef std::map<Time, FileTimeIxVector> TimeToFileTimeIxMap;
-
 	///	<summary>
 	///		A (filename, local time index) pair.
 	///	</summary>
@@ -57,25 +64,138 @@ public:
 	///	</summary>
 	typedef std::vector<FilenameTimePair> FilenameTimePairVector;
 
+protected:
+	///	<summary>
+	///		An entry in the time index.
+	///	</summary>
+	struct TimeIndexEntry {
+		Time time;
+		int iFileIx;
+		int iTimeIx;
+
+		///	<summary>
+		///		Order entries by Time, then by file and local time index.
+		///	</summary>
+		bool operator<(const TimeIndexEntry & entry) const {
+			if (time < entry.time) {
+				return true;
+			}
+			if (entry.time < time) {
+				return false;
+			}
+			if (iFileIx != entry.iFileIx) {
+				return (iFileIx < entry.iFileIx);
+			}
+			return (iTimeIx < entry.iTimeIx);
+		}
+	};
+
+	///	<summary>
+	///		Compare the Time of entries in the time index.
+	///	</summary>
+	struct TimeIndexEntryTimeLess {
+		bool operator()(const TimeIndexEntry & entry, const Time & time) const {
+			return (entry.time < time);
+		}
+		bool operator()(const Time & time, const TimeIndexEntry & entry) const {
+			return (time < entry.time);
+		}
+	};
+
+	///	<summary>
+	///		The time axis of a single file, as stored in the index file.
+	///	</summary>
+	struct FileIndexRecord {
+
+		///	<summary>
+		///		Form of the time axis.
+		///	</summary>
+		enum TimeAxisType {
+			TimeAxisNone = 0,
+			TimeAxisNoVariable = 1,
+			TimeAxisCF = 2
+		};
+
+		///	<summary>
+		///		Modification time of the file, in seconds.
+		///	</summary>
+		int64_t iModTime;
+
+		///	<summary>
+		///		Size of the file, in bytes.
+		///	</summary>
+		int64_t iSize;
+
+		///	<summary>
+		///		Form of the time axis.
+		///	</summary>
+		int32_t iTimeAxisType;
+
+		///	<summary>
+		///		Calendar of the time variable (for TimeAxisCF).
+		///	</summary>
+		int32_t iCalendarType;
+
+		///	<summary>
+		///		Length of the time dimension.
+		///	</summary>
+		int32_t nTimes;
+
+		///	<summary>
+		///		Year, month, day, second and microsecond of each time (for
+		///		TimeAxisCF), with months and days counted from zero.
+		///	</summary>
+		std::vector<int32_t> vecTimeFields;
+	};
+
+	///	<summary>
+	///		Map from filename to the record of the file in the index file.
+	///	</summary>
+	typedef std::map<std::string, FileIndexRecord> FileIndexRecordMap;
+
 public:
 	///	<summary>
 	///		Constructor.
 	///	</summary>
 	AutoCurator() :
-		m_eCalendarType(Time::CalendarUnknown)
+		m_eCalendarType(Time::CalendarUnknown),
+		m_fIndexFileModified(false)
 	{ }
 
 protected:
 	///	<summary>
-	///		Create a new entry in m_mapTimeToTimeFileIx for the given Time.
+	///		Read the time axis of a file into a FileIndexRecord.
 	///	</summary>
-	void InsertTimeToFileTimeIx(
-		const Time & time,
-		const int & iFileIx,
-		const int & iTimeIx
+	void ReadFileIndexRecord(
+		const std::string & strFile,
+		FileIndexRecord & record
+	);
+
+	///	<summary>
+	///		Add the times in a FileIndexRecord to the time index.
+	///	</summary>
+	void InsertFileIndexRecord(
+		const std::string & strFile,
+		int iFileIx,
+		const FileIndexRecord & record
 	);
 
 public:
+	///	<summary>
+	///		Use the given persistent index file.  Records in an existing
+	///		index file are used in place of opening files whose
+	///		modification time and size are unchanged.  Must be called
+	///		before IndexFiles().
+	///	</summary>
+	void SetIndexFile(
+		const std::string & strIndexFile
+	);
+
+	///	<summary>
+	///		Write the persistent index file if any records have changed.
+	///	</summary>
+	void WriteIndexFile();
+
 	///	<summary>
 	///		Index the contents of a single file or list of files delimited
 	///		by semicolons.
@@ -105,8 +225,18 @@ public:
 		const Time & time
 	) const;
 
+	///	<summary>
+	///		Set the maximum number of data files kept open by Find().
+	///	</summary>
+	void SetMaxOpenFiles(size_t sMaxOpenFiles) {
+		m_poolFiles.SetMaxOpenFiles(sMaxOpenFiles);
+	}
+
 	///	<summary>
 	///		Generate a NcFileVector and local time index for the given Time.
+	///		Files are taken from a pool of open files that is shared by all
+	///		calls, so the NcFileVector must not close them.  This function
+	///		is thread-safe.
 	///	</summary>
 	void Find(
 		const Time & time,
@@ -126,9 +256,30 @@ protected:
 	std::vector<std::string> m_vecFiles;
 
 	///	<summary>
-	///		A map between Time, and (file,time) index.
+	///		Entries of the time index, sorted.
+	///	</summary>
+	std::vector<TimeIndexEntry> m_vecTimeIndex;
+
+	///	<summary>
+	///		Persistent index file.
+	///	</summary>
+	std::string m_strIndexFile;
+
+	///	<summary>
+	///		Records in the persistent index file.
+	///	</summary>
+	FileIndexRecordMap m_mapIndexRecords;
+
+	///	<summary>
+	///		Flag indicating records have changed since the index file was
+	///		read.
+	///	</summary>
+	bool m_fIndexFileModified;
+
+	///	<summary>
+	///		Pool of open data files.
 	///	</summary>
-	TimeToFileTimeIxMap m_mapTimeToTimeFileIx;
+	mutable NcFilePool m_poolFiles;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
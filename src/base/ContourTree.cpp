@@ -0,0 +1,338 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+///	\file    ContourTree.cpp
+///	\author  Paul Ullrich
+///	\version October 16, 2026
+///
+///	<remarks>
+///		Copyright 2000-2018 Paul Ullrich
+///
+///		This file is distributed as part of the Tempest source code package.
+///		Permission is granted to use, copy, modify and distribute this
+///		source code and its documentation under the terms of the GNU General
+///		Public License.  This software is provided "as is" without express
+///		or implied warranty.
+///	</remarks>
+
+#include "ContourTree.h"
+#include "SimpleGrid.h"
+#include "Exception.h"
+
+#include <algorithm>
+#include <cmath>
+
+///////////////////////////////////////////////////////////////////////////////
+
+ContourTree::ContourTree(
+	const SimpleGrid & grid
+) :
+	m_grid(grid),
+	m_fSymmetric(true)
+{
+	const int nGridSize = static_cast<int>(grid.GetSize());
+
+	// Check that every edge appears in both directions
+	for (int ix = 0; (ix < nGridSize) && m_fSymmetric; ix++) {
+		const SimpleGrid::NeighborRange neighbors = grid.GetNeighbors(ix);
+		for (int n = 0; n < neighbors.size(); n++) {
+			const SimpleGrid::NeighborRange neighborsBack =
+				grid.GetNeighbors(neighbors[n]);
+
+			if (std::find(neighborsBack.begin(), neighborsBack.end(), ix)
+			    == neighborsBack.end()
+			) {
+				m_fSymmetric = false;
+				break;
+			}
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+double ContourTree::GetCoordinate(
+	int ix,
+	int iCoord
+) const {
+	if (iCoord == 0) {
+		return m_grid.m_dX[ix];
+	} else if (iCoord == 1) {
+		return m_grid.m_dY[ix];
+	} else {
+		return m_grid.m_dZ[ix];
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+int ContourTree::Find(
+	int ix
+) {
+	int ixRoot = ix;
+	while (m_vecParent[ixRoot] != ixRoot) {
+		ixRoot = m_vecParent[ixRoot];
+	}
+
+	// Path compression
+	while (m_vecParent[ix] != ixRoot) {
+		int ixNext = m_vecParent[ix];
+		m_vecParent[ix] = ixRoot;
+		ix = ixNext;
+	}
+
+	return ixRoot;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ContourTree::Union(
+	int ixRootA,
+	int ixRootB
+) {
+	if (ixRootA == ixRootB) {
+		return;
+	}
+
+	// Union by size
+	if (m_vecSize[ixRootA] < m_vecSize[ixRootB]) {
+		std::swap(ixRootA, ixRootB);
+	}
+
+	m_vecParent[ixRootB] = ixRootA;
+	m_vecSize[ixRootA] += m_vecSize[ixRootB];
+
+	// Append the list of nodes of B to the list of A
+	m_vecNext[m_vecTail[ixRootA]] = ixRootB;
+	m_vecTail[ixRootA] = m_vecTail[ixRootB];
+
+	// Merge extreme nodes
+	int * piExtremesA = &(m_vecExtremes[ixRootA * ExtremeCount]);
+	const int * piExtremesB = &(m_vecExtremes[ixRootB * ExtremeCount]);
+
+	for (int c = 0; c < 3; c++) {
+		if (GetCoordinate(piExtremesB[2*c], c)
+		    < GetCoordinate(piExtremesA[2*c], c)
+		) {
+			piExtremesA[2*c] = piExtremesB[2*c];
+		}
+		if (GetCoordinate(piExtremesB[2*c+1], c)
+		    > GetCoordinate(piExtremesA[2*c+1], c)
+		) {
+			piExtremesA[2*c+1] = piExtremesB[2*c+1];
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ContourTree::AddNode(
+	int ix
+) {
+	m_vecParent[ix] = ix;
+	m_vecSize[ix] = 1;
+	m_vecNext[ix] = (-1);
+	m_vecTail[ix] = ix;
+
+	// Extreme nodes among this node and its neighbors
+	int * piExtremes = &(m_vecExtremes[ix * ExtremeCount]);
+	for (int e = 0; e < ExtremeCount; e++) {
+		piExtremes[e] = ix;
+	}
+
+	const SimpleGrid::NeighborRange neighbors = m_grid.GetNeighbors(ix);
+	for (int n = 0; n < neighbors.size(); n++) {
+		int ixNeighbor = neighbors[n];
+		for (int c = 0; c < 3; c++) {
+			if (GetCoordinate(ixNeighbor, c)
+			    < GetCoordinate(piExtremes[2*c], c)
+			) {
+				piExtremes[2*c] = ixNeighbor;
+			}
+			if (GetCoordinate(ixNeighbor, c)
+			    > GetCoordinate(piExtremes[2*c+1], c)
+			) {
+				piExtremes[2*c+1] = ixNeighbor;
+			}
+		}
+	}
+
+	// Merge with all neighbors already in the sweep
+	for (int n = 0; n < neighbors.size(); n++) {
+		int ixNeighbor = neighbors[n];
+		if (m_vecParent[ixNeighbor] != (-1)) {
+			Union(Find(ix), Find(ixNeighbor));
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool ContourTree::IsComponentWithinDistance(
+	int ixOrigin,
+	double dDeltaDist
+) {
+	const SimpleGrid::DistanceThreshold distDelta(dDeltaDist);
+
+	const int ixRoot = Find(ixOrigin);
+	const int * piExtremes = &(m_vecExtremes[ixRoot * ExtremeCount]);
+
+	// Any extreme node outside the distance is a node of the region or
+	// one of its neighbors, which the flood fill would reach
+	for (int e = 0; e < ExtremeCount; e++) {
+		if (!m_grid.IsWithinDistance(ixOrigin, piExtremes[e], distDelta)) {
+			return false;
+		}
+	}
+
+	// The farthest corner of the bounding box of the extreme nodes
+	// bounds the chord distance of all nodes, evaluated as in
+	// SimpleGrid::ChordDist2() so that rounding preserves the bound
+	double dCorner2 = 0.0;
+	for (int c = 0; c < 3; c++) {
+		double dOrigin = GetCoordinate(ixOrigin, c);
+		double dLower = fabs(GetCoordinate(piExtremes[2*c], c) - dOrigin);
+		double dUpper = fabs(GetCoordinate(piExtremes[2*c+1], c) - dOrigin);
+		double dMax = std::max(dLower, dUpper);
+		dCorner2 += dMax * dMax;
+	}
+	if (dCorner2 < distDelta.m_dChord2Lower) {
+		return true;
+	}
+
+	// Check all nodes of the component and their neighbors
+	for (int ix = ixRoot; ix != (-1); ix = m_vecNext[ix]) {
+		if (!m_grid.IsWithinDistance(ixOrigin, ix, distDelta)) {
+			return false;
+		}
+
+		const SimpleGrid::NeighborRange neighbors = m_grid.GetNeighbors(ix);
+		for (int n = 0; n < neighbors.size(); n++) {
+			if (!m_grid.IsWithinDistance(ixOrigin, neighbors[n], distDelta)) {
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ContourTree::FindClosedContours(
+	const DataVector<float> & dataState,
+	const std::vector<int> & vecOrigins,
+	double dDeltaAmt,
+	double dDeltaDist,
+	std::vector<char> & vecHasClosedContour
+) {
+	// Verify arguments
+	if (dDeltaAmt == 0.0) {
+		_EXCEPTIONT("Closed contour amount must be non-zero");
+	}
+	if (dDeltaDist <= 0.0) {
+		_EXCEPTIONT("Closed contour distance must be positive");
+	}
+	if (!m_fSymmetric) {
+		_EXCEPTIONT("ContourTree requires symmetric grid connectivity");
+	}
+
+	const int nGridSize = static_cast<int>(m_grid.GetSize());
+	const int nOrigins = static_cast<int>(vecOrigins.size());
+
+	const bool fMinima = (dDeltaAmt > 0.0);
+
+	vecHasClosedContour.resize(nOrigins);
+	if (nOrigins == 0) {
+		return;
+	}
+
+	// Order nodes by increasing value about minima (decreasing about
+	// maxima).  The flood fill never stops at NaN values, so they are
+	// added first.
+	m_vecOrder.resize(nGridSize);
+	for (int i = 0; i < nGridSize; i++) {
+		m_vecOrder[i] = i;
+	}
+
+	std::sort(m_vecOrder.begin(), m_vecOrder.end(),
+		[&dataState, fMinima](int a, int b) {
+			bool fNaNA = std::isnan(dataState[a]);
+			bool fNaNB = std::isnan(dataState[b]);
+			if (fNaNA || fNaNB) {
+				return (fNaNA && !fNaNB) || ((fNaNA && fNaNB) && (a < b));
+			}
+			if (dataState[a] != dataState[b]) {
+				return fMinima?(dataState[a] < dataState[b]):(dataState[a] > dataState[b]);
+			}
+			return (a < b);
+		});
+
+	// Order origins by the value at which their region is closed, which
+	// follows the reference value; NaN reference values never close
+	std::vector<int> vecQueries(nOrigins);
+	for (int q = 0; q < nOrigins; q++) {
+		vecQueries[q] = q;
+	}
+
+	std::sort(vecQueries.begin(), vecQueries.end(),
+		[&dataState, &vecOrigins, fMinima](int a, int b) {
+			float dRefA = dataState[vecOrigins[a]];
+			float dRefB = dataState[vecOrigins[b]];
+			bool fNaNA = std::isnan(dRefA);
+			bool fNaNB = std::isnan(dRefB);
+			if (fNaNA || fNaNB) {
+				return (!fNaNA && fNaNB) || ((fNaNA && fNaNB) && (a < b));
+			}
+			if (dRefA != dRefB) {
+				return fMinima?(dRefA < dRefB):(dRefA > dRefB);
+			}
+			return (a < b);
+		});
+
+	// Reset the union-find structure
+	m_vecParent.assign(nGridSize, -1);
+	m_vecSize.resize(nGridSize);
+	m_vecNext.resize(nGridSize);
+	m_vecTail.resize(nGridSize);
+	m_vecExtremes.resize(static_cast<size_t>(nGridSize) * ExtremeCount);
+
+	// Sweep through all nodes.  Before adding a node, answer all origins
+	// whose region excludes this node, since their region is the current
+	// component of the origin.  Comparisons follow HasClosedContour().
+	int iQuery = 0;
+
+	for (int i = 0; i < nGridSize; i++) {
+		const int ix = m_vecOrder[i];
+		const float dValue = dataState[ix];
+
+		for (; iQuery < nOrigins; iQuery++) {
+			const int q = vecQueries[iQuery];
+			const float dRefValue = dataState[vecOrigins[q]];
+
+			bool fOutside;
+			if (fMinima) {
+				fOutside = (dValue - dRefValue >= dDeltaAmt);
+			} else {
+				fOutside = (dRefValue - dValue >= -dDeltaAmt);
+			}
+			if (!fOutside) {
+				break;
+			}
+
+			vecHasClosedContour[q] =
+				IsComponentWithinDistance(vecOrigins[q], dDeltaDist)?(1):(0);
+		}
+
+		AddNode(ix);
+	}
+
+	// All remaining regions contain the whole connected component
+	for (; iQuery < nOrigins; iQuery++) {
+		const int q = vecQueries[iQuery];
+		vecHasClosedContour[q] =
+			IsComponentWithinDistance(vecOrigins[q], dDeltaDist)?(1):(0);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
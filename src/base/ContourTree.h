@@ -0,0 +1,176 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+///	\file    ContourTree.h
+///	\author  Paul Ullrich
+///	\version October 16, 2026
+///
+///	<remarks>
+///		Copyright 2000-2018 Paul Ullrich
+///
+///		This file is distributed as part of the Tempest source code package.
+///		Permission is granted to use, copy, modify and distribute this
+///		source code and its documentation under the terms of the GNU General
+///		Public License.  This software is provided "as is" without express
+///		or implied warranty.
+///	</remarks>
+
+#ifndef _CONTOURTREE_H_
+#define _CONTOURTREE_H_
+
+#include "DataVector.h"
+
+#include <vector>
+
+class SimpleGrid;
+
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		Closed contour detection for many origins at once.  A closed contour
+///		of depth dDeltaAmt exists about an origin if the connected region of
+///		nodes whose value differs from the origin by less than dDeltaAmt,
+///		together with all neighbors of that region, lies within dDeltaDist
+///		of the origin.  This is the region explored by a flood fill from
+///		each origin.
+///
+///		Here the region of every origin is found in a single sweep over
+///		the nodes in order of value, which merges nodes into connected
+///		components with a union-find structure (building the merge tree of
+///		the field).  Each origin is answered when the sweep reaches the
+///		first node outside its region.  Components carry the nodes with
+///		extreme coordinates among their nodes and neighbors, which decide
+///		most queries directly; otherwise the nodes of the component are
+///		checked individually.  Results are identical to the flood fill.
+///
+///		The sweep treats the grid connectivity as undirected, so it can
+///		only be used on grids with symmetric connectivity (see
+///		IsApplicable()).
+///	</summary>
+class ContourTree {
+
+public:
+	///	<summary>
+	///		Constructor.
+	///	</summary>
+	ContourTree(
+		const SimpleGrid & grid
+	);
+
+private:
+	///	<summary>
+	///		Copy constructor (not implemented).
+	///	</summary>
+	ContourTree(const ContourTree &);
+
+	///	<summary>
+	///		Assignment operator (not implemented).
+	///	</summary>
+	ContourTree & operator=(const ContourTree &);
+
+public:
+	///	<summary>
+	///		Check if the grid connectivity is symmetric, so that results
+	///		are identical to a flood fill.
+	///	</summary>
+	bool IsApplicable() const {
+		return m_fSymmetric;
+	}
+
+	///	<summary>
+	///		Determine if there is a closed contour about each origin.  A
+	///		positive dDeltaAmt requires an increase in value about a
+	///		minimum, a negative dDeltaAmt a decrease about a maximum.
+	///	</summary>
+	void FindClosedContours(
+		const DataVector<float> & dataState,
+		const std::vector<int> & vecOrigins,
+		double dDeltaAmt,
+		double dDeltaDist,
+		std::vector<char> & vecHasClosedContour
+	);
+
+protected:
+	///	<summary>
+	///		Number of extreme nodes tracked for each component (minimum and
+	///		maximum of each Cartesian coordinate).
+	///	</summary>
+	static const int ExtremeCount = 6;
+
+	///	<summary>
+	///		Find the root of the component containing node ix.
+	///	</summary>
+	int Find(int ix);
+
+	///	<summary>
+	///		Merge the components with roots ixRootA and ixRootB.
+	///	</summary>
+	void Union(int ixRootA, int ixRootB);
+
+	///	<summary>
+	///		Add node ix to the sweep as a new component.
+	///	</summary>
+	void AddNode(int ix);
+
+	///	<summary>
+	///		Determine if the component containing ixOrigin, together with
+	///		its neighbors, lies within the given distance of ixOrigin.
+	///	</summary>
+	bool IsComponentWithinDistance(
+		int ixOrigin,
+		double dDeltaDist
+	);
+
+	///	<summary>
+	///		Get the Cartesian coordinate iCoord (0, 1 or 2) of node ix.
+	///	</summary>
+	double GetCoordinate(int ix, int iCoord) const;
+
+protected:
+	///	<summary>
+	///		Grid on which contours are found.
+	///	</summary>
+	const SimpleGrid & m_grid;
+
+	///	<summary>
+	///		Flag indicating the grid connectivity is symmetric.
+	///	</summary>
+	bool m_fSymmetric;
+
+	///	<summary>
+	///		Nodes in the order in which they are added to the sweep.
+	///	</summary>
+	std::vector<int> m_vecOrder;
+
+	///	<summary>
+	///		Parent of each node in the union-find structure, or (-1) for
+	///		nodes that have not been added.
+	///	</summary>
+	std::vector<int> m_vecParent;
+
+	///	<summary>
+	///		Number of nodes in the component of each root node.
+	///	</summary>
+	std::vector<int> m_vecSize;
+
+	///	<summary>
+	///		Next node in the same component (or -1), forming a list that
+	///		starts at the root node.
+	///	</summary>
+	std::vector<int> m_vecNext;
+
+	///	<summary>
+	///		Last node in the list of nodes of the component of each root.
+	///	</summary>
+	std::vector<int> m_vecTail;
+
+	///	<summary>
+	///		Nodes with extreme coordinates among the nodes and neighbors of
+	///		the component of each root, ExtremeCount entries per node.
+	///	</summary>
+	std::vector<int> m_vecExtremes;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+#endif // _CONTOURTREE_H_
+
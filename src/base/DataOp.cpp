@@ -19,11 +19,19 @@
 #include "DataOp.h"
 #include "Variable.h"
 #include "SimpleGrid.h"
-#include "kdtree.h"
+#include "SphericalKDTree.h"
+#include "DataOpKernels.h"
+#include "GraphSearchWorkspace.h"
 
 #include <cstdlib>
+#include <cstdio>
+#include <cstring>
 #include <set>
 #include <queue>
+#include <algorithm>
+
+#include <stdint.h>
+#include <unistd.h>
 
 ///////////////////////////////////////////////////////////////////////////////
 // DataOpManager
@@ -79,6 +87,9 @@ DataOp * DataOpManager::Add(
 	} else if (strName == "_F") {
 		return Add(new DataOp_F);
 
+	} else if (strName == "_MEAN") {
+		return Add(new DataOp_MEAN);
+
 	} else if (strName.substr(0,10) == "_LAPLACIAN") {
 		int nPoints = 0;
 		double dDist = 0.0;
@@ -152,91 +163,62 @@ bool DataOp::Apply(
 	return true;
 }
 
-///////////////////////////////////////////////////////////////////////////////
-// DataOp_VECMAG
-///////////////////////////////////////////////////////////////////////////////
-
-const char * DataOp_VECMAG::name = "_VECMAG";
-
 ///////////////////////////////////////////////////////////////////////////////
 
-bool DataOp_VECMAG::Apply(
+bool DataOp::ApplyOnNodes(
 	const SimpleGrid & grid,
 	const std::vector<std::string> & strArg,
 	const std::vector<DataVector<float> const *> & vecArgData,
+	const std::vector<int> & vecNodes,
 	DataVector<float> & dataout
 ) {
-	if (strArg.size() != 2) {
-		_EXCEPTION2("%s expects two arguments: %i given",
-			m_strName.c_str(), strArg.size());
-	}
-	if ((vecArgData[0] == NULL) || (vecArgData[1] == NULL)) {
-		_EXCEPTION1("Arguments to %s must be data variables",
-			m_strName.c_str());
-	}
-
-	const DataVector<float> & dataLeft  = *(vecArgData[0]);
-	const DataVector<float> & dataRight = *(vecArgData[1]);
-
-	for (int i = 0; i < dataout.GetRows(); i++) {
-		dataout[i] =
-			sqrt(dataLeft[i] * dataLeft[i]
-				+ dataRight[i] * dataRight[i]);
-	}
-
-	return true;
+	_EXCEPTION1("Operator %s cannot be applied on a subset of nodes",
+		m_strName.c_str());
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-// DataOp_ABS
-///////////////////////////////////////////////////////////////////////////////
-
-const char * DataOp_ABS::name = "_ABS";
-
+// DataOp_Elementwise
 ///////////////////////////////////////////////////////////////////////////////
 
-bool DataOp_ABS::Apply(
+bool DataOp_Elementwise::Apply(
 	const SimpleGrid & grid,
 	const std::vector<std::string> & strArg,
 	const std::vector<DataVector<float> const *> & vecArgData,
 	DataVector<float> & dataout
 ) {
-	if (strArg.size() != 1) {
-		_EXCEPTION2("%s expects two arguments: %i given",
-			m_strName.c_str(), strArg.size());
-	}
-	if (vecArgData[0] == NULL) {
-		_EXCEPTION1("Arguments to %s must be data variables",
-			m_strName.c_str());
+	CheckArguments(static_cast<int>(strArg.size()));
+
+	std::vector<const float *> vecArgPtr(vecArgData.size());
+	for (int v = 0; v < vecArgData.size(); v++) {
+		if (vecArgData[v] == NULL) {
+			_EXCEPTION1("Arguments to %s must be data variables",
+				m_strName.c_str());
+		}
+		vecArgPtr[v] = &((*(vecArgData[v]))[0]);
 	}
 
-	const DataVector<float> & data = *(vecArgData[0]);
+	ApplyElementwise(
+		grid,
+		0,
+		dataout.GetRows(),
+		static_cast<int>(vecArgPtr.size()),
+		(vecArgPtr.size() == 0)?(NULL):(&(vecArgPtr[0])),
+		&(dataout[0]));
 
-	for (int i = 0; i < dataout.GetRows(); i++) {
-		dataout[i] = fabs(data[i]);
-	}
-	
 	return true;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-// DataOp_AVG
-///////////////////////////////////////////////////////////////////////////////
-
-const char * DataOp_AVG::name = "_AVG";
 
-///////////////////////////////////////////////////////////////////////////////
-
-bool DataOp_AVG::Apply(
+bool DataOp_Elementwise::ApplyOnNodes(
 	const SimpleGrid & grid,
 	const std::vector<std::string> & strArg,
 	const std::vector<DataVector<float> const *> & vecArgData,
+	const std::vector<int> & vecNodes,
 	DataVector<float> & dataout
 ) {
-	if (strArg.size() <= 1) {
-		_EXCEPTION2("%s expects at least two arguments: %i given",
-			m_strName.c_str(), strArg.size());
-	}
+	CheckArguments(static_cast<int>(strArg.size()));
+
 	for (int v = 0; v < vecArgData.size(); v++) {
 		if (vecArgData[v] == NULL) {
 			_EXCEPTION1("Arguments to %s must be data variables",
@@ -244,87 +226,187 @@ bool DataOp_AVG::Apply(
 		}
 	}
 
-	dataout.Zero();
-	for (int v = 0; v < vecArgData.size(); v++) {
-		const DataVector<float> & data  = *(vecArgData[v]);
+	std::vector<const float *> vecArgPtr(vecArgData.size());
+
+	// Apply the operator on each run of consecutive nodes
+	size_t n = 0;
+	while (n < vecNodes.size()) {
+		size_t sBegin = static_cast<size_t>(vecNodes[n]);
+		size_t sCount = 1;
+		while ((n + sCount < vecNodes.size()) &&
+		       (static_cast<size_t>(vecNodes[n + sCount]) == sBegin + sCount)
+		) {
+			sCount++;
+		}
 
-		for (int i = 0; i < dataout.GetRows(); i++) {
-			dataout[i] += data[i];
+		for (int v = 0; v < vecArgData.size(); v++) {
+			vecArgPtr[v] = &((*(vecArgData[v]))[sBegin]);
 		}
-	}
 
-	const double dScale = 1.0 / static_cast<double>(strArg.size());
-	for (int i = 0; i < dataout.GetRows(); i++) {
-		dataout[i] *= dScale;
+		ApplyElementwise(
+			grid,
+			sBegin,
+			sCount,
+			static_cast<int>(vecArgPtr.size()),
+			(vecArgPtr.size() == 0)?(NULL):(&(vecArgPtr[0])),
+			&(dataout[sBegin]));
+
+		n += sCount;
 	}
 
 	return true;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-// DataOp_DIFF
+// DataOp_VECMAG
 ///////////////////////////////////////////////////////////////////////////////
 
-const char * DataOp_DIFF::name = "_DIFF";
+const char * DataOp_VECMAG::name = "_VECMAG";
 
 ///////////////////////////////////////////////////////////////////////////////
 
-bool DataOp_DIFF::Apply(
-	const SimpleGrid & grid,
-	const std::vector<std::string> & strArg,
-	const std::vector<DataVector<float> const *> & vecArgData,
-	DataVector<float> & dataout
-) {
-	if (strArg.size() != 2) {
+void DataOp_VECMAG::CheckArguments(
+	int nArgs
+) const {
+	if (nArgs != 2) {
 		_EXCEPTION2("%s expects two arguments: %i given",
-			m_strName.c_str(), strArg.size());
-	}
-	if ((vecArgData[0] == NULL) || (vecArgData[1] == NULL)) {
-		_EXCEPTION1("Arguments to %s must be data variables",
-			m_strName.c_str());
+			m_strName.c_str(), nArgs);
 	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void DataOp_VECMAG::ApplyElementwise(
+	const SimpleGrid & grid,
+	size_t sBegin,
+	size_t sCount,
+	int nArgs,
+	const float * const * pArgData,
+	float * pOut
+) const {
+	KernelVecMag(sCount, pArgData[0], pArgData[1], pOut);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// DataOp_ABS
+///////////////////////////////////////////////////////////////////////////////
+
+const char * DataOp_ABS::name = "_ABS";
 
-	const DataVector<float> & dataLeft  = *(vecArgData[0]);
-	const DataVector<float> & dataRight = *(vecArgData[1]);
+///////////////////////////////////////////////////////////////////////////////
 
-	for (int i = 0; i < dataout.GetRows(); i++) {
-		dataout[i] = dataLeft[i] - dataRight[i];
+void DataOp_ABS::CheckArguments(
+	int nArgs
+) const {
+	if (nArgs != 1) {
+		_EXCEPTION2("%s expects one argument: %i given",
+			m_strName.c_str(), nArgs);
 	}
+}
 
-	return true;
+///////////////////////////////////////////////////////////////////////////////
+
+void DataOp_ABS::ApplyElementwise(
+	const SimpleGrid & grid,
+	size_t sBegin,
+	size_t sCount,
+	int nArgs,
+	const float * const * pArgData,
+	float * pOut
+) const {
+	KernelAbs(sCount, pArgData[0], pOut);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-// DataOp_DIV
+// DataOp_AVG
 ///////////////////////////////////////////////////////////////////////////////
 
-const char * DataOp_DIV::name = "_DIV";
+const char * DataOp_AVG::name = "_AVG";
+
+///////////////////////////////////////////////////////////////////////////////
+
+void DataOp_AVG::CheckArguments(
+	int nArgs
+) const {
+	if (nArgs <= 1) {
+		_EXCEPTION2("%s expects at least two arguments: %i given",
+			m_strName.c_str(), nArgs);
+	}
+}
 
 ///////////////////////////////////////////////////////////////////////////////
 
-bool DataOp_DIV::Apply(
+void DataOp_AVG::ApplyElementwise(
 	const SimpleGrid & grid,
-	const std::vector<std::string> & strArg,
-	const std::vector<DataVector<float> const *> & vecArgData,
-	DataVector<float> & dataout
-) {
-	if (strArg.size() != 2) {
+	size_t sBegin,
+	size_t sCount,
+	int nArgs,
+	const float * const * pArgData,
+	float * pOut
+) const {
+	const double dScale = 1.0 / static_cast<double>(nArgs);
+
+	KernelSumScale(sCount, nArgs, pArgData, dScale, pOut);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// DataOp_DIFF
+///////////////////////////////////////////////////////////////////////////////
+
+const char * DataOp_DIFF::name = "_DIFF";
+
+///////////////////////////////////////////////////////////////////////////////
+
+void DataOp_DIFF::CheckArguments(
+	int nArgs
+) const {
+	if (nArgs != 2) {
 		_EXCEPTION2("%s expects two arguments: %i given",
-			m_strName.c_str(), strArg.size());
-	}
-	if ((vecArgData[0] == NULL) || (vecArgData[1] == NULL)) {
-		_EXCEPTION1("Arguments to %s must be data variables",
-			m_strName.c_str());
+			m_strName.c_str(), nArgs);
 	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void DataOp_DIFF::ApplyElementwise(
+	const SimpleGrid & grid,
+	size_t sBegin,
+	size_t sCount,
+	int nArgs,
+	const float * const * pArgData,
+	float * pOut
+) const {
+	KernelDiff(sCount, pArgData[0], pArgData[1], pOut);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// DataOp_DIV
+///////////////////////////////////////////////////////////////////////////////
+
+const char * DataOp_DIV::name = "_DIV";
 
-	const DataVector<float> & dataLeft  = *(vecArgData[0]);
-	const DataVector<float> & dataRight = *(vecArgData[1]);
+///////////////////////////////////////////////////////////////////////////////
 
-	for (int i = 0; i < dataout.GetRows(); i++) {
-		dataout[i] = dataLeft[i] / dataRight[i];
+void DataOp_DIV::CheckArguments(
+	int nArgs
+) const {
+	if (nArgs != 2) {
+		_EXCEPTION2("%s expects two arguments: %i given",
+			m_strName.c_str(), nArgs);
 	}
+}
 
-	return true;
+///////////////////////////////////////////////////////////////////////////////
+
+void DataOp_DIV::ApplyElementwise(
+	const SimpleGrid & grid,
+	size_t sBegin,
+	size_t sCount,
+	int nArgs,
+	const float * const * pArgData,
+	float * pOut
+) const {
+	KernelDiv(sCount, pArgData[0], pArgData[1], pOut);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -335,22 +417,37 @@ const char * DataOp_LAT::name = "_LAT";
 
 ///////////////////////////////////////////////////////////////////////////////
 
-bool DataOp_LAT::Apply(
-	const SimpleGrid & grid,
-	const std::vector<std::string> & strArg,
-	const std::vector<DataVector<float> const *> & vecArgData,
-	DataVector<float> & dataout
-) {
-	if (strArg.size() != 0) {
+void DataOp_LAT::CheckArguments(
+	int nArgs
+) const {
+	if (nArgs != 0) {
 		_EXCEPTION2("%s expects zero arguments: %i given",
-			m_strName.c_str(), strArg.size());
+			m_strName.c_str(), nArgs);
 	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
 
-	for (int i = 0; i < dataout.GetRows(); i++) {
-		dataout[i] = grid.m_dLat[i] * 180.0 / M_PI;
+void DataOp_LAT::ApplyElementwise(
+	const SimpleGrid & grid,
+	size_t sBegin,
+	size_t sCount,
+	int nArgs,
+	const float * const * pArgData,
+	float * pOut
+) const {
+	// Compute latitudes once per grid
+	if ((m_sCoefficientStamp != grid.GetCoordinateStamp()) ||
+	    (m_dataCoefficient.GetRows() != grid.GetSize())
+	) {
+		m_dataCoefficient.Initialize(grid.GetSize());
+		for (size_t i = 0; i < grid.GetSize(); i++) {
+			m_dataCoefficient[i] = grid.m_dLat[i] * 180.0 / M_PI;
+		}
+		m_sCoefficientStamp = grid.GetCoordinateStamp();
 	}
 
-	return true;
+	memcpy(pOut, &(m_dataCoefficient[sBegin]), sCount * sizeof(float));
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -361,24 +458,39 @@ const char * DataOp_F::name = "_F";
 
 ///////////////////////////////////////////////////////////////////////////////
 
-bool DataOp_F::Apply(
-	const SimpleGrid & grid,
-	const std::vector<std::string> & strArg,
-	const std::vector<DataVector<float> const *> & vecArgData,
-	DataVector<float> & dataout
-) {
-	static const double Omega = 7.2921e-5;
-
-	if (strArg.size() != 0) {
+void DataOp_F::CheckArguments(
+	int nArgs
+) const {
+	if (nArgs != 0) {
 		_EXCEPTION2("%s expects zero arguments: %i given",
-			m_strName.c_str(), strArg.size());
+			m_strName.c_str(), nArgs);
 	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
 
-	for (int i = 0; i < dataout.GetRows(); i++) {
-		dataout[i] = 2.0 * Omega * sin(grid.m_dLat[i]);
+void DataOp_F::ApplyElementwise(
+	const SimpleGrid & grid,
+	size_t sBegin,
+	size_t sCount,
+	int nArgs,
+	const float * const * pArgData,
+	float * pOut
+) const {
+	static const double Omega = 7.2921e-5;
+
+	// Compute the Coriolis parameter once per grid
+	if ((m_sCoefficientStamp != grid.GetCoordinateStamp()) ||
+	    (m_dataCoefficient.GetRows() != grid.GetSize())
+	) {
+		m_dataCoefficient.Initialize(grid.GetSize());
+		for (size_t i = 0; i < grid.GetSize(); i++) {
+			m_dataCoefficient[i] = 2.0 * Omega * sin(grid.m_dLat[i]);
+		}
+		m_sCoefficientStamp = grid.GetCoordinateStamp();
 	}
 
-	return true;
+	memcpy(pOut, &(m_dataCoefficient[sBegin]), sCount * sizeof(float));
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -482,8 +594,22 @@ void GenerateEqualDistanceSpherePoints(
 
 ///////////////////////////////////////////////////////////////////////////////
 
+///	<summary>
+///		Maximum number of non-zero entries in a sparse operator.  This is
+///		well below INT_MAX, the limit of the int offsets of SparseMatrixCSR,
+///		and bounds the memory used by the operator and the thread-local
+///		buffers used to build it to a few GB.
+///	</summary>
+static const size_t MaxSparseOperatorNonZeros =
+	static_cast<size_t>(256) * 1024 * 1024;
+
+///////////////////////////////////////////////////////////////////////////////
+
 ///	<summary>
 ///		Build a sparse Laplacian operator on an unstructured SimpleGrid.
+///		Rows are constructed in parallel into thread-local buffers and
+///		then merged into compressed sparse row form, so the result does
+///		not depend on the number of threads.
 ///	</summary>
 ///	<param name="dLaplacianDist">
 ///		Great circle radius of the Laplacian operator, in degrees.
@@ -492,43 +618,70 @@ void BuildLaplacianOperator(
 	const SimpleGrid & grid,
 	int nLaplacianPoints,
 	double dLaplacianDist,
-	SparseMatrix<float> & opLaplacian
+	SparseMatrixCSR<float> & opLaplacianCSR
 ) {
-	opLaplacian.Clear();
-
-	int iRef = 0;
+	const int nGridSize = static_cast<int>(grid.GetSize());
 
 	// Scaling factor used in Laplacian calculation
 	const double dScale = 4.0 / static_cast<double>(nLaplacianPoints);
 
-	// Create a kdtree with all nodes in grid
-	kdtree * kdGrid = kd_create(3);
-	if (kdGrid == NULL) {
-		_EXCEPTIONT("Error creating kdtree");
-	}
-
-	DataVector<double> dXi(grid.GetSize());
-	DataVector<double> dYi(grid.GetSize());
-	DataVector<double> dZi(grid.GetSize());
-	for (int i = 0; i < grid.GetSize(); i++) {
+	// Cartesian coordinates of all nodes in grid
+	DataVector<double> dXi(nGridSize);
+	DataVector<double> dYi(nGridSize);
+	DataVector<double> dZi(nGridSize);
+	for (int i = 0; i < nGridSize; i++) {
 		double dLat = grid.m_dLat[i];
 		double dLon = grid.m_dLon[i];
 
 		dXi[i] = cos(dLon) * cos(dLat);
 		dYi[i] = sin(dLon) * cos(dLat);
 		dZi[i] = sin(dLat);
+	}
 
-		kd_insert3(kdGrid, dXi[i], dYi[i], dZi[i], (void*)((&iRef)+i));
+	// Verify the operator can be stored (each row has at most one entry
+	// for each point and one for the center point)
+	size_t sMaxNonZeros =
+		static_cast<size_t>(nGridSize)
+		* static_cast<size_t>(nLaplacianPoints + 1);
+
+	if (sMaxNonZeros > MaxSparseOperatorNonZeros) {
+		_EXCEPTION4("Laplacian operator with %i points on %i nodes may"
+			" require %lu non-zero entries, exceeding the maximum of %lu;"
+			" reduce the number of points",
+			nLaplacianPoints, nGridSize,
+			static_cast<unsigned long>(sMaxNonZeros),
+			static_cast<unsigned long>(MaxSparseOperatorNonZeros));
 	}
 
-	// Construct the Laplacian operator using SPH
-	for (int i = 0; i < grid.GetSize(); i++) {
+	// Create a kdtree with all nodes in grid
+	SphericalKDTree kdGrid;
+	kdGrid.Build(nGridSize, dXi, dYi, dZi);
+
+	// Number of non-zero entries in each row
+	std::vector<int> vecRowNonZeros(nGridSize, 0);
+
+	// Exceptions raised by worker threads
+	std::vector<Exception> vecErrors;
 
-		// Generate points for the Laplacian
-		std::vector<double> dXout;
-		std::vector<double> dYout;
-		std::vector<double> dZout;
+#pragma omp parallel
+{
+	// Rows constructed by this thread and their entries, in row order
+	std::vector<int> vecThreadRows;
+	std::vector<int> vecThreadCols;
+	std::vector<float> vecThreadEntries;
 
+	// Points for the Laplacian
+	std::vector<double> dXout;
+	std::vector<double> dYout;
+	std::vector<double> dZout;
+
+	// Entries of the current row
+	std::vector< std::pair<int, float> > vecRow;
+
+	// Construct the Laplacian operator using SPH
+#pragma omp for schedule(dynamic, 64)
+	for (int i = 0; i < nGridSize; i++) {
+	try {
 		GenerateEqualDistanceSpherePoints(
 			dXi[i], dYi[i], dZi[i],
 			nLaplacianPoints,
@@ -538,82 +691,34 @@ void BuildLaplacianOperator(
 		dXout.push_back(dXi[i]);
 		dYout.push_back(dYi[i]);
 		dZout.push_back(dZi[i]);
-/*
-		kdres * kdr = kd_nearest_range3(kdGrid, dXi[i], dYi[i], dZi[i], dMaxDist);
-		if (kdr == NULL) {
-			_EXCEPTIONT("Error in kd_nearest_range3");
-		}
-		int nNodes = kd_res_size(kdr);
 
-		std::cout << nNodes << " found at distance " << dMaxDist << std::endl;
-*/
-		//std::vector<int> vecCols;
-		//std::vector<double> vecWeight;
-		std::set<int> setPoints;
-		setPoints.insert(i);
+		vecRow.clear();
 
 		double dAccumulatedDiff = 0.0;
 
 		for (int j = 0; j < dXout.size(); j++) {
 			// Find the nearest grid point to the output point
-			kdres * kdr = kd_nearest3(kdGrid, dXout[j], dYout[j], dZout[j]);
-			if (kdr == NULL) {
-				_EXCEPTIONT("NULL return value in call to kd_nearest3");
-			}
-
-			void* pData = kd_res_item_data(kdr);
-			if (pData == NULL) {
-				_EXCEPTIONT("NULL data index");
-			}
-			int k = ((int*)(pData)) - (&iRef);
-
-			kd_res_free(kdr);
+			int k = kdGrid.Nearest(dXout[j], dYout[j], dZout[j]);
 
 			if (k == i) {
 				continue;
 			}
 
-			if (k > dXi.GetRows()) {
+			if ((k < 0) || (k >= nGridSize)) {
 				_EXCEPTIONT("Invalid point index");
 			}
 
 			// Ensure points are not duplicated
-			if (setPoints.find(k) != setPoints.end()) {
+			bool fDuplicate = false;
+			for (int l = 0; l < vecRow.size(); l++) {
+				if (vecRow[l].first == k) {
+					fDuplicate = true;
+					break;
+				}
+			}
+			if (fDuplicate) {
 				continue;
-			} else {
-				setPoints.insert(k);
 			}
-	/*
-			// ============== BEGIN DEBUGGING =============================
-			double dLon0 = atan2(dYi[i], dXi[i]) * 180.0 / M_PI;
-			double dLat0 = asin(dZi[i]) * 180.0 / M_PI;
-
-			double dLon1 = atan2(dYout[j], dXout[j]) * 180.0 / M_PI;
-			double dLat1 = asin(dZout[j]) * 180.0 / M_PI;
-
-			double dDist0 =
-				sqrt(
-					(dXout[j] - dXi[i]) * (dXout[j] - dXi[i])
-					+ (dYout[j] - dYi[i]) * (dYout[j] - dYi[i])
-					+ (dZout[j] - dZi[i]) * (dZout[j] - dZi[i]));
-
-			std::cout << 2.0 * sin(dDist0 / 2.0) * 180.0 / M_PI << std::endl;
-
-			double dDist1 =
-				sqrt(
-					(dXi[k] - dXi[i]) * (dXi[k] - dXi[i])
-					+ (dYi[k] - dYi[i]) * (dYi[k] - dYi[i])
-					+ (dZi[k] - dZi[i]) * (dZi[k] - dZi[i]));
-
-			std::cout << 2.0 * sin(dDist1 / 2.0) * 180.0 / M_PI << std::endl;
-
-			double dLon2 = atan2(dYi[k], dXi[k]) * 180.0 / M_PI;
-			double dLat2 = asin(dZi[k]) * 180.0 / M_PI;
-
-			printf("XY: %1.3f %1.3f :: %1.3f %1.3f :: %1.3f %1.3f\n", dXi[i], dYi[i], dXout[j], dYout[j], dXi[k], dYi[k]);
-			printf("LL: %1.2f %1.2f :: %1.2f %1.2f\n", dLon0, dLat0, dLon1, dLat1);
-			// ============== END DEBUGGING =============================
-*/
 
 			double dX1 = dXi[k] - dXi[i];
 			double dY1 = dYi[k] - dYi[i];
@@ -624,81 +729,983 @@ void BuildLaplacianOperator(
 			double dSurfDist2 = 2.0 * asin(0.5 * sqrt(dChordDist2));
 			dSurfDist2 *= dSurfDist2;
 
-			//double dTanDist2 = (2.0 - dChordDist2);
-			//dTanDist2 = dChordDist2 * (4.0 - dChordDist2) / (dTanDist2 * dTanDist2);
+			vecRow.push_back(
+				std::pair<int, float>(
+					k, static_cast<float>(dScale / dSurfDist2)));
+
+			dAccumulatedDiff += dScale / dSurfDist2;
+		}
 
-			opLaplacian(i,k) = static_cast<float>(dScale / dSurfDist2);
+		vecRow.push_back(
+			std::pair<int, float>(
+				i, static_cast<float>(- dAccumulatedDiff)));
 
-			//printf("(%1.2e %1.2e %1.2e) (%1.2e %1.2e %1.2e) %1.5e\n", dXout[j], dYout[j], dZout[j], dXi[k], dYi[k], dZi[k], dSurfDist2 * 180.0 / M_PI);
-			//printf("%1.5e %i %i %1.5e\n", sqrt(dSurfDist2) * 180.0 / M_PI, i, k, opLaplacian(i,k));
+		// Store the row sorted by column index
+		std::sort(vecRow.begin(), vecRow.end());
 
-			dAccumulatedDiff += dScale / dSurfDist2;
+		vecThreadRows.push_back(i);
+		for (int l = 0; l < vecRow.size(); l++) {
+			vecThreadCols.push_back(vecRow[l].first);
+			vecThreadEntries.push_back(vecRow[l].second);
 		}
+		vecRowNonZeros[i] = static_cast<int>(vecRow.size());
+
+	} catch(Exception & e) {
+#pragma omp critical
+		vecErrors.push_back(e);
+	}
+	}
 
-		opLaplacian(i,i) = static_cast<float>(- dAccumulatedDiff);
+	// Allocate the operator once all row sizes are known
+#pragma omp single
+{
+	size_t sNonZeros = 0;
+	for (int i = 0; i < nGridSize; i++) {
+		sNonZeros += static_cast<size_t>(vecRowNonZeros[i]);
+	}
 
-		//printf("%i %i %1.5e\n", i, i, opLaplacian(i,i));
+	opLaplacianCSR.Allocate(
+		nGridSize, nGridSize, static_cast<int>(sNonZeros));
 
-		if (setPoints.size() < 5) {
-			Announce("WARNING: Only %i points used for Laplacian in cell %i"
-				" -- accuracy may be affected", setPoints.size(), i);
+	DataVector<int> & vecRowOffsets = opLaplacianCSR.GetRowOffsets();
+	for (int i = 0; i < nGridSize; i++) {
+		vecRowOffsets[i+1] = vecRowOffsets[i] + vecRowNonZeros[i];
+	}
+}
+
+	// Merge thread-local rows into the operator
+	DataVector<int> & vecRowOffsets = opLaplacianCSR.GetRowOffsets();
+	DataVector<int> & vecColIndices = opLaplacianCSR.GetColIndices();
+	DataVector<float> & vecEntries = opLaplacianCSR.GetEntries();
+
+	int ixThread = 0;
+	for (int r = 0; r < vecThreadRows.size(); r++) {
+		int i = vecThreadRows[r];
+		int ixRow = vecRowOffsets[i];
+		for (int l = 0; l < vecRowNonZeros[i]; l++) {
+			vecColIndices[ixRow + l] = vecThreadCols[ixThread];
+			vecEntries[ixRow + l] = vecThreadEntries[ixThread];
+			ixThread++;
 		}
 	}
-/*
-	for (
-		SparseMatrix<double>::SparseMapIterator iter = opLaplacian.begin();
-		iter != opLaplacian.end(); iter++
-	) {
-		std::cout << iter->first.first << " " << iter->first.second << " " << iter->second << std::endl;
+}
+
+	if (vecErrors.size() != 0) {
+		opLaplacianCSR.Clear();
+		throw vecErrors[0];
+	}
+
+	// Report sparsely populated rows
+	for (int i = 0; i < nGridSize; i++) {
+		if (vecRowNonZeros[i] < 5) {
+			Announce("WARNING: Only %i points used for Laplacian in cell %i"
+				" -- accuracy may be affected", vecRowNonZeros[i], i);
+		}
 	}
-*/
-	kd_free(kdGrid);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
-DataOp_LAPLACIAN::DataOp_LAPLACIAN(
-	const std::string & strName,
-	int nLaplacianPoints,
-	double dLaplacianDist
-) :
-	DataOp(strName),
-	m_nLaplacianPoints(nLaplacianPoints),
-	m_dLaplacianDist(dLaplacianDist),
-	m_fInitialized(false)
-{ }
+///	<summary>
+///		Environment variable specifying the directory where sparse
+///		operators are cached between runs.  If unset no cache is used.
+///	</summary>
+static const char * OperatorCacheDirEnvVar = "TEMPESTEXTREMES_CACHE_DIR";
 
-///////////////////////////////////////////////////////////////////////////////
+///	<summary>
+///		Magic string identifying a cached Laplacian operator.
+///	</summary>
+static const char LaplacianCacheMagic[8] = {'T','E','M','P','L','A','P','L'};
 
-bool DataOp_LAPLACIAN::Apply(
-	const SimpleGrid & grid,
-	const std::vector<std::string> & strArg,
-	const std::vector<DataVector<float> const *> & vecArgData,
-	DataVector<float> & dataout
-) {
-	if (strArg.size() != 1) {
-		_EXCEPTION2("%s expects one argument: %i given",
-			m_strName.c_str(), strArg.size());
-	}
-	if (vecArgData[0] == NULL) {
-		_EXCEPTION1("Arguments to %s must be data variables",
-			m_strName.c_str());
-	}
+///	<summary>
+///		Version of the cached Laplacian operator format.  Increment when
+///		the construction of the operator changes.  Version 2 selects
+///		neighbors with SphericalKDTree, which breaks distance ties towards
+///		the smallest node index.
+///	</summary>
+static const int32_t LaplacianCacheVersion = 2;
 
-	if (!m_fInitialized) {
-		Announce("Building Laplacian operator %s (%i, %1.2f)",
-			m_strName.c_str(), m_nLaplacianPoints, m_dLaplacianDist);
+namespace {
 
-		BuildLaplacianOperator(
-			grid,
-			m_nLaplacianPoints,
-			m_dLaplacianDist,
-			m_opLaplacian);
+///	<summary>
+///		Header of a cached sparse operator file.  The meaning of the
+///		integer and floating point parameters depends on the operator.
+///	</summary>
+struct OperatorCacheHeader {
+	char szMagic[8];
+	int32_t iVersion;
+	int32_t iParam;
+	double dParam;
+	int64_t nGridSize;
+	uint64_t uGridHash;
+};
 
-		m_fInitialized = true;
-	}
+}
 
-	m_opLaplacian.Apply(*(vecArgData[0]), dataout);
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		Compute a 64-bit FNV-1a hash of the grid coordinates.
+///	</summary>
+static uint64_t HashGridCoordinates(
+	const SimpleGrid & grid
+) {
+	uint64_t uHash = 14695981039346656037ULL;
+
+	const unsigned char * pBytes[2];
+	pBytes[0] = reinterpret_cast<const unsigned char *>(&(grid.m_dLon[0]));
+	pBytes[1] = reinterpret_cast<const unsigned char *>(&(grid.m_dLat[0]));
+
+	size_t sBytes = grid.GetSize() * sizeof(double);
+	for (int d = 0; d < 2; d++) {
+		for (size_t s = 0; s < sBytes; s++) {
+			uHash ^= static_cast<uint64_t>(pBytes[d][s]);
+			uHash *= 1099511628211ULL;
+		}
+	}
+
+	return uHash;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		Get the filename of the cached sparse operator for this grid
+///		and set of parameters, or an empty string if caching is disabled.
+///	</summary>
+///	<param name="szPrefix">
+///		Prefix of the cache filename identifying the type of operator.
+///	</param>
+static std::string GetOperatorCacheFilename(
+	const SimpleGrid & grid,
+	const char * szPrefix,
+	const char szMagic[8],
+	int32_t iVersion,
+	int iParam,
+	double dParam,
+	OperatorCacheHeader & header
+) {
+	memset(&header, 0, sizeof(OperatorCacheHeader));
+	memcpy(header.szMagic, szMagic, sizeof(header.szMagic));
+	header.iVersion = iVersion;
+	header.iParam = iParam;
+	header.dParam = dParam;
+	header.nGridSize = static_cast<int64_t>(grid.GetSize());
+
+	const char * szCacheDir = getenv(OperatorCacheDirEnvVar);
+	if ((szCacheDir == NULL) || (szCacheDir[0] == '\0')) {
+		return std::string("");
+	}
+
+	header.uGridHash = HashGridCoordinates(grid);
+
+	// Hash the parameters into the key as well
+	uint64_t uKey = header.uGridHash;
+	const unsigned char * pParam =
+		reinterpret_cast<const unsigned char *>(&(header.iVersion));
+	size_t sParamBytes =
+		sizeof(int32_t) + sizeof(int32_t) + sizeof(double);
+	for (size_t s = 0; s < sParamBytes; s++) {
+		uKey ^= static_cast<uint64_t>(pParam[s]);
+		uKey *= 1099511628211ULL;
+	}
+
+	char szFilename[64];
+	snprintf(szFilename, 64, "%s_%016llx.dat",
+		szPrefix, static_cast<unsigned long long>(uKey));
+
+	std::string strCacheDir(szCacheDir);
+	if (strCacheDir[strCacheDir.length()-1] != '/') {
+		strCacheDir += "/";
+	}
+	return (strCacheDir + szFilename);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		Attempt to load a cached sparse operator.  Returns false if
+///		the cache file is missing or does not match the expected header.
+///	</summary>
+static bool LoadOperatorFromCache(
+	const std::string & strCacheFile,
+	const OperatorCacheHeader & headerExpected,
+	SparseMatrixCSR<float> & opCSR
+) {
+	FILE * fp = fopen(strCacheFile.c_str(), "rb");
+	if (fp == NULL) {
+		return false;
+	}
+
+	OperatorCacheHeader header;
+	bool fSuccess =
+		(fread(&header, sizeof(OperatorCacheHeader), 1, fp) == 1)
+		&& (memcmp(&header, &headerExpected, sizeof(OperatorCacheHeader)) == 0)
+		&& opCSR.Read(fp)
+		&& (opCSR.GetRows() == headerExpected.nGridSize)
+		&& (opCSR.GetColumns() == headerExpected.nGridSize);
+
+	fclose(fp);
+
+	if (!fSuccess) {
+		opCSR.Clear();
+	}
+	return fSuccess;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		Write a sparse operator to the cache.  The file is written
+///		under a temporary name and renamed into place so that concurrent
+///		processes never observe a partially written cache file.
+///	</summary>
+static void SaveOperatorToCache(
+	const std::string & strCacheFile,
+	const OperatorCacheHeader & header,
+	const SparseMatrixCSR<float> & opCSR
+) {
+	char szSuffix[32];
+	snprintf(szSuffix, 32, ".tmp%i", static_cast<int>(getpid()));
+	std::string strTempFile = strCacheFile + szSuffix;
+
+	FILE * fp = fopen(strTempFile.c_str(), "wb");
+	if (fp == NULL) {
+		Announce("WARNING: Unable to write operator cache file \"%s\"",
+			strCacheFile.c_str());
+		return;
+	}
+
+	bool fSuccess =
+		(fwrite(&header, sizeof(OperatorCacheHeader), 1, fp) == 1)
+		&& opCSR.Write(fp);
+
+	if (fclose(fp) != 0) {
+		fSuccess = false;
+	}
+	if (fSuccess) {
+		fSuccess = (rename(strTempFile.c_str(), strCacheFile.c_str()) == 0);
+	}
+	if (!fSuccess) {
+		remove(strTempFile.c_str());
+		Announce("WARNING: Unable to write operator cache file \"%s\"",
+			strCacheFile.c_str());
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+DataOp_LAPLACIAN::DataOp_LAPLACIAN(
+	const std::string & strName,
+	int nLaplacianPoints,
+	double dLaplacianDist
+) :
+	DataOp(strName),
+	m_nLaplacianPoints(nLaplacianPoints),
+	m_dLaplacianDist(dLaplacianDist),
+	m_fInitialized(false)
+{ }
+
+///////////////////////////////////////////////////////////////////////////////
+
+void DataOp_LAPLACIAN::Initialize(
+	const SimpleGrid & grid,
+	const std::vector<std::string> & strArg,
+	const std::vector<DataVector<float> const *> & vecArgData
+) {
+	if (strArg.size() != 1) {
+		_EXCEPTION2("%s expects one argument: %i given",
+			m_strName.c_str(), strArg.size());
+	}
+	if (vecArgData[0] == NULL) {
+		_EXCEPTION1("Arguments to %s must be data variables",
+			m_strName.c_str());
+	}
+
+	if (!m_fInitialized) {
+		OperatorCacheHeader header;
+		std::string strCacheFile =
+			GetOperatorCacheFilename(
+				grid,
+				"laplacian",
+				LaplacianCacheMagic,
+				LaplacianCacheVersion,
+				m_nLaplacianPoints,
+				m_dLaplacianDist,
+				header);
+
+		if ((strCacheFile != "") &&
+		    LoadOperatorFromCache(strCacheFile, header, m_opLaplacian)
+		) {
+			Announce("Loaded Laplacian operator %s (%i, %1.2f) from \"%s\"",
+				m_strName.c_str(), m_nLaplacianPoints, m_dLaplacianDist,
+				strCacheFile.c_str());
+
+		} else {
+			Announce("Building Laplacian operator %s (%i, %1.2f)",
+				m_strName.c_str(), m_nLaplacianPoints, m_dLaplacianDist);
+
+			BuildLaplacianOperator(
+				grid,
+				m_nLaplacianPoints,
+				m_dLaplacianDist,
+				m_opLaplacian);
+
+			if (strCacheFile != "") {
+				SaveOperatorToCache(
+					strCacheFile, header, m_opLaplacian);
+			}
+		}
+
+		m_fInitialized = true;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool DataOp_LAPLACIAN::Apply(
+	const SimpleGrid & grid,
+	const std::vector<std::string> & strArg,
+	const std::vector<DataVector<float> const *> & vecArgData,
+	DataVector<float> & dataout
+) {
+	Initialize(grid, strArg, vecArgData);
+
+	m_opLaplacian.Apply(*(vecArgData[0]), dataout);
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool DataOp_LAPLACIAN::ApplyOnNodes(
+	const SimpleGrid & grid,
+	const std::vector<std::string> & strArg,
+	const std::vector<DataVector<float> const *> & vecArgData,
+	const std::vector<int> & vecNodes,
+	DataVector<float> & dataout
+) {
+	Initialize(grid, strArg, vecArgData);
+
+	m_opLaplacian.ApplyOnRows(*(vecArgData[0]), vecNodes, dataout);
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// DataOp_MEAN
+///////////////////////////////////////////////////////////////////////////////
+
+const char * DataOp_MEAN::name = "_MEAN";
+
+///	<summary>
+///		Magic string identifying a cached mean operator.
+///	</summary>
+static const char MeanCacheMagic[8] = {'T','E','M','P','M','E','A','N'};
+
+///	<summary>
+///		Version of the cached mean operator format.  Increment when
+///		the construction of the operator changes.
+///	</summary>
+static const int32_t MeanCacheVersion = 1;
+
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		Build the stencil of the mean operator on a regular
+///		longitude-latitude grid.  For each latitude j0, the stencil lists
+///		each latitude j containing points within dDist of a point on j0,
+///		along with the number of longitudes west and east of the center
+///		longitude that are within dDist.  Returns false if the grid is not
+///		a longitude-latitude grid with uniform longitude spacing, or is a
+///		regional grid spanning 180 degrees of longitude or more.
+///	</summary>
+bool BuildLatLonMeanStencil(
+	const SimpleGrid & grid,
+	double dDist,
+	bool & fPeriodic,
+	std::vector<int> & vecStencilBegin,
+	std::vector<int> & vecStencilLat,
+	std::vector<int> & vecStencilWest,
+	std::vector<int> & vecStencilEast
+) {
+	if (grid.m_nGridDim.size() != 2) {
+		return false;
+	}
+
+	const int nLat = static_cast<int>(grid.m_nGridDim[0]);
+	const int nLon = static_cast<int>(grid.m_nGridDim[1]);
+
+	if ((nLon < 3) ||
+	    (static_cast<size_t>(nLat) * static_cast<size_t>(nLon) != grid.GetSize())
+	) {
+		return false;
+	}
+
+	// Verify longitudes are uniformly spaced
+	const double dDeltaLon = grid.m_dLon[1] - grid.m_dLon[0];
+	for (int i = 1; i < nLon; i++) {
+		double dDelta = grid.m_dLon[i] - grid.m_dLon[i-1];
+		if (fabs(dDelta - dDeltaLon) > 1.0e-6 * fabs(dDeltaLon)) {
+			return false;
+		}
+	}
+
+	// The grid is periodic if the first and last longitudes are connected
+	fPeriodic = false;
+	const SimpleGrid::NeighborRange neighbors = grid.GetNeighbors(0);
+	for (int n = 0; n < neighbors.size(); n++) {
+		if (neighbors[n] == nLon-1) {
+			fPeriodic = true;
+		}
+	}
+
+	// Points within the distance must form a contiguous range of
+	// longitudes on each latitude.  This holds if a periodic grid spans
+	// exactly 360 degrees or a regional grid spans less than 180 degrees.
+	const double dSpan = fabs(dDeltaLon) * static_cast<double>(nLon);
+	if (fPeriodic) {
+		if (fabs(dSpan - 2.0 * M_PI) > 1.0e-6) {
+			return false;
+		}
+	} else {
+		if (dSpan - fabs(dDeltaLon) >= M_PI) {
+			return false;
+		}
+	}
+
+	const SimpleGrid::DistanceThreshold distMax(dDist);
+
+	vecStencilBegin.resize(nLat+1);
+	vecStencilLat.clear();
+	vecStencilWest.clear();
+	vecStencilEast.clear();
+
+	for (int j0 = 0; j0 < nLat; j0++) {
+		vecStencilBegin[j0] = static_cast<int>(vecStencilLat.size());
+
+		const int ixEast0 = j0 * nLon;
+		const int ixWest0 = j0 * nLon + nLon - 1;
+
+		for (int j = 0; j < nLat; j++) {
+
+			// The nearest point on each latitude is at the same longitude
+			if (!grid.IsWithinDistance(ixEast0, j * nLon, distMax)) {
+				continue;
+			}
+
+			int nEast = 0;
+			while ((nEast < nLon-1) &&
+			       grid.IsWithinDistance(
+			           ixEast0, j * nLon + nEast + 1, distMax)
+			) {
+				nEast++;
+			}
+
+			int nWest = 0;
+			if (fPeriodic) {
+				while ((nWest < nLon-1-nEast) &&
+				       grid.IsWithinDistance(
+				           ixEast0, j * nLon + nLon - nWest - 1, distMax)
+				) {
+					nWest++;
+				}
+
+			} else {
+				while ((nWest < nLon-1) &&
+				       grid.IsWithinDistance(
+				           ixWest0, j * nLon + nLon - nWest - 2, distMax)
+				) {
+					nWest++;
+				}
+			}
+
+			vecStencilLat.push_back(j);
+			vecStencilWest.push_back(nWest);
+			vecStencilEast.push_back(nEast);
+		}
+	}
+
+	vecStencilBegin[nLat] = static_cast<int>(vecStencilLat.size());
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		Evaluate the mean at node (j0, i0) of a regular longitude-latitude
+///		grid from the running sums along each latitude.
+///	</summary>
+inline float LatLonMeanAtNode(
+	int nLon,
+	bool fPeriodic,
+	const std::vector<int> & vecStencilBegin,
+	const std::vector<int> & vecStencilLat,
+	const std::vector<int> & vecStencilWest,
+	const std::vector<int> & vecStencilEast,
+	const std::vector<double> & vecRunningSum,
+	int j0,
+	int i0
+) {
+	double dSum = 0.0;
+	int nCount = 0;
+
+	for (int s = vecStencilBegin[j0]; s < vecStencilBegin[j0+1]; s++) {
+		const double * dRowSum =
+			&(vecRunningSum[
+				static_cast<size_t>(vecStencilLat[s]) * (nLon + 1)]);
+
+		int iWest = i0 - vecStencilWest[s];
+		int iEast = i0 + vecStencilEast[s];
+
+		if (fPeriodic) {
+			if (iEast - iWest + 1 >= nLon) {
+				dSum += dRowSum[nLon];
+				nCount += nLon;
+				continue;
+			}
+			if (iWest < 0) {
+				dSum += dRowSum[iEast+1]
+					+ (dRowSum[nLon] - dRowSum[nLon + iWest]);
+			} else if (iEast >= nLon) {
+				dSum += (dRowSum[nLon] - dRowSum[iWest])
+					+ dRowSum[iEast - nLon + 1];
+			} else {
+				dSum += dRowSum[iEast+1] - dRowSum[iWest];
+			}
+
+		} else {
+			iWest = std::max(iWest, 0);
+			iEast = std::min(iEast, nLon-1);
+
+			dSum += dRowSum[iEast+1] - dRowSum[iWest];
+		}
+
+		nCount += iEast - iWest + 1;
+	}
+
+	return static_cast<float>(dSum / static_cast<double>(nCount));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		Apply the mean operator on a regular longitude-latitude grid using
+///		running sums along each latitude.  If pvecNodes is not NULL the
+///		mean is only evaluated on the given nodes, and running sums are
+///		only computed on the latitudes these nodes depend on.
+///	</summary>
+void ApplyLatLonMean(
+	const SimpleGrid & grid,
+	bool fPeriodic,
+	const std::vector<int> & vecStencilBegin,
+	const std::vector<int> & vecStencilLat,
+	const std::vector<int> & vecStencilWest,
+	const std::vector<int> & vecStencilEast,
+	const DataVector<float> & dataIn,
+	const std::vector<int> * pvecNodes,
+	DataVector<float> & dataOut
+) {
+	const int nLat = static_cast<int>(grid.m_nGridDim[0]);
+	const int nLon = static_cast<int>(grid.m_nGridDim[1]);
+
+	// Latitudes on which running sums are needed
+	std::vector<char> vecLatNeeded(nLat, (pvecNodes == NULL)?(1):(0));
+	if (pvecNodes != NULL) {
+		std::vector<char> vecCenterLat(nLat, 0);
+		for (int n = 0; n < pvecNodes->size(); n++) {
+			vecCenterLat[(*pvecNodes)[n] / nLon] = 1;
+		}
+		for (int j0 = 0; j0 < nLat; j0++) {
+			if (!vecCenterLat[j0]) {
+				continue;
+			}
+			for (int s = vecStencilBegin[j0]; s < vecStencilBegin[j0+1]; s++) {
+				vecLatNeeded[vecStencilLat[s]] = 1;
+			}
+		}
+	}
+
+	// Running sums along each latitude
+	std::vector<double> vecRunningSum(
+		static_cast<size_t>(nLat) * static_cast<size_t>(nLon + 1));
+
+#pragma omp parallel for schedule(static)
+	for (int j = 0; j < nLat; j++) {
+		if (!vecLatNeeded[j]) {
+			continue;
+		}
+
+		double * dSum = &(vecRunningSum[static_cast<size_t>(j) * (nLon + 1)]);
+		const float * dData = &(dataIn[static_cast<size_t>(j) * nLon]);
+
+		dSum[0] = 0.0;
+		for (int i = 0; i < nLon; i++) {
+			dSum[i+1] = dSum[i] + static_cast<double>(dData[i]);
+		}
+	}
+
+	// Evaluate the mean on the given nodes
+	if (pvecNodes != NULL) {
+		const int nNodes = static_cast<int>(pvecNodes->size());
+
+#pragma omp parallel for schedule(static)
+		for (int n = 0; n < nNodes; n++) {
+			const int ix = (*pvecNodes)[n];
+			dataOut[ix] =
+				LatLonMeanAtNode(
+					nLon, fPeriodic,
+					vecStencilBegin, vecStencilLat,
+					vecStencilWest, vecStencilEast,
+					vecRunningSum, ix / nLon, ix % nLon);
+		}
+		return;
+	}
+
+	// Evaluate the mean on all nodes
+#pragma omp parallel for schedule(static)
+	for (int j0 = 0; j0 < nLat; j0++) {
+	for (int i0 = 0; i0 < nLon; i0++) {
+		dataOut[static_cast<size_t>(j0) * nLon + i0] =
+			LatLonMeanAtNode(
+				nLon, fPeriodic,
+				vecStencilBegin, vecStencilLat,
+				vecStencilWest, vecStencilEast,
+				vecRunningSum, j0, i0);
+	}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		Find all points connected to point i through points within the
+///		given distance, sorted by index.
+///	</summary>
+static void FindMeanStencil(
+	const SimpleGrid & grid,
+	const SimpleGrid::DistanceThreshold & distMax,
+	int i,
+	std::vector<int> & vecRow
+) {
+	vecRow.clear();
+
+	GraphSearchWorkspace & ws = GraphSearchWorkspace::GetForThread();
+	ws.Begin(grid.GetSize(), i);
+
+	while (!ws.Empty()) {
+		int ix = ws.Pop();
+
+		if (!grid.IsWithinDistance(i, ix, distMax)) {
+			continue;
+		}
+
+		vecRow.push_back(ix);
+
+		const SimpleGrid::NeighborRange neighbors = grid.GetNeighbors(ix);
+		for (int n = 0; n < neighbors.size(); n++) {
+			ws.Visit(neighbors[n]);
+		}
+	}
+
+	std::sort(vecRow.begin(), vecRow.end());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		Build a sparse mean operator on an unstructured SimpleGrid, where
+///		each row averages over all points connected to the center point
+///		through points within dDist.  Rows are constructed in parallel
+///		into thread-local buffers and then merged into compressed sparse
+///		row form, so the result does not depend on the number of threads.
+///		Returns false, leaving opMeanCSR empty, if the operator would
+///		have more than MaxSparseOperatorNonZeros entries.
+///	</summary>
+bool BuildMeanOperator(
+	const SimpleGrid & grid,
+	double dDist,
+	SparseMatrixCSR<float> & opMeanCSR
+) {
+	const int nGridSize = static_cast<int>(grid.GetSize());
+
+	const SimpleGrid::DistanceThreshold distMax(dDist);
+
+	// Number of non-zero entries in each row
+	std::vector<int> vecRowNonZeros(nGridSize, 0);
+
+	// Total number of non-zero entries in rows constructed so far
+	size_t sNonZeros = 0;
+
+	// Flag indicating the operator is too large to be stored
+	bool fTooLarge = false;
+
+	opMeanCSR.Clear();
+
+#pragma omp parallel
+{
+	// Rows constructed by this thread and their entries, in row order
+	std::vector<int> vecThreadRows;
+	std::vector<int> vecThreadCols;
+
+	// Nodes of the current row
+	std::vector<int> vecRow;
+
+#pragma omp for schedule(dynamic, 64)
+	for (int i = 0; i < nGridSize; i++) {
+		bool fStop;
+#pragma omp atomic read
+		fStop = fTooLarge;
+
+		if (fStop) {
+			continue;
+		}
+
+		FindMeanStencil(grid, distMax, i, vecRow);
+
+		size_t sTotal;
+#pragma omp atomic capture
+		sTotal = sNonZeros += vecRow.size();
+
+		if (sTotal > MaxSparseOperatorNonZeros) {
+#pragma omp atomic write
+			fTooLarge = true;
+			continue;
+		}
+
+		// Store the row sorted by column index
+		vecThreadRows.push_back(i);
+		vecThreadCols.insert(vecThreadCols.end(), vecRow.begin(), vecRow.end());
+		vecRowNonZeros[i] = static_cast<int>(vecRow.size());
+	}
+
+	// Allocate the operator once all row sizes are known
+	if (!fTooLarge) {
+#pragma omp single
+	{
+		opMeanCSR.Allocate(nGridSize, nGridSize, static_cast<int>(sNonZeros));
+
+		DataVector<int> & vecRowOffsets = opMeanCSR.GetRowOffsets();
+		for (int i = 0; i < nGridSize; i++) {
+			vecRowOffsets[i+1] = vecRowOffsets[i] + vecRowNonZeros[i];
+		}
+	}
+
+		// Merge thread-local rows into the operator
+		DataVector<int> & vecRowOffsets = opMeanCSR.GetRowOffsets();
+		DataVector<int> & vecColIndices = opMeanCSR.GetColIndices();
+		DataVector<float> & vecEntries = opMeanCSR.GetEntries();
+
+		int ixThread = 0;
+		for (int r = 0; r < vecThreadRows.size(); r++) {
+			int i = vecThreadRows[r];
+			int ixRow = vecRowOffsets[i];
+			float dWeight = 1.0f / static_cast<float>(vecRowNonZeros[i]);
+			for (int l = 0; l < vecRowNonZeros[i]; l++) {
+				vecColIndices[ixRow + l] = vecThreadCols[ixThread];
+				vecEntries[ixRow + l] = dWeight;
+				ixThread++;
+			}
+		}
+	}
+}
+
+	return (!fTooLarge);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		Apply the mean on an unstructured SimpleGrid without storing the
+///		operator, finding the points within dDist of each node in turn.
+///		The result is identical to applying the operator built by
+///		BuildMeanOperator.  If pvecNodes is NULL the mean is computed on
+///		all nodes.
+///	</summary>
+void ApplyMeanOnTheFly(
+	const SimpleGrid & grid,
+	double dDist,
+	const DataVector<float> & dataIn,
+	const std::vector<int> * pvecNodes,
+	DataVector<float> & dataout
+) {
+	const SimpleGrid::DistanceThreshold distMax(dDist);
+
+	const int nNodes =
+		(pvecNodes == NULL)
+			?(static_cast<int>(grid.GetSize()))
+			:(static_cast<int>(pvecNodes->size()));
+
+#pragma omp parallel
+{
+	std::vector<int> vecRow;
+
+#pragma omp for schedule(dynamic, 64)
+	for (int n = 0; n < nNodes; n++) {
+		int i = (pvecNodes == NULL)?(n):((*pvecNodes)[n]);
+
+		FindMeanStencil(grid, distMax, i, vecRow);
+
+		float dWeight = 1.0f / static_cast<float>(vecRow.size());
+		float dSum = 0.0f;
+		for (int l = 0; l < vecRow.size(); l++) {
+			dSum += dWeight * dataIn[vecRow[l]];
+		}
+		dataout[i] = dSum;
+	}
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+DataOp_MEAN::MeanOperator & DataOp_MEAN::GetOperator(
+	const SimpleGrid & grid,
+	const std::vector<std::string> & strArg,
+	const std::vector<DataVector<float> const *> & vecArgData
+) {
+	if (strArg.size() != 2) {
+		_EXCEPTION2("%s expects two arguments: %i given",
+			m_strName.c_str(), strArg.size());
+	}
+	if (vecArgData[0] == NULL) {
+		_EXCEPTION1("First argument to %s must be a data variable",
+			m_strName.c_str());
+	}
+	if (vecArgData[1] != NULL) {
+		_EXCEPTION1("Second argument to %s must be a distance",
+			m_strName.c_str());
+	}
+
+	// Distance (in degrees)
+	double dDist = atof(strArg[1].c_str());
+
+	if ((dDist < 0.0) || (dDist > 180.0)) {
+		_EXCEPTION1("Distance argument in _MEAN out of range\n"
+			"Expected [0,180], found %1.3e", dDist);
+	}
+
+	// Build the operator for this distance on first use
+	MeanOperator & op = m_mapOperators[dDist];
+
+	if (op.m_sCoordinateStamp != grid.GetCoordinateStamp()) {
+		op.m_fOnTheFly = false;
+		op.m_dDist = dDist;
+		op.m_fLatLon =
+			BuildLatLonMeanStencil(
+				grid,
+				dDist,
+				op.m_fPeriodic,
+				op.m_vecStencilBegin,
+				op.m_vecStencilLat,
+				op.m_vecStencilWest,
+				op.m_vecStencilEast);
+
+		if (!op.m_fLatLon) {
+			OperatorCacheHeader header;
+			std::string strCacheFile =
+				GetOperatorCacheFilename(
+					grid,
+					"mean",
+					MeanCacheMagic,
+					MeanCacheVersion,
+					0,
+					dDist,
+					header);
+
+			if ((strCacheFile != "") &&
+			    LoadOperatorFromCache(strCacheFile, header, op.m_opMean)
+			) {
+				Announce("Loaded mean operator %s (%1.2f) from \"%s\"",
+					m_strName.c_str(), dDist, strCacheFile.c_str());
+
+			} else {
+				Announce("Building mean operator %s (%1.2f)",
+					m_strName.c_str(), dDist);
+
+				if (!BuildMeanOperator(grid, dDist, op.m_opMean)) {
+					Announce("WARNING: Mean operator %s (%1.2f) has more than"
+						" %lu entries; computing mean on the fly",
+						m_strName.c_str(), dDist,
+						static_cast<unsigned long>(MaxSparseOperatorNonZeros));
+
+					op.m_fOnTheFly = true;
+
+				} else if (strCacheFile != "") {
+					SaveOperatorToCache(strCacheFile, header, op.m_opMean);
+				}
+			}
+		}
+
+		op.m_sCoordinateStamp = grid.GetCoordinateStamp();
+	}
+
+	return op;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool DataOp_MEAN::Apply(
+	const SimpleGrid & grid,
+	const std::vector<std::string> & strArg,
+	const std::vector<DataVector<float> const *> & vecArgData,
+	DataVector<float> & dataout
+) {
+	MeanOperator & op = GetOperator(grid, strArg, vecArgData);
+
+	if (op.m_fLatLon) {
+		ApplyLatLonMean(
+			grid,
+			op.m_fPeriodic,
+			op.m_vecStencilBegin,
+			op.m_vecStencilLat,
+			op.m_vecStencilWest,
+			op.m_vecStencilEast,
+			*(vecArgData[0]),
+			NULL,
+			dataout);
+
+	} else if (op.m_fOnTheFly) {
+		ApplyMeanOnTheFly(
+			grid, op.m_dDist, *(vecArgData[0]), NULL, dataout);
+
+	} else {
+		op.m_opMean.Apply(*(vecArgData[0]), dataout);
+	}
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool DataOp_MEAN::ApplyOnNodes(
+	const SimpleGrid & grid,
+	const std::vector<std::string> & strArg,
+	const std::vector<DataVector<float> const *> & vecArgData,
+	const std::vector<int> & vecNodes,
+	DataVector<float> & dataout
+) {
+	MeanOperator & op = GetOperator(grid, strArg, vecArgData);
+
+	if (op.m_fLatLon) {
+		ApplyLatLonMean(
+			grid,
+			op.m_fPeriodic,
+			op.m_vecStencilBegin,
+			op.m_vecStencilLat,
+			op.m_vecStencilWest,
+			op.m_vecStencilEast,
+			*(vecArgData[0]),
+			&vecNodes,
+			dataout);
+
+	} else if (op.m_fOnTheFly) {
+		ApplyMeanOnTheFly(
+			grid, op.m_dDist, *(vecArgData[0]), &vecNodes, dataout);
+
+	} else {
+		op.m_opMean.ApplyOnRows(*(vecArgData[0]), vecNodes, dataout);
+	}
 
 	return true;
 }
@@ -87,6 +87,12 @@ public:
 		m_strName(strName)
 	{ }
 
+	///	<summary>
+	///		Destructor.
+	///	</summary>
+	virtual ~DataOp()
+	{ }
+
 public:
 	///	<summary>
 	///		Get the name of this operator.
@@ -105,6 +111,28 @@ public:
 		DataVector<float> & dataout
 	);
 
+	///	<summary>
+	///		Check if this operator can be applied on a subset of nodes
+	///		with ApplyOnNodes().
+	///	</summary>
+	virtual bool SupportsApplyOnNodes() const {
+		return false;
+	}
+
+	///	<summary>
+	///		Apply the operator on the given nodes only, leaving all other
+	///		values of dataout unchanged.  The values on these nodes are
+	///		identical to those computed by Apply().  Arguments must be
+	///		available on every node that these values depend on.
+	///	</summary>
+	virtual bool ApplyOnNodes(
+		const SimpleGrid & grid,
+		const std::vector<std::string> & strArg,
+		const std::vector<DataVector<float> const *> & vecArgData,
+		const std::vector<int> & vecNodes,
+		DataVector<float> & dataout
+	);
+
 protected:
 	///	<summary>
 	///		Name of this DataOp.
@@ -114,7 +142,79 @@ protected:
 
 ///////////////////////////////////////////////////////////////////////////////
 
-class DataOp_VECMAG : public DataOp {
+///	<summary>
+///		An operator whose value at each grid point depends only on the
+///		values of its arguments and the coordinates at that grid point.
+///		Elementwise operators can be evaluated over any range of grid
+///		points, so nested elementwise operators can be fused into a
+///		single pass over the grid (see FusedDataOp).
+///	</summary>
+class DataOp_Elementwise : public DataOp {
+
+public:
+	///	<summary>
+	///		Constructor with name.
+	///	</summary>
+	DataOp_Elementwise(
+		const std::string & strName
+	) :
+		DataOp(strName)
+	{ }
+
+public:
+	///	<summary>
+	///		Apply the operator.
+	///	</summary>
+	virtual bool Apply(
+		const SimpleGrid & grid,
+		const std::vector<std::string> & strArg,
+		const std::vector<DataVector<float> const *> & vecArgData,
+		DataVector<float> & dataout
+	);
+
+	///	<summary>
+	///		Check if this operator can be applied on a subset of nodes.
+	///	</summary>
+	virtual bool SupportsApplyOnNodes() const {
+		return true;
+	}
+
+	///	<summary>
+	///		Apply the operator on the given nodes only.  Arguments are
+	///		only needed on the same nodes.
+	///	</summary>
+	virtual bool ApplyOnNodes(
+		const SimpleGrid & grid,
+		const std::vector<std::string> & strArg,
+		const std::vector<DataVector<float> const *> & vecArgData,
+		const std::vector<int> & vecNodes,
+		DataVector<float> & dataout
+	);
+
+	///	<summary>
+	///		Verify the number of arguments, throwing an exception if the
+	///		operator cannot be applied to nArgs arguments.
+	///	</summary>
+	virtual void CheckArguments(int nArgs) const = 0;
+
+	///	<summary>
+	///		Apply the operator to the grid points [sBegin, sBegin+sCount).
+	///		pArgData[k] points to the values of argument k at grid point
+	///		sBegin.  pOut may alias pArgData[0].
+	///	</summary>
+	virtual void ApplyElementwise(
+		const SimpleGrid & grid,
+		size_t sBegin,
+		size_t sCount,
+		int nArgs,
+		const float * const * pArgData,
+		float * pOut
+	) const = 0;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+class DataOp_VECMAG : public DataOp_Elementwise {
 
 public:
 	///	<summary>
@@ -127,24 +227,31 @@ public:
 	///		Constructor.
 	///	</summary>
 	DataOp_VECMAG() :
-		DataOp(name)
+		DataOp_Elementwise(name)
 	{ }
 
 public:
 	///	<summary>
-	///		Apply the operator.
+	///		Verify the number of arguments.
 	///	</summary>
-	virtual bool Apply(
+	virtual void CheckArguments(int nArgs) const;
+
+	///	<summary>
+	///		Apply the operator to a contiguous range of grid points.
+	///	</summary>
+	virtual void ApplyElementwise(
 		const SimpleGrid & grid,
-		const std::vector<std::string> & strArg,
-		const std::vector<DataVector<float> const *> & vecArgData,
-		DataVector<float> & dataout
-	);
+		size_t sBegin,
+		size_t sCount,
+		int nArgs,
+		const float * const * pArgData,
+		float * pOut
+	) const;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
 
-class DataOp_ABS : public DataOp {
+class DataOp_ABS : public DataOp_Elementwise {
 
 public:
 	///	<summary>
@@ -157,24 +264,31 @@ public:
 	///		Constructor.
 	///	</summary>
 	DataOp_ABS() :
-		DataOp(name)
+		DataOp_Elementwise(name)
 	{ }
 
 public:
 	///	<summary>
-	///		Apply the operator.
+	///		Verify the number of arguments.
 	///	</summary>
-	virtual bool Apply(
+	virtual void CheckArguments(int nArgs) const;
+
+	///	<summary>
+	///		Apply the operator to a contiguous range of grid points.
+	///	</summary>
+	virtual void ApplyElementwise(
 		const SimpleGrid & grid,
-		const std::vector<std::string> & strArg,
-		const std::vector<DataVector<float> const *> & vecArgData,
-		DataVector<float> & dataout
-	);
+		size_t sBegin,
+		size_t sCount,
+		int nArgs,
+		const float * const * pArgData,
+		float * pOut
+	) const;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
 
-class DataOp_AVG : public DataOp {
+class DataOp_AVG : public DataOp_Elementwise {
 
 public:
 	///	<summary>
@@ -187,24 +301,31 @@ public:
 	///		Constructor.
 	///	</summary>
 	DataOp_AVG() :
-		DataOp(name)
+		DataOp_Elementwise(name)
 	{ }
 
 public:
 	///	<summary>
-	///		Apply the operator.
+	///		Verify the number of arguments.
 	///	</summary>
-	virtual bool Apply(
+	virtual void CheckArguments(int nArgs) const;
+
+	///	<summary>
+	///		Apply the operator to a contiguous range of grid points.
+	///	</summary>
+	virtual void ApplyElementwise(
 		const SimpleGrid & grid,
-		const std::vector<std::string> & strArg,
-		const std::vector<DataVector<float> const *> & vecArgData,
-		DataVector<float> & dataout
-	);
+		size_t sBegin,
+		size_t sCount,
+		int nArgs,
+		const float * const * pArgData,
+		float * pOut
+	) const;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
 
-class DataOp_DIFF : public DataOp {
+class DataOp_DIFF : public DataOp_Elementwise {
 
 public:
 	///	<summary>
@@ -217,24 +338,31 @@ public:
 	///		Constructor.
 	///	</summary>
 	DataOp_DIFF() :
-		DataOp(name)
+		DataOp_Elementwise(name)
 	{ }
 
 public:
 	///	<summary>
-	///		Apply the operator.
+	///		Verify the number of arguments.
 	///	</summary>
-	virtual bool Apply(
+	virtual void CheckArguments(int nArgs) const;
+
+	///	<summary>
+	///		Apply the operator to a contiguous range of grid points.
+	///	</summary>
+	virtual void ApplyElementwise(
 		const SimpleGrid & grid,
-		const std::vector<std::string> & strArg,
-		const std::vector<DataVector<float> const *> & vecArgData,
-		DataVector<float> & dataout
-	);
+		size_t sBegin,
+		size_t sCount,
+		int nArgs,
+		const float * const * pArgData,
+		float * pOut
+	) const;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
 
-class DataOp_DIV : public DataOp {
+class DataOp_DIV : public DataOp_Elementwise {
 
 public:
 	///	<summary>
@@ -247,24 +375,31 @@ public:
 	///		Constructor.
 	///	</summary>
 	DataOp_DIV() :
-		DataOp(name)
+		DataOp_Elementwise(name)
 	{ }
 
 public:
 	///	<summary>
-	///		Apply the operator.
+	///		Verify the number of arguments.
 	///	</summary>
-	virtual bool Apply(
+	virtual void CheckArguments(int nArgs) const;
+
+	///	<summary>
+	///		Apply the operator to a contiguous range of grid points.
+	///	</summary>
+	virtual void ApplyElementwise(
 		const SimpleGrid & grid,
-		const std::vector<std::string> & strArg,
-		const std::vector<DataVector<float> const *> & vecArgData,
-		DataVector<float> & dataout
-	);
+		size_t sBegin,
+		size_t sCount,
+		int nArgs,
+		const float * const * pArgData,
+		float * pOut
+	) const;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
 
-class DataOp_LAT : public DataOp {
+class DataOp_LAT : public DataOp_Elementwise {
 
 public:
 	///	<summary>
@@ -277,24 +412,44 @@ public:
 	///		Constructor.
 	///	</summary>
 	DataOp_LAT() :
-		DataOp(name)
+		DataOp_Elementwise(name),
+		m_sCoefficientStamp(0)
 	{ }
 
 public:
 	///	<summary>
-	///		Apply the operator.
+	///		Verify the number of arguments.
 	///	</summary>
-	virtual bool Apply(
+	virtual void CheckArguments(int nArgs) const;
+
+	///	<summary>
+	///		Apply the operator to a contiguous range of grid points.
+	///	</summary>
+	virtual void ApplyElementwise(
 		const SimpleGrid & grid,
-		const std::vector<std::string> & strArg,
-		const std::vector<DataVector<float> const *> & vecArgData,
-		DataVector<float> & dataout
-	);
+		size_t sBegin,
+		size_t sCount,
+		int nArgs,
+		const float * const * pArgData,
+		float * pOut
+	) const;
+
+protected:
+	///	<summary>
+	///		Coordinate stamp of the grid on which m_dataCoefficient was
+	///		computed.
+	///	</summary>
+	mutable size_t m_sCoefficientStamp;
+
+	///	<summary>
+	///		Latitude of each grid point, in degrees, computed once per grid.
+	///	</summary>
+	mutable DataVector<float> m_dataCoefficient;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
 
-class DataOp_F : public DataOp {
+class DataOp_F : public DataOp_Elementwise {
 
 public:
 	///	<summary>
@@ -307,19 +462,39 @@ public:
 	///		Constructor.
 	///	</summary>
 	DataOp_F() :
-		DataOp(name)
+		DataOp_Elementwise(name),
+		m_sCoefficientStamp(0)
 	{ }
 
 public:
 	///	<summary>
-	///		Apply the operator.
+	///		Verify the number of arguments.
 	///	</summary>
-	virtual bool Apply(
+	virtual void CheckArguments(int nArgs) const;
+
+	///	<summary>
+	///		Apply the operator to a contiguous range of grid points.
+	///	</summary>
+	virtual void ApplyElementwise(
 		const SimpleGrid & grid,
-		const std::vector<std::string> & strArg,
-		const std::vector<DataVector<float> const *> & vecArgData,
-		DataVector<float> & dataout
-	);
+		size_t sBegin,
+		size_t sCount,
+		int nArgs,
+		const float * const * pArgData,
+		float * pOut
+	) const;
+
+protected:
+	///	<summary>
+	///		Coordinate stamp of the grid on which m_dataCoefficient was
+	///		computed.
+	///	</summary>
+	mutable size_t m_sCoefficientStamp;
+
+	///	<summary>
+	///		Coriolis parameter at each grid point, computed once per grid.
+	///	</summary>
+	mutable DataVector<float> m_dataCoefficient;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -347,6 +522,35 @@ public:
 		DataVector<float> & dataout
 	);
 
+	///	<summary>
+	///		Check if this operator can be applied on a subset of nodes.
+	///	</summary>
+	virtual bool SupportsApplyOnNodes() const {
+		return true;
+	}
+
+	///	<summary>
+	///		Apply the operator on the given nodes only.
+	///	</summary>
+	virtual bool ApplyOnNodes(
+		const SimpleGrid & grid,
+		const std::vector<std::string> & strArg,
+		const std::vector<DataVector<float> const *> & vecArgData,
+		const std::vector<int> & vecNodes,
+		DataVector<float> & dataout
+	);
+
+protected:
+	///	<summary>
+	///		Validate the arguments and build the sparse matrix operator on
+	///		first use.
+	///	</summary>
+	void Initialize(
+		const SimpleGrid & grid,
+		const std::vector<std::string> & strArg,
+		const std::vector<DataVector<float> const *> & vecArgData
+	);
+
 protected:
 	///	<summary>
 	///		Number of points in this Laplacian.
@@ -366,7 +570,152 @@ protected:
 	///	<summary>
 	///		Sparse matrix operator.
 	///	</summary>
-	SparseMatrix<float> m_opLaplacian;
+	SparseMatrixCSR<float> m_opLaplacian;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+class DataOp_MEAN : public DataOp {
+
+public:
+	///	<summary>
+	///		Operartor name.
+	///	</summary>
+	static const char * name;
+
+public:
+	///	<summary>
+	///		Constructor.
+	///	</summary>
+	DataOp_MEAN() :
+		DataOp(name)
+	{ }
+
+public:
+	///	<summary>
+	///		Apply the operator.
+	///	</summary>
+	virtual bool Apply(
+		const SimpleGrid & grid,
+		const std::vector<std::string> & strArg,
+		const std::vector<DataVector<float> const *> & vecArgData,
+		DataVector<float> & dataout
+	);
+
+	///	<summary>
+	///		Check if this operator can be applied on a subset of nodes.
+	///	</summary>
+	virtual bool SupportsApplyOnNodes() const {
+		return true;
+	}
+
+	///	<summary>
+	///		Apply the operator on the given nodes only.
+	///	</summary>
+	virtual bool ApplyOnNodes(
+		const SimpleGrid & grid,
+		const std::vector<std::string> & strArg,
+		const std::vector<DataVector<float> const *> & vecArgData,
+		const std::vector<int> & vecNodes,
+		DataVector<float> & dataout
+	);
+
+protected:
+	class MeanOperator;
+
+	///	<summary>
+	///		Validate the arguments and get the averaging operator for the
+	///		given distance, building it if needed.
+	///	</summary>
+	MeanOperator & GetOperator(
+		const SimpleGrid & grid,
+		const std::vector<std::string> & strArg,
+		const std::vector<DataVector<float> const *> & vecArgData
+	);
+
+protected:
+	///	<summary>
+	///		The averaging operator for a single distance on a single grid.
+	///		On regular longitude-latitude grids the points within the
+	///		averaging distance of each point are stored as a range of
+	///		longitude offsets on each nearby row, and the mean is evaluated
+	///		with running sums along each row.  On other grids the mean is
+	///		a precomputed sparse matrix, or is computed on the fly if the
+	///		sparse matrix would be too large to store.
+	///	</summary>
+	class MeanOperator {
+
+	public:
+		///	<summary>
+		///		Constructor.
+		///	</summary>
+		MeanOperator() :
+			m_sCoordinateStamp(0),
+			m_fLatLon(false),
+			m_fPeriodic(false),
+			m_fOnTheFly(false),
+			m_dDist(0.0)
+		{ }
+
+	public:
+		///	<summary>
+		///		Coordinate stamp of the grid for this operator.
+		///	</summary>
+		size_t m_sCoordinateStamp;
+
+		///	<summary>
+		///		Flag indicating the longitude-latitude form is used.
+		///	</summary>
+		bool m_fLatLon;
+
+		///	<summary>
+		///		Flag indicating the longitude-latitude grid is periodic.
+		///	</summary>
+		bool m_fPeriodic;
+
+		///	<summary>
+		///		Flag indicating the mean is computed on the fly.
+		///	</summary>
+		bool m_fOnTheFly;
+
+		///	<summary>
+		///		Averaging distance (in degrees).
+		///	</summary>
+		double m_dDist;
+
+		///	<summary>
+		///		Offset into the stencil arrays of the first stencil row of
+		///		each latitude (length nLat+1).
+		///	</summary>
+		std::vector<int> m_vecStencilBegin;
+
+		///	<summary>
+		///		Latitude index of each stencil row.
+		///	</summary>
+		std::vector<int> m_vecStencilLat;
+
+		///	<summary>
+		///		Number of longitudes included west of the center point on
+		///		each stencil row.
+		///	</summary>
+		std::vector<int> m_vecStencilWest;
+
+		///	<summary>
+		///		Number of longitudes included east of the center point on
+		///		each stencil row.
+		///	</summary>
+		std::vector<int> m_vecStencilEast;
+
+		///	<summary>
+		///		Sparse averaging operator.
+		///	</summary>
+		SparseMatrixCSR<float> m_opMean;
+	};
+
+	///	<summary>
+	///		Averaging operators, indexed by distance.
+	///	</summary>
+	std::map<double, MeanOperator> m_mapOperators;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
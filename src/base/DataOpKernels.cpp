@@ -0,0 +1,423 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+///	\file    DataOpKernels.cpp
+///	\author  Paul Ullrich
+///	\version October 16, 2026
+///
+///	<remarks>
+///		Copyright 2000-2018 Paul Ullrich
+///
+///		This file is distributed as part of the Tempest source code package.
+///		Permission is granted to use, copy, modify and distribute this
+///		source code and its documentation under the terms of the GNU General
+///		Public License.  This software is provided "as is" without express
+///		or implied warranty.
+///	</remarks>
+
+#include "DataOpKernels.h"
+#include "SIMDDispatch.h"
+
+#include <cmath>
+
+#if defined(TEMPEST_SIMD_X86)
+#include <immintrin.h>
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+// Scalar kernels (applied to indices [sBegin, sEnd))
+///////////////////////////////////////////////////////////////////////////////
+
+static void KernelVecMag_Scalar(
+	size_t sBegin,
+	size_t sEnd,
+	const float * pA,
+	const float * pB,
+	float * pOut
+) {
+	for (size_t i = sBegin; i < sEnd; i++) {
+		pOut[i] = sqrt(pA[i] * pA[i] + pB[i] * pB[i]);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+static void KernelAbs_Scalar(
+	size_t sBegin,
+	size_t sEnd,
+	const float * pA,
+	float * pOut
+) {
+	for (size_t i = sBegin; i < sEnd; i++) {
+		pOut[i] = fabs(pA[i]);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+static void KernelSumScale_Scalar(
+	size_t sBegin,
+	size_t sEnd,
+	int nArgs,
+	const float * const * pArgs,
+	double dScale,
+	float * pOut
+) {
+	for (size_t i = sBegin; i < sEnd; i++) {
+		float dSum = 0.0f;
+		for (int v = 0; v < nArgs; v++) {
+			dSum += pArgs[v][i];
+		}
+		pOut[i] = dSum * dScale;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+static void KernelDiff_Scalar(
+	size_t sBegin,
+	size_t sEnd,
+	const float * pA,
+	const float * pB,
+	float * pOut
+) {
+	for (size_t i = sBegin; i < sEnd; i++) {
+		pOut[i] = pA[i] - pB[i];
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+static void KernelDiv_Scalar(
+	size_t sBegin,
+	size_t sEnd,
+	const float * pA,
+	const float * pB,
+	float * pOut
+) {
+	for (size_t i = sBegin; i < sEnd; i++) {
+		pOut[i] = pA[i] / pB[i];
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+#if defined(TEMPEST_SIMD_X86)
+
+///////////////////////////////////////////////////////////////////////////////
+// AVX2 kernels
+///////////////////////////////////////////////////////////////////////////////
+
+TEMPEST_TARGET_AVX2
+static void KernelVecMag_AVX2(
+	size_t sBegin,
+	size_t sEnd,
+	const float * pA,
+	const float * pB,
+	float * pOut
+) {
+	size_t i = sBegin;
+	for (; i + 8 <= sEnd; i += 8) {
+		__m256 vA = _mm256_loadu_ps(pA + i);
+		__m256 vB = _mm256_loadu_ps(pB + i);
+		__m256 vA2 = _mm256_mul_ps(vA, vA);
+		__m256 vB2 = _mm256_mul_ps(vB, vB);
+		_mm256_storeu_ps(pOut + i, _mm256_sqrt_ps(_mm256_add_ps(vA2, vB2)));
+	}
+	KernelVecMag_Scalar(i, sEnd, pA, pB, pOut);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+TEMPEST_TARGET_AVX2
+static void KernelAbs_AVX2(
+	size_t sBegin,
+	size_t sEnd,
+	const float * pA,
+	float * pOut
+) {
+	const __m256 vMask =
+		_mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+
+	size_t i = sBegin;
+	for (; i + 8 <= sEnd; i += 8) {
+		_mm256_storeu_ps(pOut + i, _mm256_and_ps(_mm256_loadu_ps(pA + i), vMask));
+	}
+	KernelAbs_Scalar(i, sEnd, pA, pOut);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+TEMPEST_TARGET_AVX2
+static void KernelSumScale_AVX2(
+	size_t sBegin,
+	size_t sEnd,
+	int nArgs,
+	const float * const * pArgs,
+	double dScale,
+	float * pOut
+) {
+	const __m256d vScale = _mm256_set1_pd(dScale);
+
+	size_t i = sBegin;
+	for (; i + 8 <= sEnd; i += 8) {
+		__m256 vSum = _mm256_setzero_ps();
+		for (int v = 0; v < nArgs; v++) {
+			vSum = _mm256_add_ps(vSum, _mm256_loadu_ps(pArgs[v] + i));
+		}
+
+		// Scale in double precision, as in the scalar kernel
+		__m256d vLo = _mm256_cvtps_pd(_mm256_castps256_ps128(vSum));
+		__m256d vHi = _mm256_cvtps_pd(_mm256_extractf128_ps(vSum, 1));
+		__m128 vOutLo = _mm256_cvtpd_ps(_mm256_mul_pd(vLo, vScale));
+		__m128 vOutHi = _mm256_cvtpd_ps(_mm256_mul_pd(vHi, vScale));
+
+		_mm256_storeu_ps(pOut + i,
+			_mm256_insertf128_ps(
+				_mm256_castps128_ps256(vOutLo), vOutHi, 1));
+	}
+	KernelSumScale_Scalar(i, sEnd, nArgs, pArgs, dScale, pOut);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+TEMPEST_TARGET_AVX2
+static void KernelDiff_AVX2(
+	size_t sBegin,
+	size_t sEnd,
+	const float * pA,
+	const float * pB,
+	float * pOut
+) {
+	size_t i = sBegin;
+	for (; i + 8 <= sEnd; i += 8) {
+		_mm256_storeu_ps(pOut + i, _mm256_sub_ps(_mm256_loadu_ps(pA + i), _mm256_loadu_ps(pB + i)));
+	}
+	KernelDiff_Scalar(i, sEnd, pA, pB, pOut);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+TEMPEST_TARGET_AVX2
+static void KernelDiv_AVX2(
+	size_t sBegin,
+	size_t sEnd,
+	const float * pA,
+	const float * pB,
+	float * pOut
+) {
+	size_t i = sBegin;
+	for (; i + 8 <= sEnd; i += 8) {
+		_mm256_storeu_ps(pOut + i, _mm256_div_ps(_mm256_loadu_ps(pA + i), _mm256_loadu_ps(pB + i)));
+	}
+	KernelDiv_Scalar(i, sEnd, pA, pB, pOut);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// AVX512 kernels
+///////////////////////////////////////////////////////////////////////////////
+
+TEMPEST_TARGET_AVX512
+static void KernelVecMag_AVX512(
+	size_t sBegin,
+	size_t sEnd,
+	const float * pA,
+	const float * pB,
+	float * pOut
+) {
+	size_t i = sBegin;
+	for (; i + 16 <= sEnd; i += 16) {
+		__m512 vA = _mm512_loadu_ps(pA + i);
+		__m512 vB = _mm512_loadu_ps(pB + i);
+		__m512 vA2 = _mm512_mul_ps(vA, vA);
+		__m512 vB2 = _mm512_mul_ps(vB, vB);
+		_mm512_storeu_ps(pOut + i, _mm512_sqrt_ps(_mm512_add_ps(vA2, vB2)));
+	}
+	KernelVecMag_Scalar(i, sEnd, pA, pB, pOut);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+TEMPEST_TARGET_AVX512
+static void KernelAbs_AVX512(
+	size_t sBegin,
+	size_t sEnd,
+	const float * pA,
+	float * pOut
+) {
+	const __m512i vMask = _mm512_set1_epi32(0x7fffffff);
+
+	size_t i = sBegin;
+	for (; i + 16 <= sEnd; i += 16) {
+		_mm512_storeu_ps(pOut + i, _mm512_castsi512_ps(_mm512_and_si512(
+			_mm512_castps_si512(_mm512_loadu_ps(pA + i)), vMask)));
+	}
+	KernelAbs_Scalar(i, sEnd, pA, pOut);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+TEMPEST_TARGET_AVX512
+static void KernelSumScale_AVX512(
+	size_t sBegin,
+	size_t sEnd,
+	int nArgs,
+	const float * const * pArgs,
+	double dScale,
+	float * pOut
+) {
+	const __m512d vScale = _mm512_set1_pd(dScale);
+
+	size_t i = sBegin;
+	for (; i + 16 <= sEnd; i += 16) {
+		__m512 vSum = _mm512_setzero_ps();
+		for (int v = 0; v < nArgs; v++) {
+			vSum = _mm512_add_ps(vSum, _mm512_loadu_ps(pArgs[v] + i));
+		}
+
+		// Scale in double precision, as in the scalar kernel
+		__m512d vLo = _mm512_cvtps_pd(_mm512_castps512_ps256(vSum));
+		__m512d vHi = _mm512_cvtps_pd(_mm256_castpd_ps(
+			_mm512_extractf64x4_pd(_mm512_castps_pd(vSum), 1)));
+		__m256 vOutLo = _mm512_cvtpd_ps(_mm512_mul_pd(vLo, vScale));
+		__m256 vOutHi = _mm512_cvtpd_ps(_mm512_mul_pd(vHi, vScale));
+
+		_mm512_storeu_ps(pOut + i,
+			_mm512_castpd_ps(_mm512_insertf64x4(
+				_mm512_castps_pd(_mm512_castps256_ps512(vOutLo)),
+				_mm256_castps_pd(vOutHi), 1)));
+	}
+	KernelSumScale_Scalar(i, sEnd, nArgs, pArgs, dScale, pOut);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+TEMPEST_TARGET_AVX512
+static void KernelDiff_AVX512(
+	size_t sBegin,
+	size_t sEnd,
+	const float * pA,
+	const float * pB,
+	float * pOut
+) {
+	size_t i = sBegin;
+	for (; i + 16 <= sEnd; i += 16) {
+		_mm512_storeu_ps(pOut + i, _mm512_sub_ps(_mm512_loadu_ps(pA + i), _mm512_loadu_ps(pB + i)));
+	}
+	KernelDiff_Scalar(i, sEnd, pA, pB, pOut);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+TEMPEST_TARGET_AVX512
+static void KernelDiv_AVX512(
+	size_t sBegin,
+	size_t sEnd,
+	const float * pA,
+	const float * pB,
+	float * pOut
+) {
+	size_t i = sBegin;
+	for (; i + 16 <= sEnd; i += 16) {
+		_mm512_storeu_ps(pOut + i, _mm512_div_ps(_mm512_loadu_ps(pA + i), _mm512_loadu_ps(pB + i)));
+	}
+	KernelDiv_Scalar(i, sEnd, pA, pB, pOut);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+#endif // TEMPEST_SIMD_X86
+
+///////////////////////////////////////////////////////////////////////////////
+// Dispatch
+///////////////////////////////////////////////////////////////////////////////
+
+#if defined(TEMPEST_SIMD_X86)
+#define SELECT_KERNEL(type, name) \
+	SelectSIMDKernel<type>(name##_Scalar, name##_AVX2, name##_AVX512)
+#else
+#define SELECT_KERNEL(type, name) \
+	SelectSIMDKernel<type>(name##_Scalar, NULL, NULL)
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+
+void KernelVecMag(
+	size_t sCount,
+	const float * pA,
+	const float * pB,
+	float * pOut
+) {
+	typedef void (* KernelType)(
+		size_t, size_t, const float *, const float *, float *);
+
+	static const KernelType fn = SELECT_KERNEL(KernelType, KernelVecMag);
+
+	fn(0, sCount, pA, pB, pOut);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void KernelAbs(
+	size_t sCount,
+	const float * pA,
+	float * pOut
+) {
+	typedef void (* KernelType)(
+		size_t, size_t, const float *, float *);
+
+	static const KernelType fn = SELECT_KERNEL(KernelType, KernelAbs);
+
+	fn(0, sCount, pA, pOut);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void KernelSumScale(
+	size_t sCount,
+	int nArgs,
+	const float * const * pArgs,
+	double dScale,
+	float * pOut
+) {
+	typedef void (* KernelType)(
+		size_t, size_t, int, const float * const *, double, float *);
+
+	static const KernelType fn = SELECT_KERNEL(KernelType, KernelSumScale);
+
+	fn(0, sCount, nArgs, pArgs, dScale, pOut);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void KernelDiff(
+	size_t sCount,
+	const float * pA,
+	const float * pB,
+	float * pOut
+) {
+	typedef void (* KernelType)(
+		size_t, size_t, const float *, const float *, float *);
+
+	static const KernelType fn = SELECT_KERNEL(KernelType, KernelDiff);
+
+	fn(0, sCount, pA, pB, pOut);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void KernelDiv(
+	size_t sCount,
+	const float * pA,
+	const float * pB,
+	float * pOut
+) {
+	typedef void (* KernelType)(
+		size_t, size_t, const float *, const float *, float *);
+
+	static const KernelType fn = SELECT_KERNEL(KernelType, KernelDiv);
+
+	fn(0, sCount, pA, pB, pOut);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
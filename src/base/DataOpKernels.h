@@ -0,0 +1,85 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+///	\file    DataOpKernels.h
+///	\author  Paul Ullrich
+///	\version October 16, 2026
+///
+///	<remarks>
+///		Copyright 2000-2018 Paul Ullrich
+///
+///		This file is distributed as part of the Tempest source code package.
+///		Permission is granted to use, copy, modify and distribute this
+///		source code and its documentation under the terms of the GNU General
+///		Public License.  This software is provided "as is" without express
+///		or implied warranty.
+///	</remarks>
+
+#ifndef _DATAOPKERNELS_H_
+#define _DATAOPKERNELS_H_
+
+#include <cstddef>
+
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		Vectorized kernels for the built-in elementwise DataOps.  Each
+///		kernel dispatches at run time to the most capable implementation
+///		supported by the processor (see SIMDDispatch.h) and produces the
+///		same results as its scalar implementation.  The output array may
+///		alias the first input array.
+///	</summary>
+
+///	<summary>
+///		out[i] = sqrt(a[i]^2 + b[i]^2)
+///	</summary>
+void KernelVecMag(
+	size_t sCount,
+	const float * pA,
+	const float * pB,
+	float * pOut
+);
+
+///	<summary>
+///		out[i] = |a[i]|
+///	</summary>
+void KernelAbs(
+	size_t sCount,
+	const float * pA,
+	float * pOut
+);
+
+///	<summary>
+///		out[i] = (args[0][i] + ... + args[nArgs-1][i]) * dScale
+///	</summary>
+void KernelSumScale(
+	size_t sCount,
+	int nArgs,
+	const float * const * pArgs,
+	double dScale,
+	float * pOut
+);
+
+///	<summary>
+///		out[i] = a[i] - b[i]
+///	</summary>
+void KernelDiff(
+	size_t sCount,
+	const float * pA,
+	const float * pB,
+	float * pOut
+);
+
+///	<summary>
+///		out[i] = a[i] / b[i]
+///	</summary>
+void KernelDiv(
+	size_t sCount,
+	const float * pA,
+	const float * pB,
+	float * pOut
+);
+
+///////////////////////////////////////////////////////////////////////////////
+
+#endif // _DATAOPKERNELS_H_
+
@@ -0,0 +1,265 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+///	\file    FusedDataOp.cpp
+///	\author  Paul Ullrich
+///	\version October 16, 2026
+///
+///	<remarks>
+///		Copyright 2000-2018 Paul Ullrich
+///
+///		This file is distributed as part of the Tempest source code package.
+///		Permission is granted to use, copy, modify and distribute this
+///		source code and its documentation under the terms of the GNU General
+///		Public License.  This software is provided "as is" without express
+///		or implied warranty.
+///	</remarks>
+
+#include "FusedDataOp.h"
+#include "Exception.h"
+
+#include <algorithm>
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool FusedDataOp::Build(
+	VariableRegistry & varreg,
+	const Variable & var
+) {
+	m_vecInstructions.clear();
+	m_nMaxStack = 0;
+	m_vecInputs.clear();
+	m_vecConsumedArgs.clear();
+
+	if (!var.m_fOp) {
+		return false;
+	}
+
+	DataOp_Elementwise * pop =
+		dynamic_cast<DataOp_Elementwise *>(varreg.GetDataOp(var.m_strName));
+	if (pop == NULL) {
+		return false;
+	}
+
+	int nStack = 0;
+	EmitOperator(varreg, var, pop, nStack);
+
+	if (nStack != 1) {
+		_EXCEPTIONT("Logic error");
+	}
+
+	// Nothing to fuse
+	int nOps = 0;
+	for (int i = 0; i < m_vecInstructions.size(); i++) {
+		if (m_vecInstructions[i].pop != NULL) {
+			nOps++;
+		}
+	}
+	return (nOps > 1);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void FusedDataOp::EmitOperator(
+	VariableRegistry & varreg,
+	const Variable & var,
+	DataOp_Elementwise * pop,
+	int & nStack
+) {
+	int nArgs = static_cast<int>(var.m_varArg.size());
+
+	pop->CheckArguments(nArgs);
+
+	for (int i = 0; i < nArgs; i++) {
+		EmitArgument(varreg, var.m_varArg[i], nStack);
+	}
+
+	Instruction inst;
+	inst.pop = pop;
+	inst.nArgs = nArgs;
+	inst.ixInput = (-1);
+	m_vecInstructions.push_back(inst);
+
+	nStack += 1 - nArgs;
+	m_nMaxStack = std::max(m_nMaxStack, nStack);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void FusedDataOp::EmitArgument(
+	VariableRegistry & varreg,
+	VariableIndex varix,
+	int & nStack
+) {
+	const Variable & var = varreg.Get(varix);
+
+	if (var.IsConstant()) {
+		_EXCEPTION1("Constant \"%s\" cannot be used as an argument to"
+			" an elementwise operator", var.m_strName.c_str());
+	}
+
+	// Inline elementwise operators that are only used here
+	if (var.m_fOp && varreg.IsSingleUseIntermediate(varix)) {
+		DataOp_Elementwise * pop =
+			dynamic_cast<DataOp_Elementwise *>(
+				varreg.GetDataOp(var.m_strName));
+
+		if (pop != NULL) {
+			EmitOperator(varreg, var, pop, nStack);
+			return;
+		}
+	}
+
+	// Otherwise the variable is an input
+	m_vecConsumedArgs.push_back(varix);
+
+	int ixInput = 0;
+	for (; ixInput < m_vecInputs.size(); ixInput++) {
+		if (m_vecInputs[ixInput] == varix) {
+			break;
+		}
+	}
+	if (ixInput == m_vecInputs.size()) {
+		m_vecInputs.push_back(varix);
+	}
+
+	Instruction inst;
+	inst.pop = NULL;
+	inst.nArgs = 0;
+	inst.ixInput = ixInput;
+	m_vecInstructions.push_back(inst);
+
+	nStack++;
+	m_nMaxStack = std::max(m_nMaxStack, nStack);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void FusedDataOp::CheckInputs(
+	const std::vector<DataVector<float> const *> & vecInputData,
+	const DataVector<float> & dataout
+) const {
+	if (vecInputData.size() != m_vecInputs.size()) {
+		_EXCEPTIONT("Incorrect number of inputs to fused operator");
+	}
+
+	const size_t sSize = dataout.GetRows();
+
+	for (int i = 0; i < vecInputData.size(); i++) {
+		if (vecInputData[i] == NULL) {
+			_EXCEPTIONT("Invalid input to fused operator");
+		}
+		if (vecInputData[i]->GetRows() != sSize) {
+			_EXCEPTIONT("Input to fused operator has incorrect size");
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void FusedDataOp::ApplyBlock(
+	const SimpleGrid & grid,
+	const std::vector<DataVector<float> const *> & vecInputData,
+	size_t sBegin,
+	size_t sCount,
+	std::vector<float> & vecScratch,
+	std::vector<const float *> & vecStack,
+	DataVector<float> & dataout
+) const {
+	int nStack = 0;
+	for (int i = 0; i < m_vecInstructions.size(); i++) {
+		const Instruction & inst = m_vecInstructions[i];
+
+		// Push input data
+		if (inst.pop == NULL) {
+			vecStack[nStack] = &((*(vecInputData[inst.ixInput]))[sBegin]);
+			nStack++;
+			continue;
+		}
+
+		// Apply operator, writing the final result directly
+		int ixBase = nStack - inst.nArgs;
+
+		float * pOut;
+		if (i == m_vecInstructions.size()-1) {
+			pOut = &(dataout[sBegin]);
+		} else {
+			pOut = &(vecScratch[ixBase * BlockSize]);
+		}
+
+		inst.pop->ApplyElementwise(
+			grid,
+			sBegin,
+			sCount,
+			inst.nArgs,
+			(inst.nArgs == 0)?(NULL):(&(vecStack[ixBase])),
+			pOut);
+
+		vecStack[ixBase] = pOut;
+		nStack = ixBase + 1;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void FusedDataOp::Apply(
+	const SimpleGrid & grid,
+	const std::vector<DataVector<float> const *> & vecInputData,
+	DataVector<float> & dataout
+) const {
+	CheckInputs(vecInputData, dataout);
+
+	const size_t sSize = dataout.GetRows();
+
+	// Scratch buffer for each stack entry
+	std::vector<float> vecScratch(m_nMaxStack * BlockSize);
+
+	// Data pointers on the stack
+	std::vector<const float *> vecStack(m_nMaxStack);
+
+	for (size_t sBegin = 0; sBegin < sSize; sBegin += BlockSize) {
+		size_t sCount = std::min(BlockSize, sSize - sBegin);
+
+		ApplyBlock(
+			grid, vecInputData, sBegin, sCount,
+			vecScratch, vecStack, dataout);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void FusedDataOp::ApplyOnNodes(
+	const SimpleGrid & grid,
+	const std::vector<DataVector<float> const *> & vecInputData,
+	const std::vector<int> & vecNodes,
+	DataVector<float> & dataout
+) const {
+	CheckInputs(vecInputData, dataout);
+
+	// Scratch buffer for each stack entry
+	std::vector<float> vecScratch(m_nMaxStack * BlockSize);
+
+	// Data pointers on the stack
+	std::vector<const float *> vecStack(m_nMaxStack);
+
+	// Evaluate each run of consecutive nodes
+	size_t n = 0;
+	while (n < vecNodes.size()) {
+		size_t sBegin = static_cast<size_t>(vecNodes[n]);
+		size_t sCount = 1;
+		while ((sCount < BlockSize) &&
+		       (n + sCount < vecNodes.size()) &&
+		       (static_cast<size_t>(vecNodes[n + sCount]) == sBegin + sCount)
+		) {
+			sCount++;
+		}
+
+		ApplyBlock(
+			grid, vecInputData, sBegin, sCount,
+			vecScratch, vecStack, dataout);
+
+		n += sCount;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
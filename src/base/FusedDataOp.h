@@ -0,0 +1,184 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+///	\file    FusedDataOp.h
+///	\author  Paul Ullrich
+///	\version October 16, 2026
+///
+///	<remarks>
+///		Copyright 2000-2018 Paul Ullrich
+///
+///		This file is distributed as part of the Tempest source code package.
+///		Permission is granted to use, copy, modify and distribute this
+///		source code and its documentation under the terms of the GNU General
+///		Public License.  This software is provided "as is" without express
+///		or implied warranty.
+///	</remarks>
+
+#ifndef _FUSEDDATAOP_H_
+#define _FUSEDDATAOP_H_
+
+#include "DataOp.h"
+#include "Variable.h"
+
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		A tree of nested elementwise operators compiled into a postfix
+///		program that is evaluated in a single pass over the grid.  The
+///		grid is processed in blocks of BlockSize points; intermediate
+///		values are held in per-block scratch buffers that stay in cache,
+///		so no full-grid temporaries are allocated.  Each operator is
+///		applied with DataOp_Elementwise::ApplyElementwise(), so results
+///		are identical to evaluating the operators one at a time.
+///
+///		A subexpression is only inlined if it is an elementwise operator
+///		that is consumed by this expression alone; shared subexpressions
+///		and other variables are evaluated separately and become inputs.
+///	</summary>
+class FusedDataOp {
+
+public:
+	///	<summary>
+	///		Number of grid points processed per block.
+	///	</summary>
+	static const size_t BlockSize = 512;
+
+public:
+	///	<summary>
+	///		Constructor.
+	///	</summary>
+	FusedDataOp() :
+		m_nMaxStack(0)
+	{ }
+
+public:
+	///	<summary>
+	///		Compile the expression rooted at the given operator.  Returns
+	///		false if the expression contains no nested elementwise
+	///		operators to fuse.
+	///	</summary>
+	bool Build(
+		VariableRegistry & varreg,
+		const Variable & var
+	);
+
+	///	<summary>
+	///		Get the variables whose data are inputs to the expression.
+	///	</summary>
+	const VariableIndexVector & GetInputs() const {
+		return m_vecInputs;
+	}
+
+	///	<summary>
+	///		Get the arguments of all fused operators that are not fused
+	///		themselves, with one entry per use.
+	///	</summary>
+	const VariableIndexVector & GetConsumedArguments() const {
+		return m_vecConsumedArgs;
+	}
+
+	///	<summary>
+	///		Evaluate the expression.  vecInputData must contain the data
+	///		of each variable returned by GetInputs(), in order.
+	///	</summary>
+	void Apply(
+		const SimpleGrid & grid,
+		const std::vector<DataVector<float> const *> & vecInputData,
+		DataVector<float> & dataout
+	) const;
+
+	///	<summary>
+	///		Evaluate the expression on the given nodes only, leaving all
+	///		other values of dataout unchanged.  The inputs are only needed
+	///		on the same nodes.
+	///	</summary>
+	void ApplyOnNodes(
+		const SimpleGrid & grid,
+		const std::vector<DataVector<float> const *> & vecInputData,
+		const std::vector<int> & vecNodes,
+		DataVector<float> & dataout
+	) const;
+
+protected:
+	///	<summary>
+	///		Verify the input data has the size of the output.
+	///	</summary>
+	void CheckInputs(
+		const std::vector<DataVector<float> const *> & vecInputData,
+		const DataVector<float> & dataout
+	) const;
+
+	///	<summary>
+	///		Evaluate the expression on the grid points [sBegin, sBegin+sCount),
+	///		with sCount no larger than BlockSize.
+	///	</summary>
+	void ApplyBlock(
+		const SimpleGrid & grid,
+		const std::vector<DataVector<float> const *> & vecInputData,
+		size_t sBegin,
+		size_t sCount,
+		std::vector<float> & vecScratch,
+		std::vector<const float *> & vecStack,
+		DataVector<float> & dataout
+	) const;
+
+protected:
+	///	<summary>
+	///		Emit the instructions for the given operator and its fused
+	///		arguments.
+	///	</summary>
+	void EmitOperator(
+		VariableRegistry & varreg,
+		const Variable & var,
+		DataOp_Elementwise * pop,
+		int & nStack
+	);
+
+	///	<summary>
+	///		Emit the instructions for an operator argument.
+	///	</summary>
+	void EmitArgument(
+		VariableRegistry & varreg,
+		VariableIndex varix,
+		int & nStack
+	);
+
+protected:
+	///	<summary>
+	///		An instruction in the compiled program.  Instructions either
+	///		push an input onto the stack or apply an operator to the
+	///		top nArgs entries of the stack.
+	///	</summary>
+	struct Instruction {
+		DataOp_Elementwise * pop;
+		int nArgs;
+		int ixInput;
+	};
+
+	///	<summary>
+	///		Compiled program, in postfix order.
+	///	</summary>
+	std::vector<Instruction> m_vecInstructions;
+
+	///	<summary>
+	///		Maximum depth of the stack.
+	///	</summary>
+	int m_nMaxStack;
+
+	///	<summary>
+	///		Variables whose data are inputs to the program.
+	///	</summary>
+	VariableIndexVector m_vecInputs;
+
+	///	<summary>
+	///		Arguments consumed by fused operators.
+	///	</summary>
+	VariableIndexVector m_vecConsumedArgs;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+#endif // _FUSEDDATAOP_H_
+
@@ -0,0 +1,27 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+///	\file    GraphSearchWorkspace.cpp
+///	\author  Paul Ullrich
+///	\version October 16, 2026
+///
+///	<remarks>
+///		Copyright 2000-2018 Paul Ullrich
+///
+///		This file is distributed as part of the Tempest source code package.
+///		Permission is granted to use, copy, modify and distribute this
+///		source code and its documentation under the terms of the GNU General
+///		Public License.  This software is provided "as is" without express
+///		or implied warranty.
+///	</remarks>
+
+#include "GraphSearchWorkspace.h"
+
+///////////////////////////////////////////////////////////////////////////////
+
+GraphSearchWorkspace & GraphSearchWorkspace::GetForThread() {
+	static thread_local GraphSearchWorkspace s_workspace;
+	return s_workspace;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
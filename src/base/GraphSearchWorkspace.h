@@ -0,0 +1,153 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+///	\file    GraphSearchWorkspace.h
+///	\author  Paul Ullrich
+///	\version October 16, 2026
+///
+///	<remarks>
+///		Copyright 2000-2018 Paul Ullrich
+///
+///		This file is distributed as part of the Tempest source code package.
+///		Permission is granted to use, copy, modify and distribute this
+///		source code and its documentation under the terms of the GNU General
+///		Public License.  This software is provided "as is" without express
+///		or implied warranty.
+///	</remarks>
+
+#ifndef _GRAPHSEARCHWORKSPACE_H_
+#define _GRAPHSEARCHWORKSPACE_H_
+
+#include <cstddef>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		Scratch space for a breadth-first search over the nodes of a
+///		SimpleGrid.  Visited nodes are tracked with an array of epoch
+///		stamps, so starting a new search does not require clearing the
+///		array, and the frontier is a ring buffer over a flat array.  Each
+///		node is enqueued at most once per search, so neither structure
+///		grows after the first search on a given grid and steady-state
+///		searches do not allocate.  A workspace supports only one search
+///		at a time; searches must not be nested.
+///	</summary>
+class GraphSearchWorkspace {
+
+public:
+	///	<summary>
+	///		Default constructor.
+	///	</summary>
+	GraphSearchWorkspace() :
+		m_uiEpoch(0),
+		m_sHead(0),
+		m_sCount(0)
+	{ }
+
+	///	<summary>
+	///		Get the workspace belonging to the calling thread.
+	///	</summary>
+	static GraphSearchWorkspace & GetForThread();
+
+public:
+	///	<summary>
+	///		Begin a new search on a grid with the given number of nodes,
+	///		with the frontier initially containing only node ix0.
+	///	</summary>
+	void Begin(
+		size_t sGridSize,
+		int ix0
+	) {
+		if (m_vecEpoch.size() != sGridSize) {
+			m_vecEpoch.assign(sGridSize, 0);
+			m_vecFrontier.resize(sGridSize);
+			m_uiEpoch = 0;
+		}
+
+		m_uiEpoch++;
+
+		// Epoch counter has wrapped; stamps from old searches are ambiguous
+		if (m_uiEpoch == 0) {
+			m_vecEpoch.assign(sGridSize, 0);
+			m_uiEpoch = 1;
+		}
+
+		m_sHead = 0;
+		m_sCount = 0;
+
+		Visit(ix0);
+	}
+
+	///	<summary>
+	///		Mark the given node as visited and add it to the frontier.
+	///		Returns false (and does nothing) if the node has already been
+	///		visited in this search.
+	///	</summary>
+	bool Visit(int ix) {
+		if (m_vecEpoch[ix] == m_uiEpoch) {
+			return false;
+		}
+		m_vecEpoch[ix] = m_uiEpoch;
+
+		size_t sTail = m_sHead + m_sCount;
+		if (sTail >= m_vecFrontier.size()) {
+			sTail -= m_vecFrontier.size();
+		}
+		m_vecFrontier[sTail] = ix;
+		m_sCount++;
+
+		return true;
+	}
+
+	///	<summary>
+	///		Check if the frontier is empty.
+	///	</summary>
+	bool Empty() const {
+		return (m_sCount == 0);
+	}
+
+	///	<summary>
+	///		Remove and return the node at the front of the frontier.
+	///	</summary>
+	int Pop() {
+		int ix = m_vecFrontier[m_sHead];
+		m_sHead++;
+		if (m_sHead == m_vecFrontier.size()) {
+			m_sHead = 0;
+		}
+		m_sCount--;
+
+		return ix;
+	}
+
+protected:
+	///	<summary>
+	///		Stamp of the current search.
+	///	</summary>
+	unsigned int m_uiEpoch;
+
+	///	<summary>
+	///		Stamp of the last search in which each node was visited.
+	///	</summary>
+	std::vector<unsigned int> m_vecEpoch;
+
+	///	<summary>
+	///		Ring buffer of nodes in the frontier.
+	///	</summary>
+	std::vector<int> m_vecFrontier;
+
+	///	<summary>
+	///		Position of the front of the frontier in m_vecFrontier.
+	///	</summary>
+	size_t m_sHead;
+
+	///	<summary>
+	///		Number of nodes in the frontier.
+	///	</summary>
+	size_t m_sCount;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+#endif // _GRAPHSEARCHWORKSPACE_H_
+
@@ -0,0 +1,231 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+///	\file    MPIFileScheduler.cpp
+///	\author  Paul Ullrich
+///	\version October 16, 2026
+///
+///	<remarks>
+///		Copyright 2000-2018 Paul Ullrich
+///
+///		This file is distributed as part of the Tempest source code package.
+///		Permission is granted to use, copy, modify and distribute this
+///		source code and its documentation under the terms of the GNU General
+///		Public License.  This software is provided "as is" without express
+///		or implied warranty.
+///	</remarks>
+
+#include "MPIFileScheduler.h"
+#include "Announce.h"
+#include "Exception.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include <sys/stat.h>
+
+///////////////////////////////////////////////////////////////////////////////
+
+MPIFileScheduler::MPIFileScheduler(
+	const std::vector<std::string> & vecInputFiles
+) :
+	m_iNextLocal(0),
+	m_nFilesProcessed(0),
+	m_dBusyTime(0.0),
+	m_dStartTime(-1.0)
+{
+	const int nFiles = static_cast<int>(vecInputFiles.size());
+
+	m_vecOrder.resize(nFiles);
+	for (int f = 0; f < nFiles; f++) {
+		m_vecOrder[f] = f;
+	}
+
+#if defined(TEMPEST_MPIOMP)
+	// Order files by decreasing size; ties keep their original order.
+	// Sizes are determined on rank 0 so all ranks use the same order.
+	int nMPIRank;
+	MPI_Comm_rank(MPI_COMM_WORLD, &nMPIRank);
+
+	std::vector<double> vecCost(nFiles, 0.0);
+	if (nMPIRank == 0) {
+		for (int f = 0; f < nFiles; f++) {
+			vecCost[f] = GetFileListSize(vecInputFiles[f]);
+		}
+	}
+	if (nFiles > 0) {
+		MPI_Bcast(vecCost.data(), nFiles, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+	}
+
+	std::stable_sort(m_vecOrder.begin(), m_vecOrder.end(),
+		[&vecCost](int a, int b) {
+			return (vecCost[a] > vecCost[b]);
+		});
+
+	// Create the shared counter in memory allocated by MPI, so that
+	// atomic operations on it can be performed without the involvement
+	// of rank 0 (in hardware or through shared memory) where supported
+	m_piCounter = NULL;
+	MPI_Win_allocate(
+		(nMPIRank == 0)?(sizeof(int)):(0),
+		sizeof(int),
+		MPI_INFO_NULL,
+		MPI_COMM_WORLD,
+		&m_piCounter,
+		&m_win);
+
+	m_fWindowActive = true;
+
+	if (nMPIRank == 0) {
+		MPI_Win_lock(MPI_LOCK_EXCLUSIVE, 0, 0, m_win);
+		*m_piCounter = 0;
+		MPI_Win_unlock(0, m_win);
+	}
+	MPI_Barrier(MPI_COMM_WORLD);
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+MPIFileScheduler::~MPIFileScheduler() {
+	// The window is not freed here, since freeing it is a collective
+	// operation and the destructor may be called while unwinding from an
+	// exception on only one rank.
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+double MPIFileScheduler::GetWallTime() {
+	return std::chrono::duration<double>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+double MPIFileScheduler::GetFileListSize(
+	const std::string & strFiles
+) {
+	double dSize = 0.0;
+
+	int iLast = 0;
+	for (int i = 0; i <= strFiles.length(); i++) {
+		if ((i == strFiles.length()) || (strFiles[i] == ';')) {
+			std::string strFile = strFiles.substr(iLast, i - iLast);
+
+			struct stat statFile;
+			if (stat(strFile.c_str(), &statFile) == 0) {
+				dSize += static_cast<double>(statFile.st_size);
+			}
+
+			iLast = i+1;
+		}
+	}
+
+	return dSize;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool MPIFileScheduler::Next(
+	int & iFile
+) {
+	double dTime = GetWallTime();
+
+	// Record busy time of the previous file
+	if (m_dStartTime >= 0.0) {
+		m_dBusyTime += dTime - m_dStartTime;
+		m_dStartTime = -1.0;
+	}
+
+	// Get the position of the next file
+	int iNext;
+
+#if defined(TEMPEST_MPIOMP)
+	if (!m_fWindowActive) {
+		_EXCEPTIONT("MPIFileScheduler has been freed");
+	}
+
+	const int iOne = 1;
+
+	MPI_Win_lock(MPI_LOCK_SHARED, 0, 0, m_win);
+	MPI_Fetch_and_op(&iOne, &iNext, MPI_INT, 0, 0, MPI_SUM, m_win);
+	MPI_Win_unlock(0, m_win);
+#else
+	iNext = m_iNextLocal;
+	m_iNextLocal++;
+#endif
+
+	if (iNext >= m_vecOrder.size()) {
+		return false;
+	}
+
+	iFile = m_vecOrder[iNext];
+
+	m_nFilesProcessed++;
+	m_dStartTime = GetWallTime();
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void MPIFileScheduler::Summarize() {
+
+	int nMPIRank = 0;
+	int nMPISize = 1;
+
+	std::vector<int> vecFilesProcessed(1, m_nFilesProcessed);
+	std::vector<double> vecBusyTime(1, m_dBusyTime);
+
+#if defined(TEMPEST_MPIOMP)
+	MPI_Comm_rank(MPI_COMM_WORLD, &nMPIRank);
+	MPI_Comm_size(MPI_COMM_WORLD, &nMPISize);
+
+	vecFilesProcessed.resize(nMPISize);
+	vecBusyTime.resize(nMPISize);
+
+	MPI_Gather(
+		&m_nFilesProcessed, 1, MPI_INT,
+		vecFilesProcessed.data(), 1, MPI_INT,
+		0, MPI_COMM_WORLD);
+
+	MPI_Gather(
+		&m_dBusyTime, 1, MPI_DOUBLE,
+		vecBusyTime.data(), 1, MPI_DOUBLE,
+		0, MPI_COMM_WORLD);
+#endif
+
+	if (nMPIRank != 0) {
+		return;
+	}
+
+	double dMaxBusyTime = 0.0;
+	double dTotalBusyTime = 0.0;
+
+	AnnounceStartBlock("Work distribution");
+	for (int r = 0; r < nMPISize; r++) {
+		Announce("Rank %i: %i files, busy %1.2f s",
+			r, vecFilesProcessed[r], vecBusyTime[r]);
+
+		dMaxBusyTime = std::max(dMaxBusyTime, vecBusyTime[r]);
+		dTotalBusyTime += vecBusyTime[r];
+	}
+	if (dMaxBusyTime > 0.0) {
+		Announce("Load balance (mean / max busy time): %1.3f",
+			dTotalBusyTime / static_cast<double>(nMPISize) / dMaxBusyTime);
+	}
+	AnnounceEndBlock("Done");
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void MPIFileScheduler::Free() {
+#if defined(TEMPEST_MPIOMP)
+	if (m_fWindowActive) {
+		MPI_Win_free(&m_win);
+		m_fWindowActive = false;
+	}
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
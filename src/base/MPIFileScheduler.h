@@ -0,0 +1,155 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+///	\file    MPIFileScheduler.h
+///	\author  Paul Ullrich
+///	\version October 16, 2026
+///
+///	<remarks>
+///		Copyright 2000-2018 Paul Ullrich
+///
+///		This file is distributed as part of the Tempest source code package.
+///		Permission is granted to use, copy, modify and distribute this
+///		source code and its documentation under the terms of the GNU General
+///		Public License.  This software is provided "as is" without express
+///		or implied warranty.
+///	</remarks>
+
+#ifndef _MPIFILESCHEDULER_H_
+#define _MPIFILESCHEDULER_H_
+
+#if defined(TEMPEST_MPIOMP)
+#include <mpi.h>
+#endif
+
+#include <string>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		Distributes a list of independent input files among MPI ranks on
+///		demand.  Files are handed out in order of decreasing size, so that
+///		the most expensive files are started first and the cheapest fill
+///		in at the end.  The next file is taken from a shared counter on
+///		rank 0 with MPI one-sided operations, so all ranks process files
+///		and no rank is dedicated to scheduling.  Without MPI, files are
+///		handed out in their original order.
+///
+///		MPI implementations without hardware or shared memory support for
+///		atomic operations may only complete them when rank 0 calls MPI,
+///		so requests can wait until rank 0 finishes its current file unless
+///		asynchronous progress is enabled (e.g. MPICH_ASYNC_PROGRESS=1).
+///
+///		The constructor, Summarize() and Free() are collective operations.
+///	</summary>
+class MPIFileScheduler {
+
+public:
+	///	<summary>
+	///		Constructor.  Each entry of vecInputFiles may be a semicolon-
+	///		separated list of files, whose total size is used as the cost
+	///		of the entry.
+	///	</summary>
+	MPIFileScheduler(
+		const std::vector<std::string> & vecInputFiles
+	);
+
+	///	<summary>
+	///		Destructor.
+	///	</summary>
+	~MPIFileScheduler();
+
+private:
+	///	<summary>
+	///		Copy constructor (not implemented).
+	///	</summary>
+	MPIFileScheduler(const MPIFileScheduler &);
+
+	///	<summary>
+	///		Assignment operator (not implemented).
+	///	</summary>
+	MPIFileScheduler & operator=(const MPIFileScheduler &);
+
+public:
+	///	<summary>
+	///		Get the index of the next file to be processed by this rank.
+	///		Returns false if all files have been handed out.  The time
+	///		between a call to Next() and the following call is counted as
+	///		busy time of this rank.
+	///	</summary>
+	bool Next(int & iFile);
+
+	///	<summary>
+	///		Announce the number of files processed and busy time of each
+	///		rank.  Must be called after Next() has returned false.
+	///	</summary>
+	void Summarize();
+
+	///	<summary>
+	///		Release the shared counter.
+	///	</summary>
+	void Free();
+
+protected:
+	///	<summary>
+	///		Get the current wall clock time, in seconds.
+	///	</summary>
+	static double GetWallTime();
+
+	///	<summary>
+	///		Get the total size in bytes of a semicolon-separated list of
+	///		files.  Files that do not exist have size zero.
+	///	</summary>
+	static double GetFileListSize(
+		const std::string & strFiles
+	);
+
+protected:
+	///	<summary>
+	///		File indices in the order in which they are handed out.
+	///	</summary>
+	std::vector<int> m_vecOrder;
+
+	///	<summary>
+	///		Position in m_vecOrder of the next file (without MPI).
+	///	</summary>
+	int m_iNextLocal;
+
+	///	<summary>
+	///		Number of files processed by this rank.
+	///	</summary>
+	int m_nFilesProcessed;
+
+	///	<summary>
+	///		Time spent processing files on this rank, in seconds.
+	///	</summary>
+	double m_dBusyTime;
+
+	///	<summary>
+	///		Time at which the current file was handed out, or a negative
+	///		value if no file is being processed.
+	///	</summary>
+	double m_dStartTime;
+
+#if defined(TEMPEST_MPIOMP)
+	///	<summary>
+	///		Shared counter of files handed out (only allocated on rank 0).
+	///	</summary>
+	int * m_piCounter;
+
+	///	<summary>
+	///		Window exposing the shared counter.
+	///	</summary>
+	MPI_Win m_win;
+
+	///	<summary>
+	///		Flag indicating the window has been created and not freed.
+	///	</summary>
+	bool m_fWindowActive;
+#endif
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+#endif // _MPIFILESCHEDULER_H_
+
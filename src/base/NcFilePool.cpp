@@ -0,0 +1,194 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+///	\file    NcFilePool.cpp
+///	\author  Paul Ullrich
+///	\version October 16, 2026
+///
+///	<remarks>
+///		Copyright 2000-2018 Paul Ullrich
+///
+///		This file is distributed as part of the Tempest source code package.
+///		Permission is granted to use, copy, modify and distribute this
+///		source code and its documentation under the terms of the GNU General
+///		Public License.  This software is provided "as is" without express
+///		or implied warranty.
+///	</remarks>
+
+#include "NcFilePool.h"
+#include "NetCDFUtilities.h"
+#include "Exception.h"
+
+#include "netcdfcpp.h"
+
+#include <sys/resource.h>
+
+///////////////////////////////////////////////////////////////////////////////
+// NcFileHandle
+///////////////////////////////////////////////////////////////////////////////
+
+NcFileHandle::NcFileHandle(
+	const std::string & strFilename
+) :
+	m_strFilename(strFilename),
+	m_pncfile(NULL)
+{
+	std::lock_guard<std::recursive_mutex> lock(GetNetCDFMutex());
+
+	m_pncfile = new NcFile(strFilename.c_str());
+	if (!m_pncfile->is_valid()) {
+		delete m_pncfile;
+		m_pncfile = NULL;
+		_EXCEPTION1("Unable to open data file \"%s\"", strFilename.c_str());
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+NcFileHandle::~NcFileHandle() {
+	std::lock_guard<std::recursive_mutex> lock(GetNetCDFMutex());
+
+	if (m_pncfile != NULL) {
+		m_pncfile->close();
+		delete m_pncfile;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+NcVar * NcFileHandle::GetVar(
+	const std::string & strName
+) {
+	std::lock_guard<std::recursive_mutex> lock(GetNetCDFMutex());
+
+	std::map<std::string, NcVar *>::const_iterator iter =
+		m_mapVars.find(strName);
+	if (iter != m_mapVars.end()) {
+		return iter->second;
+	}
+
+	NcVar * var = m_pncfile->get_var(strName.c_str());
+
+	m_mapVars.insert(std::pair<std::string, NcVar *>(strName, var));
+
+	return var;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// NcFilePool
+///////////////////////////////////////////////////////////////////////////////
+
+NcFilePool::NcFilePool() :
+	m_sMaxOpenFiles(0)
+{
+	SetMaxOpenFiles(DefaultMaxOpenFiles);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void NcFilePool::SetMaxOpenFiles(
+	size_t sMaxOpenFiles
+) {
+	if (sMaxOpenFiles < 1) {
+		_EXCEPTIONT("Maximum number of open files must be at least 1");
+	}
+
+	// Leave half of the file descriptors for other uses
+	struct rlimit rlimFiles;
+	if ((getrlimit(RLIMIT_NOFILE, &rlimFiles) == 0) &&
+	    (rlimFiles.rlim_cur != RLIM_INFINITY)
+	) {
+		size_t sLimit = static_cast<size_t>(rlimFiles.rlim_cur) / 2;
+		if (sLimit < 1) {
+			sLimit = 1;
+		}
+		if (sMaxOpenFiles > sLimit) {
+			sMaxOpenFiles = sLimit;
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_sMaxOpenFiles = sMaxOpenFiles;
+
+	while (m_listHandles.size() > m_sMaxOpenFiles) {
+		if (!EvictLeastRecentlyUsed()) {
+			break;
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::shared_ptr<NcFileHandle> NcFilePool::Open(
+	const std::string & strFilename
+) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	// Move an open file to the front of the list
+	std::unordered_map<std::string, HandleList::iterator>::iterator iter =
+		m_mapHandles.find(strFilename);
+
+	if (iter != m_mapHandles.end()) {
+		m_listHandles.splice(
+			m_listHandles.begin(), m_listHandles, iter->second);
+		return m_listHandles.front();
+	}
+
+	// Open the file
+	EvictForInsert();
+
+	std::shared_ptr<NcFileHandle> pHandle(new NcFileHandle(strFilename));
+
+	m_listHandles.push_front(pHandle);
+	m_mapHandles[strFilename] = m_listHandles.begin();
+
+	return pHandle;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void NcFilePool::Clear() {
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	while (EvictLeastRecentlyUsed()) { }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool NcFilePool::EvictLeastRecentlyUsed() {
+
+	// Find the least recently used file that is only referenced by the
+	// pool; no other reference can be created without holding m_mutex
+	HandleList::iterator iterEvict = m_listHandles.end();
+	for (HandleList::iterator iter = m_listHandles.begin();
+		iter != m_listHandles.end(); iter++
+	) {
+		if (iter->use_count() == 1) {
+			iterEvict = iter;
+		}
+	}
+
+	if (iterEvict == m_listHandles.end()) {
+		return false;
+	}
+
+	m_mapHandles.erase((*iterEvict)->GetFilename());
+	m_listHandles.erase(iterEvict);
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void NcFilePool::EvictForInsert() {
+	while (m_listHandles.size() >= m_sMaxOpenFiles) {
+		if (!EvictLeastRecentlyUsed()) {
+			_EXCEPTION1("Unable to open another file: all %lu open files"
+				" are in use (maximum number of open files reached)",
+				static_cast<unsigned long>(m_listHandles.size()));
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
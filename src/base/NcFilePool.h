@@ -0,0 +1,217 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+///	\file    NcFilePool.h
+///	\author  Paul Ullrich
+///	\version October 16, 2026
+///
+///	<remarks>
+///		Copyright 2000-2018 Paul Ullrich
+///
+///		This file is distributed as part of the Tempest source code package.
+///		Permission is granted to use, copy, modify and distribute this
+///		source code and its documentation under the terms of the GNU General
+///		Public License.  This software is provided "as is" without express
+///		or implied warranty.
+///	</remarks>
+
+#ifndef _NCFILEPOOL_H_
+#define _NCFILEPOOL_H_
+
+#include <cstddef>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+class NcFile;
+class NcVar;
+
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		An open NetCDF file shared through a NcFilePool.  Variables looked
+///		up by name are cached, so repeated lookups do not search the file
+///		metadata.  The file is closed when the last reference is released.
+///	</summary>
+class NcFileHandle {
+
+public:
+	///	<summary>
+	///		Constructor.  Opens the given file for reading.
+	///	</summary>
+	NcFileHandle(
+		const std::string & strFilename
+	);
+
+	///	<summary>
+	///		Destructor.  Closes the file.
+	///	</summary>
+	~NcFileHandle();
+
+private:
+	///	<summary>
+	///		Copy constructor (not implemented).
+	///	</summary>
+	NcFileHandle(const NcFileHandle &);
+
+	///	<summary>
+	///		Assignment operator (not implemented).
+	///	</summary>
+	NcFileHandle & operator=(const NcFileHandle &);
+
+public:
+	///	<summary>
+	///		Get the filename.
+	///	</summary>
+	const std::string & GetFilename() const {
+		return m_strFilename;
+	}
+
+	///	<summary>
+	///		Get the open file.
+	///	</summary>
+	NcFile * GetFile() const {
+		return m_pncfile;
+	}
+
+	///	<summary>
+	///		Get the variable with the given name, or NULL if the file does
+	///		not contain this variable.  This function is thread-safe; like
+	///		all other calls into the NetCDF library it is serialized by
+	///		GetNetCDFMutex().
+	///	</summary>
+	NcVar * GetVar(
+		const std::string & strName
+	);
+
+protected:
+	///	<summary>
+	///		Filename.
+	///	</summary>
+	std::string m_strFilename;
+
+	///	<summary>
+	///		Open file.
+	///	</summary>
+	NcFile * m_pncfile;
+
+	///	<summary>
+	///		Variables that have been looked up by name.
+	///	</summary>
+	std::map<std::string, NcVar *> m_mapVars;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		A bounded pool of open NetCDF files, evicted in least recently
+///		used order.  Only files that are not referenced outside the pool
+///		are evicted, so the number of open files never exceeds the limit;
+///		opening a file when all files in the pool are in use throws an
+///		exception.  This class is thread-safe.
+///	</summary>
+class NcFilePool {
+
+public:
+	///	<summary>
+	///		Default maximum number of open files.
+	///	</summary>
+	static const size_t DefaultMaxOpenFiles = 128;
+
+public:
+	///	<summary>
+	///		Constructor.  The maximum number of open files defaults to
+	///		DefaultMaxOpenFiles, reduced to fit within the file descriptor
+	///		limit of the process.
+	///	</summary>
+	NcFilePool();
+
+private:
+	///	<summary>
+	///		Copy constructor (not implemented).
+	///	</summary>
+	NcFilePool(const NcFilePool &);
+
+	///	<summary>
+	///		Assignment operator (not implemented).
+	///	</summary>
+	NcFilePool & operator=(const NcFilePool &);
+
+public:
+	///	<summary>
+	///		Set the maximum number of open files.  The value is reduced to
+	///		fit within the file descriptor limit of the process.  Files
+	///		that are not in use are closed until the pool fits within the
+	///		new limit; files in use remain open until released.
+	///	</summary>
+	void SetMaxOpenFiles(size_t sMaxOpenFiles);
+
+	///	<summary>
+	///		Get the maximum number of open files.
+	///	</summary>
+	size_t GetMaxOpenFiles() const {
+		return m_sMaxOpenFiles;
+	}
+
+	///	<summary>
+	///		Get an open handle to the given file, opening the file if it
+	///		is not already in the pool.
+	///	</summary>
+	std::shared_ptr<NcFileHandle> Open(
+		const std::string & strFilename
+	);
+
+	///	<summary>
+	///		Remove all files that are not in use from the pool.  Files in
+	///		use remain in the pool, so they still count towards the limit.
+	///	</summary>
+	void Clear();
+
+protected:
+	///	<summary>
+	///		Evict the least recently used file that is not in use.
+	///		Returns false if all files are in use.  Must be called with
+	///		m_mutex held.
+	///	</summary>
+	bool EvictLeastRecentlyUsed();
+
+	///	<summary>
+	///		Evict files until there is room for one more.  Throws an
+	///		exception if all files are in use.  Must be called with m_mutex
+	///		held.
+	///	</summary>
+	void EvictForInsert();
+
+protected:
+	///	<summary>
+	///		List of open files, from most recently to least recently used.
+	///	</summary>
+	typedef std::list< std::shared_ptr<NcFileHandle> > HandleList;
+
+	///	<summary>
+	///		Mutex protecting the pool.
+	///	</summary>
+	std::mutex m_mutex;
+
+	///	<summary>
+	///		Maximum number of open files.
+	///	</summary>
+	size_t m_sMaxOpenFiles;
+
+	///	<summary>
+	///		Open files, from most recently to least recently used.
+	///	</summary>
+	HandleList m_listHandles;
+
+	///	<summary>
+	///		Map from filename to position in m_listHandles.
+	///	</summary>
+	std::unordered_map<std::string, HandleList::iterator> m_mapHandles;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+#endif // _NCFILEPOOL_H_
+
@@ -281,4 +281,10 @@ void CopyNcVar(
 
 ////////////////////////////////////////////////////////////////////////////////
 
+std::recursive_mutex & GetNetCDFMutex() {
+	static std::recursive_mutex s_mutexNetCDF;
+	return s_mutexNetCDF;
+}
+
+////////////////////////////////////////////////////////////////////////////////
 
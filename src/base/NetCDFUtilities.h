@@ -21,6 +21,7 @@ class NcFile;
 class NcVar;
 
 #include <string>
+#include <mutex>
 
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -47,5 +48,13 @@ void CopyNcVar(
 
 ////////////////////////////////////////////////////////////////////////////////
 
+///	<summary>
+///		Get the mutex which serializes calls into the NetCDF library when
+///		multiple threads access NetCDF files.
+///	</summary>
+std::recursive_mutex & GetNetCDFMutex();
+
+////////////////////////////////////////////////////////////////////////////////
+
 #endif
 
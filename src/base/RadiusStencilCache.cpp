@@ -0,0 +1,186 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+///	\file    RadiusStencilCache.cpp
+///	\author  Paul Ullrich
+///	\version October 16, 2026
+///
+///	<remarks>
+///		Copyright 2000-2018 Paul Ullrich
+///
+///		This file is distributed as part of the Tempest source code package.
+///		Permission is granted to use, copy, modify and distribute this
+///		source code and its documentation under the terms of the GNU General
+///		Public License.  This software is provided "as is" without express
+///		or implied warranty.
+///	</remarks>
+
+#include "RadiusStencilCache.h"
+#include "SimpleGrid.h"
+#include "GraphSearchWorkspace.h"
+#include "Exception.h"
+
+#include <algorithm>
+
+///////////////////////////////////////////////////////////////////////////////
+
+RadiusStencilCache::RadiusStencilCache(
+	const SimpleGrid & grid,
+	size_t sMemoryBudget
+) :
+	m_grid(grid),
+	m_sMemoryBudget(sMemoryBudget),
+	m_sMemoryUsed(0),
+	m_fFull(false),
+	m_sBlockUsed(0),
+	m_sBlockCapacity(0)
+{ }
+
+///////////////////////////////////////////////////////////////////////////////
+
+RadiusStencilCache::~RadiusStencilCache() {
+	for (size_t d = 0; d < m_vecStencils.size(); d++) {
+		delete[] m_vecStencils[d];
+	}
+	for (size_t b = 0; b < m_vecBlocks.size(); b++) {
+		delete[] m_vecBlocks[b];
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void RadiusStencilCache::RegisterDistance(double dDist) {
+	if (dDist < 0.0) {
+		_EXCEPTIONT("Stencil distance must be nonnegative");
+	}
+
+	for (size_t d = 0; d < m_vecDistances.size(); d++) {
+		if (m_vecDistances[d] == dDist) {
+			return;
+		}
+	}
+
+	// Distances that do not fit in the budget are not cached
+	size_t sGridSize = m_grid.GetSize();
+	size_t sIndexBytes = sGridSize * sizeof(std::atomic<const int *>);
+	if (m_sMemoryUsed + sIndexBytes > m_sMemoryBudget) {
+		return;
+	}
+
+	std::atomic<const int *> * pStencils =
+		new std::atomic<const int *>[sGridSize];
+	for (size_t i = 0; i < sGridSize; i++) {
+		pStencils[i].store(NULL, std::memory_order_relaxed);
+	}
+
+	m_vecDistances.push_back(dDist);
+	m_vecStencils.push_back(pStencils);
+	m_sMemoryUsed += sIndexBytes;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool RadiusStencilCache::GetStencil(
+	int ix0,
+	double dDist,
+	const int * & pStencil,
+	int & nStencilSize
+) {
+	// Find the registered distance
+	size_t d = 0;
+	for (; d < m_vecDistances.size(); d++) {
+		if (m_vecDistances[d] == dDist) {
+			break;
+		}
+	}
+	if (d == m_vecDistances.size()) {
+		return false;
+	}
+
+	std::atomic<const int *> * pStencils = m_vecStencils[d];
+
+	const int * pStored = pStencils[ix0].load(std::memory_order_acquire);
+
+	// Build the stencil
+	if (pStored == NULL) {
+		if (m_fFull.load(std::memory_order_relaxed)) {
+			return false;
+		}
+
+		std::vector<int> vecStencil;
+
+		const SimpleGrid::DistanceThreshold distMax(dDist);
+
+		GraphSearchWorkspace & ws = GraphSearchWorkspace::GetForThread();
+		ws.Begin(m_grid.GetSize(), ix0);
+
+		while (!ws.Empty()) {
+			int ix = ws.Pop();
+
+			if (!m_grid.IsWithinDistance(ix0, ix, distMax)) {
+				continue;
+			}
+
+			vecStencil.push_back(ix);
+
+			const SimpleGrid::NeighborRange neighbors =
+				m_grid.GetNeighbors(ix);
+			for (int n = 0; n < neighbors.size(); n++) {
+				ws.Visit(neighbors[n]);
+			}
+		}
+
+#pragma omp critical(RadiusStencilCache)
+{
+		pStored = pStencils[ix0].load(std::memory_order_relaxed);
+		if (pStored == NULL) {
+			pStored = StoreStencil(vecStencil);
+			if (pStored != NULL) {
+				pStencils[ix0].store(pStored, std::memory_order_release);
+			}
+		}
+}
+		if (pStored == NULL) {
+			return false;
+		}
+	}
+
+	nStencilSize = pStored[0];
+	pStencil = pStored + 1;
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+const int * RadiusStencilCache::StoreStencil(
+	const std::vector<int> & vecStencil
+) {
+	size_t sRequired = vecStencil.size() + 1;
+
+	// Allocate a new block
+	if (m_sBlockUsed + sRequired > m_sBlockCapacity) {
+		size_t sCapacity = std::max(BlockSize, sRequired);
+		size_t sBlockBytes = sCapacity * sizeof(int);
+
+		if (m_sMemoryUsed + sBlockBytes > m_sMemoryBudget) {
+			m_fFull.store(true, std::memory_order_relaxed);
+			return NULL;
+		}
+
+		m_vecBlocks.push_back(new int[sCapacity]);
+		m_sBlockUsed = 0;
+		m_sBlockCapacity = sCapacity;
+		m_sMemoryUsed += sBlockBytes;
+	}
+
+	int * pStencil = m_vecBlocks.back() + m_sBlockUsed;
+	pStencil[0] = static_cast<int>(vecStencil.size());
+	std::copy(vecStencil.begin(), vecStencil.end(), pStencil + 1);
+
+	m_sBlockUsed += sRequired;
+
+	return pStencil;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
@@ -0,0 +1,172 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+///	\file    RadiusStencilCache.h
+///	\author  Paul Ullrich
+///	\version October 16, 2026
+///
+///	<remarks>
+///		Copyright 2000-2018 Paul Ullrich
+///
+///		This file is distributed as part of the Tempest source code package.
+///		Permission is granted to use, copy, modify and distribute this
+///		source code and its documentation under the terms of the GNU General
+///		Public License.  This software is provided "as is" without express
+///		or implied warranty.
+///	</remarks>
+
+#ifndef _RADIUSSTENCILCACHE_H_
+#define _RADIUSSTENCILCACHE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+class SimpleGrid;
+
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		A cache of the nodes reachable from each node of a SimpleGrid
+///		within a fixed great circle distance.  Each stencil contains the
+///		nodes visited by a breadth-first search from the center node
+///		through nodes within the distance, in the order in which they are
+///		visited, so a linear scan over the stencil gives the same result
+///		as the graph search it replaces.  Stencils are built lazily the
+///		first time they are requested and kept until the cache is
+///		destroyed.  Once the memory budget is exhausted no further
+///		stencils are stored and GetStencil() reports a miss, in which case
+///		the caller should fall back to a graph search.
+///
+///		Distances must be registered before stencils are requested.
+///		GetStencil() may be called concurrently from multiple threads.
+///	</summary>
+class RadiusStencilCache {
+
+public:
+	///	<summary>
+	///		Constructor.
+	///	</summary>
+	///	<param name="sMemoryBudget">
+	///		Maximum memory used by the cache, in bytes.
+	///	</param>
+	RadiusStencilCache(
+		const SimpleGrid & grid,
+		size_t sMemoryBudget
+	);
+
+	///	<summary>
+	///		Destructor.
+	///	</summary>
+	~RadiusStencilCache();
+
+private:
+	///	<summary>
+	///		Copy constructor (not implemented).
+	///	</summary>
+	RadiusStencilCache(const RadiusStencilCache &);
+
+	///	<summary>
+	///		Assignment operator (not implemented).
+	///	</summary>
+	RadiusStencilCache & operator=(const RadiusStencilCache &);
+
+public:
+	///	<summary>
+	///		Register a distance (in degrees) for which stencils will be
+	///		cached.  This function is not thread-safe.
+	///	</summary>
+	void RegisterDistance(double dDist);
+
+	///	<summary>
+	///		Get the stencil of all nodes within the given distance of node
+	///		ix0.  Returns false if the distance has not been registered or
+	///		the stencil could not be stored within the memory budget.
+	///	</summary>
+	bool GetStencil(
+		int ix0,
+		double dDist,
+		const int * & pStencil,
+		int & nStencilSize
+	);
+
+	///	<summary>
+	///		Get the grid associated with this cache.
+	///	</summary>
+	const SimpleGrid & GetGrid() const {
+		return m_grid;
+	}
+
+	///	<summary>
+	///		Get the memory used by the cache, in bytes.
+	///	</summary>
+	size_t GetMemoryUsed() const {
+		return m_sMemoryUsed;
+	}
+
+protected:
+	///	<summary>
+	///		Store a stencil in the block storage, prefixed by its size.
+	///		Returns NULL if the memory budget is exhausted.  Must be called
+	///		from within a critical section.
+	///	</summary>
+	const int * StoreStencil(
+		const std::vector<int> & vecStencil
+	);
+
+protected:
+	///	<summary>
+	///		Number of entries in each storage block.
+	///	</summary>
+	static const size_t BlockSize = 65536;
+
+	///	<summary>
+	///		Grid on which stencils are computed.
+	///	</summary>
+	const SimpleGrid & m_grid;
+
+	///	<summary>
+	///		Maximum memory used by the cache, in bytes.
+	///	</summary>
+	size_t m_sMemoryBudget;
+
+	///	<summary>
+	///		Memory used by the cache, in bytes.
+	///	</summary>
+	size_t m_sMemoryUsed;
+
+	///	<summary>
+	///		Flag indicating the memory budget has been exhausted.
+	///	</summary>
+	std::atomic<bool> m_fFull;
+
+	///	<summary>
+	///		Registered distances.
+	///	</summary>
+	std::vector<double> m_vecDistances;
+
+	///	<summary>
+	///		For each registered distance, the stored stencil of each node
+	///		(or NULL if the stencil has not been built).
+	///	</summary>
+	std::vector< std::atomic<const int *> * > m_vecStencils;
+
+	///	<summary>
+	///		Blocks of stencil storage.
+	///	</summary>
+	std::vector<int *> m_vecBlocks;
+
+	///	<summary>
+	///		Number of entries used in the last storage block.
+	///	</summary>
+	size_t m_sBlockUsed;
+
+	///	<summary>
+	///		Number of entries in the last storage block.
+	///	</summary>
+	size_t m_sBlockCapacity;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+#endif // _RADIUSSTENCILCACHE_H_
+
@@ -0,0 +1,95 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+///	\file    SIMDDispatch.cpp
+///	\author  Paul Ullrich
+///	\version October 16, 2026
+///
+///	<remarks>
+///		Copyright 2000-2018 Paul Ullrich
+///
+///		This file is distributed as part of the Tempest source code package.
+///		Permission is granted to use, copy, modify and distribute this
+///		source code and its documentation under the terms of the GNU General
+///		Public License.  This software is provided "as is" without express
+///		or implied warranty.
+///	</remarks>
+
+#include "SIMDDispatch.h"
+#include "Announce.h"
+
+#include <cstdlib>
+#include <cstring>
+
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		Environment variable limiting the instruction set used.
+///	</summary>
+static const char * SIMDEnvVar = "TEMPESTEXTREMES_SIMD";
+
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		Detect the most capable instruction set supported by this
+///		processor and operating system.
+///	</summary>
+static SIMDInstructionSet DetectSIMDInstructionSet() {
+	SIMDInstructionSet eSIMD = SIMDInstructionSet_Scalar;
+
+#if defined(TEMPEST_SIMD_X86)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		eSIMD = SIMDInstructionSet_AVX2;
+	}
+	if (__builtin_cpu_supports("avx512f")) {
+		eSIMD = SIMDInstructionSet_AVX512;
+	}
+#endif
+
+	// Limit the instruction set
+	const char * szSIMD = getenv(SIMDEnvVar);
+	if ((szSIMD != NULL) && (szSIMD[0] != '\0')) {
+		SIMDInstructionSet eLimit;
+		if (strcmp(szSIMD, "scalar") == 0) {
+			eLimit = SIMDInstructionSet_Scalar;
+		} else if (strcmp(szSIMD, "avx2") == 0) {
+			eLimit = SIMDInstructionSet_AVX2;
+		} else if (strcmp(szSIMD, "avx512") == 0) {
+			eLimit = SIMDInstructionSet_AVX512;
+		} else {
+			Announce("WARNING: Unrecognized value \"%s\" of %s ignored",
+				szSIMD, SIMDEnvVar);
+			eLimit = SIMDInstructionSet_AVX512;
+		}
+		if (eLimit < eSIMD) {
+			eSIMD = eLimit;
+		}
+	}
+
+	return eSIMD;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+SIMDInstructionSet GetSIMDInstructionSet() {
+	static const SIMDInstructionSet eSIMD = DetectSIMDInstructionSet();
+	return eSIMD;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+const char * GetSIMDInstructionSetName(
+	SIMDInstructionSet eSIMD
+) {
+	switch (eSIMD) {
+		case SIMDInstructionSet_AVX2:
+			return "avx2";
+		case SIMDInstructionSet_AVX512:
+			return "avx512";
+		default:
+			return "scalar";
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
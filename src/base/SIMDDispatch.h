@@ -0,0 +1,99 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+///	\file    SIMDDispatch.h
+///	\author  Paul Ullrich
+///	\version October 16, 2026
+///
+///	<remarks>
+///		Copyright 2000-2018 Paul Ullrich
+///
+///		This file is distributed as part of the Tempest source code package.
+///		Permission is granted to use, copy, modify and distribute this
+///		source code and its documentation under the terms of the GNU General
+///		Public License.  This software is provided "as is" without express
+///		or implied warranty.
+///	</remarks>
+
+#ifndef _SIMDDISPATCH_H_
+#define _SIMDDISPATCH_H_
+
+#include <cstddef>
+
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		Attributes used to compile individual functions for a given
+///		instruction set, so that vectorized kernels can live alongside
+///		their scalar fallbacks without special compiler flags.  Floating
+///		point contraction is disabled in AVX-512 kernels so that they
+///		round identically to the scalar code.
+///	</summary>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define TEMPEST_SIMD_X86
+#define TEMPEST_TARGET_AVX2 __attribute__((target("avx2")))
+#if defined(__clang__)
+#define TEMPEST_TARGET_AVX512 __attribute__((target("avx512f")))
+#else
+#define TEMPEST_TARGET_AVX512 \
+	__attribute__((target("avx512f"), optimize("fp-contract=off")))
+#endif
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		Instruction sets for which kernels may be provided, in increasing
+///		order of capability.
+///	</summary>
+enum SIMDInstructionSet {
+	SIMDInstructionSet_Scalar = 0,
+	SIMDInstructionSet_AVX2 = 1,
+	SIMDInstructionSet_AVX512 = 2
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		Get the most capable instruction set supported by this processor.
+///		The result is computed once.  It may be limited by setting the
+///		environment variable TEMPESTEXTREMES_SIMD to "scalar", "avx2" or
+///		"avx512".
+///	</summary>
+SIMDInstructionSet GetSIMDInstructionSet();
+
+///	<summary>
+///		Get the name of an instruction set.
+///	</summary>
+const char * GetSIMDInstructionSetName(
+	SIMDInstructionSet eSIMD
+);
+
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		Select the most capable of the given implementations of a kernel
+///		that is supported at run time.  Implementations that are not
+///		available may be given as NULL; fnScalar must always be given.
+///		The result is typically stored in a function-local static.
+///	</summary>
+template <typename KernelType>
+KernelType SelectSIMDKernel(
+	KernelType fnScalar,
+	KernelType fnAVX2,
+	KernelType fnAVX512
+) {
+	SIMDInstructionSet eSIMD = GetSIMDInstructionSet();
+
+	if ((eSIMD >= SIMDInstructionSet_AVX512) && (fnAVX512 != NULL)) {
+		return fnAVX512;
+	}
+	if ((eSIMD >= SIMDInstructionSet_AVX2) && (fnAVX2 != NULL)) {
+		return fnAVX2;
+	}
+	return fnScalar;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+#endif // _SIMDDISPATCH_H_
+
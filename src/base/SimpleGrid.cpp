@@ -0,0 +1,413 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+///	\file    SimpleGrid.cpp
+///	\author  Paul Ullrich
+///	\version October 16, 2026
+///
+///	<remarks>
+///		Copyright 2000-2018 Paul Ullrich
+///
+///		This file is distributed as part of the Tempest source code package.
+///		Permission is granted to use, copy, modify and distribute this
+///		source code and its documentation under the terms of the GNU General
+///		Public License.  This software is provided "as is" without express
+///		or implied warranty.
+///	</remarks>
+
+#include "SimpleGrid.h"
+#include "Exception.h"
+
+#include <atomic>
+#include <cstring>
+#include <cstdio>
+#include <stdint.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+///////////////////////////////////////////////////////////////////////////////
+//
+//	Binary connectivity file layout (native byte order):
+//
+//	  char     magic[8]         "TEMPGRID"
+//	  int32_t  byteorder        0x01020304
+//	  int32_t  version          SimpleGrid::BinaryVersion
+//	  int32_t  flags            SimpleGrid::BinaryFlagUnitVectors
+//	  int32_t  reserved
+//	  int64_t  nFaces
+//	  int64_t  nConnectivity
+//	  double   lon[nFaces]      (radians)
+//	  double   lat[nFaces]      (radians)
+//	  int32_t  offset[nFaces+1]
+//	  int32_t  index[nConnectivity]
+//	  (padding to a multiple of 8 bytes)
+//	  double   xyz[3*nFaces]    (only if flags & BinaryFlagUnitVectors)
+//
+///////////////////////////////////////////////////////////////////////////////
+
+const char SimpleGrid::BinaryMagic[8] = {'T','E','M','P','G','R','I','D'};
+
+///////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+///	<summary>
+///		Header of a binary connectivity file.
+///	</summary>
+struct SimpleGridBinaryHeader {
+	char szMagic[8];
+	int32_t iByteOrder;
+	int32_t iVersion;
+	int32_t iFlags;
+	int32_t iReserved;
+	int64_t nFaces;
+	int64_t nConnectivity;
+};
+
+///	<summary>
+///		Round a byte count up to a multiple of 8.
+///	</summary>
+inline size_t PadToEight(size_t sBytes) {
+	return ((sBytes + 7) / 8) * 8;
+}
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SimpleGrid::UpdateCoordinateStamp() {
+	static std::atomic<size_t> s_sNextCoordinateStamp(1);
+
+	m_sCoordinateStamp = s_sNextCoordinateStamp.fetch_add(1);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool SimpleGrid::IsBinaryFile(
+	const std::string & strGridInfoFile
+) {
+	FILE * fp = fopen(strGridInfoFile.c_str(), "rb");
+	if (fp == NULL) {
+		_EXCEPTION1("Unable to open file \"%s\"",
+			strGridInfoFile.c_str());
+	}
+
+	char szMagic[8];
+	size_t sRead = fread(szMagic, 1, sizeof(szMagic), fp);
+	fclose(fp);
+
+	if (sRead != sizeof(szMagic)) {
+		return false;
+	}
+	return (memcmp(szMagic, BinaryMagic, sizeof(szMagic)) == 0);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SimpleGrid::FromFile(
+	const std::string & strGridInfoFile
+) {
+	if (IsBinaryFile(strGridInfoFile)) {
+		FromBinaryFile(strGridInfoFile);
+	} else {
+		FromTextFile(strGridInfoFile);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SimpleGrid::FromTextFile(
+	const std::string & strGridInfoFile
+) {
+	std::ifstream fsGrid(strGridInfoFile.c_str());
+	if (!fsGrid.is_open()) {
+		_EXCEPTION1("Unable to open file \"%s\"",
+			strGridInfoFile.c_str());
+	}
+
+	size_t nFaces;
+	fsGrid >> nFaces;
+
+	m_nGridDim.resize(1);
+	m_nGridDim[0] = nFaces;
+
+	m_dLon.Initialize(nFaces);
+	m_dLat.Initialize(nFaces);
+
+	m_vecConnectivityOffset.resize(nFaces + 1);
+	m_vecConnectivityIndex.clear();
+	m_vecConnectivityOffset[0] = 0;
+
+	for (size_t f = 0; f < nFaces; f++) {
+		size_t sNeighbors;
+		char cComma;
+		fsGrid >> m_dLon[f];
+		fsGrid >> cComma;
+		fsGrid >> m_dLat[f];
+		fsGrid >> cComma;
+		fsGrid >> sNeighbors;
+		fsGrid >> cComma;
+
+		// Convert to radians
+		m_dLon[f] *= M_PI / 180.0;
+		m_dLat[f] *= M_PI / 180.0;
+
+		// Load connectivity
+		for (size_t n = 0; n < sNeighbors; n++) {
+			int ixNeighbor;
+			fsGrid >> ixNeighbor;
+			if (n != sNeighbors-1) {
+				fsGrid >> cComma;
+			}
+			m_vecConnectivityIndex.push_back(ixNeighbor - 1);
+		}
+		m_vecConnectivityOffset[f+1] = m_vecConnectivityIndex.size();
+
+		if (fsGrid.eof()) {
+			if (f != nFaces-1) {
+				_EXCEPTIONT("Premature end of file");
+			}
+		}
+	}
+
+	CalculateUnitVectors();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SimpleGrid::FromBinaryFile(
+	const std::string & strGridInfoFile
+) {
+	int fd = open(strGridInfoFile.c_str(), O_RDONLY);
+	if (fd == (-1)) {
+		_EXCEPTION1("Unable to open file \"%s\"",
+			strGridInfoFile.c_str());
+	}
+
+	struct stat statFile;
+	if (fstat(fd, &statFile) != 0) {
+		close(fd);
+		_EXCEPTION1("Unable to stat file \"%s\"",
+			strGridInfoFile.c_str());
+	}
+
+	size_t sFileSize = static_cast<size_t>(statFile.st_size);
+	if (sFileSize < sizeof(SimpleGridBinaryHeader)) {
+		close(fd);
+		_EXCEPTION1("Binary connectivity file \"%s\" is truncated",
+			strGridInfoFile.c_str());
+	}
+
+	// Map the whole file; the mapping is released once arrays are filled
+	void * pMap = mmap(NULL, sFileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if (pMap == MAP_FAILED) {
+		_EXCEPTION1("Unable to map file \"%s\"",
+			strGridInfoFile.c_str());
+	}
+
+	const char * pData = static_cast<const char *>(pMap);
+
+	SimpleGridBinaryHeader header;
+	memcpy(&header, pData, sizeof(SimpleGridBinaryHeader));
+
+	// Verify header
+	std::string strError;
+	if (memcmp(header.szMagic, BinaryMagic, sizeof(BinaryMagic)) != 0) {
+		strError = "Invalid magic string";
+
+	} else if (header.iByteOrder != 0x01020304) {
+		strError = "Byte order does not match this platform";
+
+	} else if (header.iVersion != BinaryVersion) {
+		strError = "Unsupported format version";
+
+	} else if (header.nFaces <= 0) {
+		strError = "Empty grid";
+
+	// Indices and offsets are stored as int32_t, which also ensures the
+	// sizes below do not overflow
+	} else if ((header.nFaces >= INT32_MAX) ||
+	           (header.nConnectivity < 0) ||
+	           (header.nConnectivity > INT32_MAX)
+	) {
+		strError = "Invalid array sizes";
+	}
+
+	size_t nFaces = 0;
+	size_t nConnectivity = 0;
+	if (strError == "") {
+		nFaces = static_cast<size_t>(header.nFaces);
+		nConnectivity = static_cast<size_t>(header.nConnectivity);
+	}
+
+	size_t sCoordBytes = nFaces * sizeof(double);
+	size_t sOffsetBytes = (nFaces + 1) * sizeof(int32_t);
+	size_t sIndexBytes = nConnectivity * sizeof(int32_t);
+
+	size_t sExpectedSize =
+		sizeof(SimpleGridBinaryHeader)
+		+ 2 * sCoordBytes
+		+ PadToEight(sOffsetBytes + sIndexBytes);
+
+	if (header.iFlags & BinaryFlagUnitVectors) {
+		sExpectedSize += 3 * sCoordBytes;
+	}
+
+	if ((strError == "") && (sFileSize != sExpectedSize)) {
+		strError = "File size does not match header";
+	}
+
+	if (strError != "") {
+		munmap(pMap, sFileSize);
+		_EXCEPTION2("%s in binary connectivity file \"%s\"",
+			strError.c_str(), strGridInfoFile.c_str());
+	}
+
+	// Copy arrays
+	m_nGridDim.resize(1);
+	m_nGridDim[0] = nFaces;
+
+	m_dLon.Initialize(nFaces);
+	m_dLat.Initialize(nFaces);
+
+	m_vecConnectivityOffset.resize(nFaces + 1);
+	m_vecConnectivityIndex.resize(nConnectivity);
+
+	const char * pCursor = pData + sizeof(SimpleGridBinaryHeader);
+
+	memcpy(&(m_dLon[0]), pCursor, sCoordBytes);
+	pCursor += sCoordBytes;
+
+	memcpy(&(m_dLat[0]), pCursor, sCoordBytes);
+	pCursor += sCoordBytes;
+
+	memcpy(m_vecConnectivityOffset.data(), pCursor, sOffsetBytes);
+	pCursor += sOffsetBytes;
+
+	if (nConnectivity != 0) {
+		memcpy(m_vecConnectivityIndex.data(), pCursor, sIndexBytes);
+	}
+	pCursor += PadToEight(sOffsetBytes + sIndexBytes) - sOffsetBytes;
+
+	// Unit vectors are stored interleaved
+	if (header.iFlags & BinaryFlagUnitVectors) {
+		const double * dXYZ = reinterpret_cast<const double *>(pCursor);
+
+		m_dX.Initialize(nFaces);
+		m_dY.Initialize(nFaces);
+		m_dZ.Initialize(nFaces);
+
+		for (size_t i = 0; i < nFaces; i++) {
+			m_dX[i] = dXYZ[3*i+0];
+			m_dY[i] = dXYZ[3*i+1];
+			m_dZ[i] = dXYZ[3*i+2];
+		}
+
+		UpdateCoordinateStamp();
+
+	} else {
+		CalculateUnitVectors();
+	}
+
+	munmap(pMap, sFileSize);
+
+	// Verify connectivity
+	if ((m_vecConnectivityOffset[0] != 0) ||
+	    (m_vecConnectivityOffset[nFaces] != static_cast<int>(nConnectivity))
+	) {
+		_EXCEPTION1("Invalid connectivity offsets in file \"%s\"",
+			strGridInfoFile.c_str());
+	}
+	for (size_t f = 0; f < nFaces; f++) {
+		if (m_vecConnectivityOffset[f+1] < m_vecConnectivityOffset[f]) {
+			_EXCEPTION1("Invalid connectivity offsets in file \"%s\"",
+				strGridInfoFile.c_str());
+		}
+	}
+	for (size_t n = 0; n < nConnectivity; n++) {
+		if ((m_vecConnectivityIndex[n] < 0) ||
+		    (m_vecConnectivityIndex[n] >= static_cast<int>(nFaces))
+		) {
+			_EXCEPTION1("Connectivity index out of range in file \"%s\"",
+				strGridInfoFile.c_str());
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SimpleGrid::ToBinaryFile(
+	const std::string & strGridInfoFile,
+	bool fUnitVectors
+) const {
+	size_t nFaces = GetSize();
+	size_t nConnectivity = m_vecConnectivityIndex.size();
+
+	if (nFaces == 0) {
+		_EXCEPTIONT("Unable to write empty SimpleGrid");
+	}
+	if (m_vecConnectivityOffset.size() != nFaces + 1) {
+		_EXCEPTIONT("Invalid SimpleGrid");
+	}
+	if (nConnectivity > static_cast<size_t>(INT32_MAX)) {
+		_EXCEPTIONT("Connectivity array too large for binary format");
+	}
+
+	FILE * fp = fopen(strGridInfoFile.c_str(), "wb");
+	if (fp == NULL) {
+		_EXCEPTION1("Unable to open file \"%s\"",
+			strGridInfoFile.c_str());
+	}
+
+	SimpleGridBinaryHeader header;
+	memset(&header, 0, sizeof(SimpleGridBinaryHeader));
+	memcpy(header.szMagic, BinaryMagic, sizeof(BinaryMagic));
+	header.iByteOrder = 0x01020304;
+	header.iVersion = BinaryVersion;
+	header.iFlags = (fUnitVectors)?(BinaryFlagUnitVectors):(0);
+	header.nFaces = static_cast<int64_t>(nFaces);
+	header.nConnectivity = static_cast<int64_t>(nConnectivity);
+
+	size_t sOffsetBytes = (nFaces + 1) * sizeof(int32_t);
+	size_t sIndexBytes = nConnectivity * sizeof(int32_t);
+	size_t sPadBytes = PadToEight(sOffsetBytes + sIndexBytes)
+		- sOffsetBytes - sIndexBytes;
+
+	const char szPad[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+
+	bool fSuccess = true;
+	fSuccess &= (fwrite(&header, sizeof(header), 1, fp) == 1);
+	fSuccess &= (fwrite(&(m_dLon[0]), sizeof(double), nFaces, fp) == nFaces);
+	fSuccess &= (fwrite(&(m_dLat[0]), sizeof(double), nFaces, fp) == nFaces);
+	fSuccess &= (fwrite(m_vecConnectivityOffset.data(),
+		sizeof(int32_t), nFaces + 1, fp) == nFaces + 1);
+	fSuccess &= (fwrite(m_vecConnectivityIndex.data(),
+		sizeof(int32_t), nConnectivity, fp) == nConnectivity);
+	fSuccess &= (fwrite(szPad, 1, sPadBytes, fp) == sPadBytes);
+
+	if (fUnitVectors) {
+		std::vector<double> dXYZ(3 * nFaces);
+		for (size_t i = 0; i < nFaces; i++) {
+			dXYZ[3*i+0] = m_dX[i];
+			dXYZ[3*i+1] = m_dY[i];
+			dXYZ[3*i+2] = m_dZ[i];
+		}
+		fSuccess &= (fwrite(dXYZ.data(), sizeof(double), 3 * nFaces, fp)
+			== 3 * nFaces);
+	}
+
+	if (fclose(fp) != 0) {
+		fSuccess = false;
+	}
+	if (!fSuccess) {
+		_EXCEPTION1("Error writing file \"%s\"",
+			strGridInfoFile.c_str());
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
@@ -35,6 +35,90 @@
 ///	</summary>
 class SimpleGrid {
 
+public:
+	///	<summary>
+	///		Magic string identifying a binary connectivity file.
+	///	</summary>
+	static const char BinaryMagic[8];
+
+	///	<summary>
+	///		Current version of the binary connectivity file format.
+	///	</summary>
+	static const int BinaryVersion = 1;
+
+	///	<summary>
+	///		Flag indicating unit vectors are stored in a binary
+	///		connectivity file.
+	///	</summary>
+	static const int BinaryFlagUnitVectors = 0x1;
+
+public:
+	///	<summary>
+	///		A lightweight view of the neighbors of a single grid point,
+	///		pointing into the flat connectivity arrays of the SimpleGrid.
+	///	</summary>
+	class NeighborRange {
+
+	public:
+		///	<summary>
+		///		Constructor.
+		///	</summary>
+		NeighborRange(
+			const int * pBegin,
+			const int * pEnd
+		) :
+			m_pBegin(pBegin),
+			m_pEnd(pEnd)
+		{ }
+
+		///	<summary>
+		///		Pointer to the first neighbor.
+		///	</summary>
+		const int * begin() const {
+			return m_pBegin;
+		}
+
+		///	<summary>
+		///		Pointer past the last neighbor.
+		///	</summary>
+		const int * end() const {
+			return m_pEnd;
+		}
+
+		///	<summary>
+		///		Number of neighbors.
+		///	</summary>
+		int size() const {
+			return static_cast<int>(m_pEnd - m_pBegin);
+		}
+
+		///	<summary>
+		///		Index of the given neighbor.
+		///	</summary>
+		int operator[](int n) const {
+			return m_pBegin[n];
+		}
+
+	protected:
+		///	<summary>
+		///		Pointer to the first neighbor.
+		///	</summary>
+		const int * m_pBegin;
+
+		///	<summary>
+		///		Pointer past the last neighbor.
+		///	</summary>
+		const int * m_pEnd;
+	};
+
+public:
+	///	<summary>
+	///		Default constructor.
+	///	</summary>
+	SimpleGrid() :
+		m_sCoordinateStamp(0)
+	{ }
+
 public:
 	///	<summary>
 	///		Generate the unstructured grid information for a
@@ -50,7 +134,10 @@ public:
 
 		m_dLat.Initialize(nLon * nLat);
 		m_dLon.Initialize(nLon * nLat);
-		m_vecConnectivity.resize(nLon * nLat);
+
+		m_vecConnectivityOffset.resize(nLon * nLat + 1);
+		m_vecConnectivityIndex.clear();
+		m_vecConnectivityIndex.reserve(4 * nLon * nLat);
 
 		m_nGridDim.resize(2);
 		m_nGridDim[0] = nLat;
@@ -72,19 +159,21 @@ public:
 			m_dLon[ixs] = vecLon[i];
 
 			// Connectivity in each compass direction
+			m_vecConnectivityOffset[ixs] = m_vecConnectivityIndex.size();
+
 			if (j != 0) {
-				m_vecConnectivity[ixs].push_back((j-1) * nLon + i);
+				m_vecConnectivityIndex.push_back((j-1) * nLon + i);
 			}
 			if (j != nLat-1) {
-				m_vecConnectivity[ixs].push_back((j+1) * nLon + i);
+				m_vecConnectivityIndex.push_back((j+1) * nLon + i);
 			}
 
 			if ((!fRegional) ||
 			    ((i != 0) && (i != nLon-1))
 			) {
-				m_vecConnectivity[ixs].push_back(
+				m_vecConnectivityIndex.push_back(
 					j * nLon + ((i + 1) % nLon));
-				m_vecConnectivity[ixs].push_back(
+				m_vecConnectivityIndex.push_back(
 					j * nLon + ((i + nLon - 1) % nLon));
 			}
 
@@ -92,6 +181,9 @@ public:
 		}
 		}
 
+		m_vecConnectivityOffset[ixs] = m_vecConnectivityIndex.size();
+
+		CalculateUnitVectors();
 	}
 
 	///	<summary>
@@ -144,63 +236,205 @@ public:
 	}
 
 	///	<summary>
-	///		Load the grid information from a file.
+	///		Load the grid information from a file.  The format of the file
+	///		(text or binary) is detected automatically.
 	///	</summary>
 	void FromFile(
 		const std::string & strGridInfoFile
-	) {
-		std::ifstream fsGrid(strGridInfoFile.c_str());
-		if (!fsGrid.is_open()) {
-			_EXCEPTION1("Unable to open file \"%s\"",
-				strGridInfoFile.c_str());
-		}
+	);
 
-		size_t nFaces;
-		fsGrid >> nFaces;
-
-		m_nGridDim.resize(1);
-		m_nGridDim[0] = nFaces;
-
-		m_dLon.Initialize(nFaces);
-		m_dLat.Initialize(nFaces);
-		m_vecConnectivity.resize(nFaces);
-
-		for (size_t f = 0; f < nFaces; f++) {
-			size_t sNeighbors;
-			char cComma;
-			fsGrid >> m_dLon[f];
-			fsGrid >> cComma;
-			fsGrid >> m_dLat[f];
-			fsGrid >> cComma;
-			fsGrid >> sNeighbors;
-			fsGrid >> cComma;
-
-			// Convert to radians
-			m_dLon[f] *= M_PI / 180.0;
-			m_dLat[f] *= M_PI / 180.0;
-
-			// Load connectivity
-			m_vecConnectivity[f].resize(sNeighbors);
-			for (size_t n = 0; n < sNeighbors; n++) {
-				fsGrid >> m_vecConnectivity[f][n];
-				if (n != sNeighbors-1) {
-					fsGrid >> cComma;
-				}
-				m_vecConnectivity[f][n]--;
-			}
-			if (fsGrid.eof()) {
-				if (f != nFaces-1) {
-					_EXCEPTIONT("Premature end of file");
-				}
-			}
+	///	<summary>
+	///		Load the grid information from a text connectivity file.
+	///	</summary>
+	void FromTextFile(
+		const std::string & strGridInfoFile
+	);
+
+	///	<summary>
+	///		Load the grid information from a binary connectivity file.
+	///	</summary>
+	void FromBinaryFile(
+		const std::string & strGridInfoFile
+	);
+
+	///	<summary>
+	///		Write the grid information to a binary connectivity file,
+	///		optionally including the Cartesian unit vector of each point.
+	///	</summary>
+	void ToBinaryFile(
+		const std::string & strGridInfoFile,
+		bool fUnitVectors
+	) const;
+
+	///	<summary>
+	///		Check if the given file is a binary connectivity file.
+	///	</summary>
+	static bool IsBinaryFile(
+		const std::string & strGridInfoFile
+	);
+
+	///	<summary>
+	///		Calculate the Cartesian unit vector of each grid point from its
+	///		latitude and longitude.
+	///	</summary>
+	void CalculateUnitVectors() {
+		size_t sSize = m_dLon.GetRows();
+
+		UpdateCoordinateStamp();
+
+		m_dX.Initialize(sSize);
+		m_dY.Initialize(sSize);
+		m_dZ.Initialize(sSize);
+
+		for (size_t i = 0; i < sSize; i++) {
+			m_dX[i] = cos(m_dLon[i]) * cos(m_dLat[i]);
+			m_dY[i] = sin(m_dLon[i]) * cos(m_dLat[i]);
+			m_dZ[i] = sin(m_dLat[i]);
 		}
 	}
 
+	///	<summary>
+	///		Assign a new coordinate stamp to this grid.  This must be
+	///		called whenever the coordinates of the grid are changed.
+	///	</summary>
+	void UpdateCoordinateStamp();
+
+	///	<summary>
+	///		Get a stamp identifying the current coordinates of this grid.
+	///		Stamps are unique within a process, so quantities derived from
+	///		the coordinates may be cached using the stamp as a key.
+	///	</summary>
+	size_t GetCoordinateStamp() const {
+		return m_sCoordinateStamp;
+	}
+
 	///	<summary>
 	///		Get the size of the SimpleGrid (number of points).
 	///	</summary>
 	size_t GetSize() const {
-		return (m_vecConnectivity.size());
+		return (m_dLon.GetRows());
+	}
+
+	///	<summary>
+	///		Get the range of neighbors of the given grid point.
+	///	</summary>
+	NeighborRange GetNeighbors(int ix) const {
+		const int * pIndex = m_vecConnectivityIndex.data();
+		return NeighborRange(
+			pIndex + m_vecConnectivityOffset[ix],
+			pIndex + m_vecConnectivityOffset[ix+1]);
+	}
+
+	///	<summary>
+	///		Squared chord distance between two grid points on the unit
+	///		sphere.
+	///	</summary>
+	double ChordDist2(int ix0, int ix1) const {
+		double dDX = m_dX[ix1] - m_dX[ix0];
+		double dDY = m_dY[ix1] - m_dY[ix0];
+		double dDZ = m_dZ[ix1] - m_dZ[ix0];
+		return (dDX * dDX + dDY * dDY + dDZ * dDZ);
+	}
+
+	///	<summary>
+	///		Squared chord distance on the unit sphere corresponding to a
+	///		great circle distance given in degrees.
+	///	</summary>
+	static double ChordDist2FromDegrees(double dDist) {
+		if (dDist >= 180.0) {
+			return 4.0;
+		}
+		double dHalfChord = sin(0.5 * dDist * M_PI / 180.0);
+		return (4.0 * dHalfChord * dHalfChord);
+	}
+
+	///	<summary>
+	///		A great circle distance threshold along with the range of
+	///		squared chord distances for which a comparison against the
+	///		threshold is not decided by roundoff.  The band is the larger
+	///		of a relative tolerance of 1e-10 and an absolute tolerance of
+	///		1e-12 around the squared chord distance of the threshold.  The
+	///		absolute tolerance dominates for radii below about 0.01 degrees,
+	///		where the acos() in GreatCircleDistance() has an error of about
+	///		machine epsilon in squared chord distance regardless of radius.
+	///	</summary>
+	class DistanceThreshold {
+	public:
+		///	<summary>
+		///		Constructor from a great circle distance in degrees.
+		///	</summary>
+		DistanceThreshold(double dDist) :
+			m_dDist(dDist)
+		{
+			if (dDist < 0.0) {
+				m_dChord2Lower = -1.0;
+				m_dChord2Upper = -1.0;
+			} else {
+				double dChord2 = ChordDist2FromDegrees(dDist);
+				m_dChord2Lower = dChord2 * (1.0 - 1.0e-10) - 1.0e-12;
+				m_dChord2Upper = dChord2 * (1.0 + 1.0e-10) + 1.0e-12;
+			}
+		}
+
+	public:
+		///	<summary>
+		///		Great circle distance threshold, in degrees.
+		///	</summary>
+		double m_dDist;
+
+		///	<summary>
+		///		Squared chord distances below this are within the threshold.
+		///	</summary>
+		double m_dChord2Lower;
+
+		///	<summary>
+		///		Squared chord distances above this are outside the threshold.
+		///	</summary>
+		double m_dChord2Upper;
+	};
+
+	///	<summary>
+	///		Check if the great circle distance between two grid points is
+	///		less than or equal to the given threshold.  The test is made on
+	///		the squared chord distance, and the great circle distance is
+	///		only computed for points lying within roundoff of the threshold
+	///		so that the result agrees exactly with GreatCircleDistance().
+	///	</summary>
+	bool IsWithinDistance(
+		int ix0,
+		int ix1,
+		const DistanceThreshold & dist
+	) const {
+		double dChord2 = ChordDist2(ix0, ix1);
+		if (dChord2 < dist.m_dChord2Lower) {
+			return true;
+		}
+		if (dChord2 > dist.m_dChord2Upper) {
+			return false;
+		}
+		return (GreatCircleDistance(ix0, ix1) <= dist.m_dDist);
+	}
+
+	///	<summary>
+	///		Great circle distance between two grid points, in degrees.
+	///	</summary>
+	double GreatCircleDistance(int ix0, int ix1) const {
+		double dR =
+			sin(m_dLat[ix0]) * sin(m_dLat[ix1])
+			+ cos(m_dLat[ix0]) * cos(m_dLat[ix1])
+				* cos(m_dLon[ix1] - m_dLon[ix0]);
+
+		if (dR >= 1.0) {
+			dR = 0.0;
+		} else if (dR <= -1.0) {
+			dR = 180.0;
+		} else {
+			dR = 180.0 / M_PI * acos(dR);
+		}
+		if (dR != dR) {
+			_EXCEPTIONT("NaN value detected");
+		}
+		return dR;
 	}
 
 	///	<summary>
@@ -256,14 +490,41 @@ public:
 	DataVector<double> m_dLat;
 
 	///	<summary>
-	///		Connectivity of each grid point.
+	///		Cartesian x coordinate of the unit vector of each grid point.
 	///	</summary>
-	std::vector< std::vector<int> > m_vecConnectivity;
+	DataVector<double> m_dX;
+
+	///	<summary>
+	///		Cartesian y coordinate of the unit vector of each grid point.
+	///	</summary>
+	DataVector<double> m_dY;
+
+	///	<summary>
+	///		Cartesian z coordinate of the unit vector of each grid point.
+	///	</summary>
+	DataVector<double> m_dZ;
+
+	///	<summary>
+	///		Offset of the first neighbor of each grid point into
+	///		m_vecConnectivityIndex (size GetSize()+1).
+	///	</summary>
+	std::vector<int> m_vecConnectivityOffset;
+
+	///	<summary>
+	///		Flat array of neighbor indices of all grid points.
+	///	</summary>
+	std::vector<int> m_vecConnectivityIndex;
 
 	///	<summary>
 	///		Grid dimensions.
 	///	</summary>
 	std::vector<size_t> m_nGridDim;
+
+protected:
+	///	<summary>
+	///		Stamp identifying the current coordinates.
+	///	</summary>
+	size_t m_sCoordinateStamp;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
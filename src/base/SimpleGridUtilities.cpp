@@ -15,8 +15,7 @@
 ///	</remarks>
 
 #include "SimpleGridUtilities.h"
-
-#include <queue>
+#include "GraphSearchWorkspace.h"
 
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -29,7 +28,8 @@ void FindLocalMinMax(
 	double dMaxDist,
 	int & ixExtremum,
 	real & dMaxValue,
-	float & dRMax
+	float & dRMax,
+	RadiusStencilCache * pStencilCache
 ) {
 	// Verify that dMaxDist is less than 180.0
 	if (dMaxDist > 180.0) {
@@ -41,48 +41,49 @@ void FindLocalMinMax(
 	dMaxValue = data[ix0];
 	dRMax = 0.0;
 
-	// Queue of nodes that remain to be visited
-	std::queue<int> queueNodes;
-	queueNodes.push(ixExtremum);
-
-	// Set of nodes that have already been visited
-	std::set<int> setNodesVisited;
-
-	// Latitude and longitude at the origin
-	double dLat0 = grid.m_dLat[ix0];
-	double dLon0 = grid.m_dLon[ix0];
-
-	// Loop through all latlon elements
-	while (queueNodes.size() != 0) {
-		int ix = queueNodes.front();
-		queueNodes.pop();
-
-		if (setNodesVisited.find(ix) != setNodesVisited.end()) {
-			continue;
+	// Scan the cached stencil
+	const int * pStencil;
+	int nStencilSize;
+
+	if ((pStencilCache != NULL) &&
+	    (pStencilCache->GetStencil(ix0, dMaxDist, pStencil, nStencilSize))
+	) {
+		for (int s = 0; s < nStencilSize; s++) {
+			int ix = pStencil[s];
+
+			if (fMinimum) {
+				if (data[ix] < dMaxValue) {
+					ixExtremum = ix;
+					dMaxValue = data[ix];
+				}
+
+			} else {
+				if (data[ix] > dMaxValue) {
+					ixExtremum = ix;
+					dMaxValue = data[ix];
+				}
+			}
 		}
 
-		setNodesVisited.insert(ix);
+		if (ixExtremum != ix0) {
+			dRMax = grid.GreatCircleDistance(ix0, ixExtremum);
+		}
+		return;
+	}
 
-		double dLatThis = grid.m_dLat[ix];
-		double dLonThis = grid.m_dLon[ix];
+	// Nodes that remain to be visited
+	GraphSearchWorkspace & ws = GraphSearchWorkspace::GetForThread();
+	ws.Begin(grid.GetSize(), ixExtremum);
 
-		// Great circle distance to this element
-		double dR =
-			sin(dLat0) * sin(dLatThis)
-			+ cos(dLat0) * cos(dLatThis) * cos(dLonThis - dLon0);
+	// Distance threshold
+	const SimpleGrid::DistanceThreshold distMax(dMaxDist);
 
-		if (dR >= 1.0) {
-			dR = 0.0;
-		} else if (dR <= -1.0) {
-			dR = 180.0;
-		} else {
-			dR = 180.0 / M_PI * acos(dR);
-		}
-		if (dR != dR) {
-			_EXCEPTIONT("NaN value detected");
-		}
+	// Loop through all latlon elements
+	while (!ws.Empty()) {
+		int ix = ws.Pop();
 
-		if (dR > dMaxDist) {
+		// Distance to this element
+		if (!grid.IsWithinDistance(ix0, ix, distMax)) {
 			continue;
 		}
 
@@ -91,22 +92,27 @@ void FindLocalMinMax(
 			if (data[ix] < dMaxValue) {
 				ixExtremum = ix;
 				dMaxValue = data[ix];
-				dRMax = dR;
 			}
 
 		} else {
 			if (data[ix] > dMaxValue) {
 				ixExtremum = ix;
 				dMaxValue = data[ix];
-				dRMax = dR;
 			}
 		}
 
 		// Add all neighbors of this point
-		for (int n = 0; n < grid.m_vecConnectivity[ix].size(); n++) {
-			queueNodes.push(grid.m_vecConnectivity[ix][n]);
+		const SimpleGrid::NeighborRange neighbors =
+			grid.GetNeighbors(ix);
+		for (int n = 0; n < neighbors.size(); n++) {
+			ws.Visit(neighbors[n]);
 		}
 	}
+
+	// Great circle distance to the extremum
+	if (ixExtremum != ix0) {
+		dRMax = grid.GreatCircleDistance(ix0, ixExtremum);
+	}
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -117,15 +123,15 @@ void FindAllLocalMinima(
 	const DataVector<real> & data,
 	std::set<int> & setMinima
 ) {
-	int sFaces = grid.m_vecConnectivity.size();
+	int sFaces = grid.GetSize();
 	for (int f = 0; f < sFaces; f++) {
 		
 		bool fMinimum = true;
 
 		real dValue = data[f];
-		int sNeighbors = grid.m_vecConnectivity[f].size();
-		for (int n = 0; n < sNeighbors; n++) {
-			if (data[grid.m_vecConnectivity[f][n]] < dValue) {
+		const SimpleGrid::NeighborRange neighbors = grid.GetNeighbors(f);
+		for (int n = 0; n < neighbors.size(); n++) {
+			if (data[neighbors[n]] < dValue) {
 				fMinimum = false;
 				break;
 			}
@@ -145,15 +151,15 @@ void FindAllLocalMaxima(
 	const DataVector<real> & data,
 	std::set<int> & setMaxima
 ) {
-	int sFaces = grid.m_vecConnectivity.size();
+	int sFaces = grid.GetSize();
 	for (int f = 0; f < sFaces; f++) {
 		
 		bool fMaximum = true;
 
 		real dValue = data[f];
-		int sNeighbors = grid.m_vecConnectivity[f].size();
-		for (int n = 0; n < sNeighbors; n++) {
-			if (data[grid.m_vecConnectivity[f][n]] > dValue) {
+		const SimpleGrid::NeighborRange neighbors = grid.GetNeighbors(f);
+		for (int n = 0; n < neighbors.size(); n++) {
+			if (data[neighbors[n]] > dValue) {
 				fMaximum = false;
 				break;
 			}
@@ -173,59 +179,47 @@ void FindLocalAverage(
 	const DataVector<real> & data,
 	int ix0,
 	double dMaxDist,
-	real & dAverage
+	real & dAverage,
+	RadiusStencilCache * pStencilCache
 ) {
 	// Verify that dMaxDist is less than 180.0
 	if (dMaxDist > 180.0) {
 		_EXCEPTIONT("MaxDist must be less than 180.0");
 	}
 
-	// Queue of nodes that remain to be visited
-	std::queue<int> queueNodes;
-	queueNodes.push(ix0);
-
-	// Set of nodes that have already been visited
-	std::set<int> setNodesVisited;
-
-	// Latitude and longitude at the origin
-	double dLat0 = grid.m_dLat[ix0];
-	double dLon0 = grid.m_dLon[ix0];
-
 	// Number of points
 	real dSum = 0.0;
 	int nCount = 0;
 
-	// Loop through all latlon elements
-	while (queueNodes.size() != 0) {
-		int ix = queueNodes.front();
-		queueNodes.pop();
+	// Scan the cached stencil
+	const int * pStencil;
+	int nStencilSize;
 
-		if (setNodesVisited.find(ix) != setNodesVisited.end()) {
-			continue;
+	if ((pStencilCache != NULL) &&
+	    (pStencilCache->GetStencil(ix0, dMaxDist, pStencil, nStencilSize))
+	) {
+		for (int s = 0; s < nStencilSize; s++) {
+			dSum += data[pStencil[s]];
+			nCount++;
 		}
 
-		setNodesVisited.insert(ix);
+		dAverage = dSum / static_cast<float>(nCount);
+		return;
+	}
 
-		double dLatThis = grid.m_dLat[ix];
-		double dLonThis = grid.m_dLon[ix];
+	// Nodes that remain to be visited
+	GraphSearchWorkspace & ws = GraphSearchWorkspace::GetForThread();
+	ws.Begin(grid.GetSize(), ix0);
 
-		// Great circle distance to this element
-		double dR =
-			sin(dLat0) * sin(dLatThis)
-			+ cos(dLat0) * cos(dLatThis) * cos(dLonThis - dLon0);
+	// Distance threshold
+	const SimpleGrid::DistanceThreshold distMax(dMaxDist);
 
-		if (dR >= 1.0) {
-			dR = 0.0;
-		} else if (dR <= -1.0) {
-			dR = 180.0;
-		} else {
-			dR = 180.0 / M_PI * acos(dR);
-		}
-		if (dR != dR) {
-			_EXCEPTIONT("NaN value detected");
-		}
+	// Loop through all latlon elements
+	while (!ws.Empty()) {
+		int ix = ws.Pop();
 
-		if (dR > dMaxDist) {
+		// Distance to this element
+		if (!grid.IsWithinDistance(ix0, ix, distMax)) {
 			continue;
 		}
 
@@ -234,8 +228,10 @@ void FindLocalAverage(
 		nCount++;
 
 		// Add all neighbors of this point
-		for (int n = 0; n < grid.m_vecConnectivity[ix].size(); n++) {
-			queueNodes.push(grid.m_vecConnectivity[ix][n]);
+		const SimpleGrid::NeighborRange neighbors =
+			grid.GetNeighbors(ix);
+		for (int n = 0; n < neighbors.size(); n++) {
+			ws.Visit(neighbors[n]);
 		}
 	}
 
@@ -253,7 +249,8 @@ template void FindLocalMinMax<float>(
 	double dMaxDist,
 	int & ixExtremum,
 	float & dMaxValue,
-	float & dRMax
+	float & dRMax,
+	RadiusStencilCache * pStencilCache
 );
 
 template void FindLocalMinMax<double>(
@@ -264,7 +261,8 @@ template void FindLocalMinMax<double>(
 	double dMaxDist,
 	int & ixExtremum,
 	double & dMaxValue,
-	float & dRMax
+	float & dRMax,
+	RadiusStencilCache * pStencilCache
 );
 
 template void FindAllLocalMinima<float>(
@@ -296,7 +294,8 @@ template void FindLocalAverage<float>(
 	const DataVector<float> & data,
 	int ix0,
 	double dMaxDist,
-	float & dAverage
+	float & dAverage,
+	RadiusStencilCache * pStencilCache
 );
 
 template void FindLocalAverage<double>(
@@ -304,7 +303,8 @@ template void FindLocalAverage<double>(
 	const DataVector<double> & data,
 	int ix0,
 	double dMaxDist,
-	double & dAverage
+	double & dAverage,
+	RadiusStencilCache * pStencilCache
 );
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -18,6 +18,7 @@
 #define _SIMPLEGRIDUTILITIES_H_
 
 #include "SimpleGrid.h"
+#include "RadiusStencilCache.h"
 #include "DataVector.h"
 
 #include <set>
@@ -40,6 +41,10 @@
 ///		Output distance from the centerpoint at which the extremum occurs
 ///		in great circle distance (degrees).
 ///	</param>
+///	<param name="pStencilCache">
+///		Optional cache of stencils on this grid.  If the stencil of ix0 at
+///		dMaxDist is available it is scanned in place of a graph search.
+///	</param>
 template <typename real>
 void FindLocalMinMax(
 	const SimpleGrid & grid,
@@ -49,7 +54,8 @@ void FindLocalMinMax(
 	double dMaxDist,
 	int & ixExtremum,
 	real & dMaxValue,
-	float & dRMax
+	float & dRMax,
+	RadiusStencilCache * pStencilCache = NULL
 );
 
 ///	<summary>
@@ -78,13 +84,18 @@ void FindAllLocalMaxima(
 ///	<param name="dMaxDist">
 ///		Maximum distance from the initial point in degrees.
 ///	</param>
+///	<param name="pStencilCache">
+///		Optional cache of stencils on this grid.  If the stencil of ix0 at
+///		dMaxDist is available it is scanned in place of a graph search.
+///	</param>
 template <typename real>
 void FindLocalAverage(
 	const SimpleGrid & grid,
 	const DataVector<real> & data,
 	int ix0,
 	double dMaxDist,
-	real & dAverage
+	real & dAverage,
+	RadiusStencilCache * pStencilCache = NULL
 );
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -20,6 +20,8 @@
 #include "DataVector.h"
 
 #include <map>
+#include <cstdio>
+#include <vector>
 
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -167,6 +169,27 @@ public:
 		return m_mapEntries.end();
 	}
 
+	///	<summary>
+	///		Const iterator to beginning of SparseMap.
+	///	</summary>
+	SparseMapConstIterator begin() const {
+		return m_mapEntries.begin();
+	}
+
+	///	<summary>
+	///		Const iterator to end of SparseMap.
+	///	</summary>
+	SparseMapConstIterator end() const {
+		return m_mapEntries.end();
+	}
+
+	///	<summary>
+	///		Get the number of non-zero entries in the SparseMatrix.
+	///	</summary>
+	int GetNonZeroCount() const {
+		return static_cast<int>(m_mapEntries.size());
+	}
+
 public:
 	///	<summary>
 	///		Apply the sparse matrix to a DataVector.
@@ -211,5 +234,384 @@ protected:
 
 ///////////////////////////////////////////////////////////////////////////////
 
+///	<summary>
+///		A sparse matrix stored in compressed sparse row (CSR) format.  This
+///		class is not intended for incremental assembly; instead, it is
+///		frozen from an assembled SparseMatrix and then applied repeatedly.
+///	</summary>
+template <typename DataType>
+class SparseMatrixCSR {
+
+public:
+	///	<summary>
+	///		Default constructor.
+	///	</summary>
+	SparseMatrixCSR() :
+		m_nRows(0),
+		m_nCols(0)
+	{ }
+
+public:
+	///	<summary>
+	///		Build the compressed representation from an assembled SparseMatrix.
+	///	</summary>
+	void FromSparseMatrix(
+		const SparseMatrix<DataType> & mat
+	) {
+		Clear();
+
+		m_nRows = mat.GetRows();
+		m_nCols = mat.GetColumns();
+
+		int nNonZeros = mat.GetNonZeroCount();
+
+		m_vecRowOffsets.Initialize(m_nRows + 1);
+		if (nNonZeros == 0) {
+			return;
+		}
+
+		m_vecColIndices.Initialize(nNonZeros, false);
+		m_vecEntries.Initialize(nNonZeros, false);
+
+		// Entries in the SparseMap are ordered by row and then by column
+		int ix = 0;
+		typename SparseMatrix<DataType>::SparseMapConstIterator iter =
+			mat.begin();
+		for (; iter != mat.end(); iter++) {
+			m_vecRowOffsets[iter->first.first + 1]++;
+			m_vecColIndices[ix] = iter->first.second;
+			m_vecEntries[ix] = iter->second;
+			ix++;
+		}
+
+		for (int i = 0; i < m_nRows; i++) {
+			m_vecRowOffsets[i+1] += m_vecRowOffsets[i];
+		}
+	}
+
+	///	<summary>
+	///		Allocate the operator with the given number of non-zero
+	///		entries.  The row offsets, column indices and entries are then
+	///		filled directly by the caller.
+	///	</summary>
+	void Allocate(
+		int nRows,
+		int nCols,
+		int nNonZeros
+	) {
+		Clear();
+
+		m_nRows = nRows;
+		m_nCols = nCols;
+
+		m_vecRowOffsets.Initialize(nRows + 1);
+		if (nNonZeros == 0) {
+			return;
+		}
+
+		m_vecColIndices.Initialize(nNonZeros, false);
+		m_vecEntries.Initialize(nNonZeros, false);
+	}
+
+	///	<summary>
+	///		Clear the operator.
+	///	</summary>
+	void Clear() {
+		m_nRows = 0;
+		m_nCols = 0;
+		m_vecRowOffsets.Deinitialize();
+		m_vecColIndices.Deinitialize();
+		m_vecEntries.Deinitialize();
+	}
+
+	///	<summary>
+	///		Get the number of rows in the SparseMatrixCSR.
+	///	</summary>
+	int GetRows() const {
+		return m_nRows;
+	}
+
+	///	<summary>
+	///		Get the number of columns in the SparseMatrixCSR.
+	///	</summary>
+	int GetColumns() const {
+		return m_nCols;
+	}
+
+	///	<summary>
+	///		Get the number of non-zero entries in the SparseMatrixCSR.
+	///	</summary>
+	int GetNonZeroCount() const {
+		return static_cast<int>(m_vecEntries.GetRows());
+	}
+
+	///	<summary>
+	///		Get the array of row offsets (of length GetRows()+1).
+	///	</summary>
+	const DataVector<int> & GetRowOffsets() const {
+		return m_vecRowOffsets;
+	}
+
+	///	<summary>
+	///		Get the array of column indices.
+	///	</summary>
+	const DataVector<int> & GetColIndices() const {
+		return m_vecColIndices;
+	}
+
+	///	<summary>
+	///		Get the array of entries.
+	///	</summary>
+	const DataVector<DataType> & GetEntries() const {
+		return m_vecEntries;
+	}
+
+	///	<summary>
+	///		Get the array of row offsets (of length GetRows()+1).
+	///	</summary>
+	DataVector<int> & GetRowOffsets() {
+		return m_vecRowOffsets;
+	}
+
+	///	<summary>
+	///		Get the array of column indices.
+	///	</summary>
+	DataVector<int> & GetColIndices() {
+		return m_vecColIndices;
+	}
+
+	///	<summary>
+	///		Get the array of entries.
+	///	</summary>
+	DataVector<DataType> & GetEntries() {
+		return m_vecEntries;
+	}
+
+public:
+	///	<summary>
+	///		Write the operator to an open binary file.
+	///	</summary>
+	bool Write(
+		FILE * fp
+	) const {
+		int nDims[3];
+		nDims[0] = m_nRows;
+		nDims[1] = m_nCols;
+		nDims[2] = GetNonZeroCount();
+
+		if (fwrite(nDims, sizeof(int), 3, fp) != 3) {
+			return false;
+		}
+		if (m_nRows == 0) {
+			return true;
+		}
+		size_t sOffsets = static_cast<size_t>(m_nRows + 1);
+		if (fwrite(&(m_vecRowOffsets[0]), sizeof(int), sOffsets, fp)
+			!= sOffsets
+		) {
+			return false;
+		}
+		if (nDims[2] == 0) {
+			return true;
+		}
+		size_t sNonZeros = static_cast<size_t>(nDims[2]);
+		if (fwrite(&(m_vecColIndices[0]), sizeof(int), sNonZeros, fp)
+			!= sNonZeros
+		) {
+			return false;
+		}
+		if (fwrite(&(m_vecEntries[0]), sizeof(DataType), sNonZeros, fp)
+			!= sNonZeros
+		) {
+			return false;
+		}
+		return true;
+	}
+
+	///	<summary>
+	///		Read the operator from an open binary file written by Write().
+	///		Returns false and leaves the operator empty if the contents
+	///		are truncated or inconsistent.
+	///	</summary>
+	bool Read(
+		FILE * fp
+	) {
+		Clear();
+
+		int nDims[3];
+		if (fread(nDims, sizeof(int), 3, fp) != 3) {
+			return false;
+		}
+		if ((nDims[0] < 0) || (nDims[1] < 0) || (nDims[2] < 0)) {
+			return false;
+		}
+		if (nDims[0] == 0) {
+			m_nCols = nDims[1];
+			return (nDims[2] == 0);
+		}
+
+		m_vecRowOffsets.Initialize(nDims[0] + 1, false);
+		size_t sOffsets = static_cast<size_t>(nDims[0] + 1);
+		if (fread(&(m_vecRowOffsets[0]), sizeof(int), sOffsets, fp)
+			!= sOffsets
+		) {
+			Clear();
+			return false;
+		}
+		if ((m_vecRowOffsets[0] != 0) ||
+		    (m_vecRowOffsets[nDims[0]] != nDims[2])
+		) {
+			Clear();
+			return false;
+		}
+		for (int i = 0; i < nDims[0]; i++) {
+			if (m_vecRowOffsets[i+1] < m_vecRowOffsets[i]) {
+				Clear();
+				return false;
+			}
+		}
+
+		if (nDims[2] != 0) {
+			size_t sNonZeros = static_cast<size_t>(nDims[2]);
+			m_vecColIndices.Initialize(nDims[2], false);
+			m_vecEntries.Initialize(nDims[2], false);
+			if (fread(&(m_vecColIndices[0]), sizeof(int), sNonZeros, fp)
+				!= sNonZeros
+			) {
+				Clear();
+				return false;
+			}
+			if (fread(&(m_vecEntries[0]), sizeof(DataType), sNonZeros, fp)
+				!= sNonZeros
+			) {
+				Clear();
+				return false;
+			}
+			for (int k = 0; k < nDims[2]; k++) {
+				if ((m_vecColIndices[k] < 0) ||
+				    (m_vecColIndices[k] >= nDims[1])
+				) {
+					Clear();
+					return false;
+				}
+			}
+		}
+
+		m_nRows = nDims[0];
+		m_nCols = nDims[1];
+		return true;
+	}
+
+public:
+	///	<summary>
+	///		Apply the sparse matrix to a DataVector.  Rows are distributed
+	///		across threads and the entries of each row are accumulated in
+	///		column order, so the result is identical to SparseMatrix::Apply.
+	///	</summary>
+	void Apply(
+		const DataVector<DataType> & dataVectorIn,
+		DataVector<DataType> & dataVectorOut
+	) const {
+		if (static_cast<int>(dataVectorIn.GetRows()) < m_nCols) {
+			_EXCEPTION2("dataVectorIn has incorrect row count (%i < %i)",
+				dataVectorIn.GetRows(), m_nCols);
+		}
+		if (static_cast<int>(dataVectorOut.GetRows()) < m_nRows) {
+			_EXCEPTION2("dataVectorOut has incorrect row count (%i < %i)",
+				dataVectorOut.GetRows(), m_nRows);
+		}
+
+		const int nRows = m_nRows;
+		const int * const pRowOffsets = m_vecRowOffsets;
+		const int * const pColIndices = m_vecColIndices;
+		const DataType * const pEntries = m_vecEntries;
+		const DataType * const pIn = dataVectorIn;
+		DataType * const pOut = dataVectorOut;
+
+#pragma omp parallel for schedule(static)
+		for (int i = 0; i < nRows; i++) {
+			DataType dSum = static_cast<DataType>(0);
+			const int kEnd = pRowOffsets[i+1];
+			for (int k = pRowOffsets[i]; k < kEnd; k++) {
+				dSum += pEntries[k] * pIn[pColIndices[k]];
+			}
+			pOut[i] = dSum;
+		}
+
+		for (int i = nRows; i < static_cast<int>(dataVectorOut.GetRows()); i++) {
+			pOut[i] = static_cast<DataType>(0);
+		}
+	}
+
+	///	<summary>
+	///		Apply the given rows of the sparse matrix to a DataVector,
+	///		leaving all other entries of dataVectorOut unchanged.  Entries
+	///		are accumulated in the same order as Apply().
+	///	</summary>
+	void ApplyOnRows(
+		const DataVector<DataType> & dataVectorIn,
+		const std::vector<int> & vecRows,
+		DataVector<DataType> & dataVectorOut
+	) const {
+		if (static_cast<int>(dataVectorIn.GetRows()) < m_nCols) {
+			_EXCEPTION2("dataVectorIn has incorrect row count (%i < %i)",
+				dataVectorIn.GetRows(), m_nCols);
+		}
+		if (static_cast<int>(dataVectorOut.GetRows()) < m_nRows) {
+			_EXCEPTION2("dataVectorOut has incorrect row count (%i < %i)",
+				dataVectorOut.GetRows(), m_nRows);
+		}
+
+		const int nSelected = static_cast<int>(vecRows.size());
+		const int * const pRowOffsets = m_vecRowOffsets;
+		const int * const pColIndices = m_vecColIndices;
+		const DataType * const pEntries = m_vecEntries;
+		const DataType * const pIn = dataVectorIn;
+		DataType * const pOut = dataVectorOut;
+
+#pragma omp parallel for schedule(static)
+		for (int r = 0; r < nSelected; r++) {
+			const int i = vecRows[r];
+			if ((i < 0) || (i >= m_nRows)) {
+				continue;
+			}
+			DataType dSum = static_cast<DataType>(0);
+			const int kEnd = pRowOffsets[i+1];
+			for (int k = pRowOffsets[i]; k < kEnd; k++) {
+				dSum += pEntries[k] * pIn[pColIndices[k]];
+			}
+			pOut[i] = dSum;
+		}
+	}
+
+protected:
+	///	<summary>
+	///		Number of rows in the sparse matrix.
+	///	</summary>
+	int m_nRows;
+
+	///	<summary>
+	///		Number of columns in the sparse matrix.
+	///	</summary>
+	int m_nCols;
+
+	///	<summary>
+	///		Offset of the first entry of each row (length m_nRows+1).
+	///	</summary>
+	DataVector<int> m_vecRowOffsets;
+
+	///	<summary>
+	///		Column index of each entry.
+	///	</summary>
+	DataVector<int> m_vecColIndices;
+
+	///	<summary>
+	///		Value of each entry.
+	///	</summary>
+	DataVector<DataType> m_vecEntries;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
 #endif
 
@@ -0,0 +1,498 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+///	\file    SphericalKDTree.cpp
+///	\author  Paul Ullrich
+///	\version October 16, 2026
+///
+///	<remarks>
+///		Copyright 2000-2018 Paul Ullrich
+///
+///		This file is distributed as part of the Tempest source code package.
+///		Permission is granted to use, copy, modify and distribute this
+///		source code and its documentation under the terms of the GNU General
+///		Public License.  This software is provided "as is" without express
+///		or implied warranty.
+///	</remarks>
+
+#include "SphericalKDTree.h"
+#include "Exception.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+///////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+///	<summary>
+///		Comparator ordering point indices by one coordinate, with ties
+///		broken by index so that the tree layout is deterministic.
+///	</summary>
+class CoordinateLess {
+
+public:
+	CoordinateLess(
+		const std::vector<double> & vecCoord,
+		int iDim
+	) :
+		m_vecCoord(vecCoord),
+		m_iDim(iDim)
+	{ }
+
+	bool operator()(int i, int j) const {
+		double dI = m_vecCoord[3*i+m_iDim];
+		double dJ = m_vecCoord[3*j+m_iDim];
+		if (dI != dJ) {
+			return (dI < dJ);
+		}
+		return (i < j);
+	}
+
+protected:
+	const std::vector<double> & m_vecCoord;
+	int m_iDim;
+};
+
+///	<summary>
+///		Squared Euclidean distance between two points.
+///	</summary>
+inline double Dist2(
+	const double * dA,
+	const double * dB
+) {
+	double dDX = dA[0] - dB[0];
+	double dDY = dA[1] - dB[1];
+	double dDZ = dA[2] - dB[2];
+	return (dDX * dDX + dDY * dDY + dDZ * dDZ);
+}
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SphericalKDTree::Build(
+	int nPoints,
+	const double * dX,
+	const double * dY,
+	const double * dZ
+) {
+	Clear();
+
+	if (nPoints < 0) {
+		_EXCEPTIONT("Invalid number of points");
+	}
+
+	m_nPoints = nPoints;
+
+	// Coordinates indexed by original point index during the build
+	m_vecCoord.resize(3 * nPoints);
+	m_vecIndex.resize(nPoints);
+	m_vecSplitDim.resize(nPoints, 0);
+
+	for (int i = 0; i < nPoints; i++) {
+		m_vecCoord[3*i+0] = dX[i];
+		m_vecCoord[3*i+1] = dY[i];
+		m_vecCoord[3*i+2] = dZ[i];
+		m_vecIndex[i] = i;
+	}
+
+	BuildRange(0, nPoints);
+
+	// Reorder coordinates into tree order
+	std::vector<double> vecCoordTree(3 * nPoints);
+	for (int i = 0; i < nPoints; i++) {
+		int ix = m_vecIndex[i];
+		vecCoordTree[3*i+0] = m_vecCoord[3*ix+0];
+		vecCoordTree[3*i+1] = m_vecCoord[3*ix+1];
+		vecCoordTree[3*i+2] = m_vecCoord[3*ix+2];
+	}
+	m_vecCoord.swap(vecCoordTree);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SphericalKDTree::BuildFromLatLon(
+	int nPoints,
+	const double * dLat,
+	const double * dLon
+) {
+	std::vector<double> dX(nPoints);
+	std::vector<double> dY(nPoints);
+	std::vector<double> dZ(nPoints);
+
+	for (int i = 0; i < nPoints; i++) {
+		dX[i] = cos(dLon[i]) * cos(dLat[i]);
+		dY[i] = sin(dLon[i]) * cos(dLat[i]);
+		dZ[i] = sin(dLat[i]);
+	}
+
+	Build(nPoints, dX.data(), dY.data(), dZ.data());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SphericalKDTree::Clear() {
+	m_nPoints = 0;
+	m_vecCoord.clear();
+	m_vecIndex.clear();
+	m_vecSplitDim.clear();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SphericalKDTree::BuildRange(
+	int iBegin,
+	int iEnd
+) {
+	if (iEnd - iBegin <= 1) {
+		return;
+	}
+
+	// Split along the dimension of largest extent
+	double dMin[3] = { DBL_MAX,  DBL_MAX,  DBL_MAX};
+	double dMax[3] = {-DBL_MAX, -DBL_MAX, -DBL_MAX};
+
+	for (int i = iBegin; i < iEnd; i++) {
+		const double * dPos = &(m_vecCoord[3*m_vecIndex[i]]);
+		for (int d = 0; d < 3; d++) {
+			if (dPos[d] < dMin[d]) {
+				dMin[d] = dPos[d];
+			}
+			if (dPos[d] > dMax[d]) {
+				dMax[d] = dPos[d];
+			}
+		}
+	}
+
+	int iDim = 0;
+	for (int d = 1; d < 3; d++) {
+		if (dMax[d] - dMin[d] > dMax[iDim] - dMin[iDim]) {
+			iDim = d;
+		}
+	}
+
+	// Median of this range becomes the splitting node
+	int iMid = (iBegin + iEnd) / 2;
+
+	std::nth_element(
+		m_vecIndex.begin() + iBegin,
+		m_vecIndex.begin() + iMid,
+		m_vecIndex.begin() + iEnd,
+		CoordinateLess(m_vecCoord, iDim));
+
+	m_vecSplitDim[iMid] = static_cast<unsigned char>(iDim);
+
+	BuildRange(iBegin, iMid);
+	BuildRange(iMid+1, iEnd);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+int SphericalKDTree::Nearest(
+	double dX,
+	double dY,
+	double dZ,
+	double * pdDist2
+) const {
+	const double dPos[3] = {dX, dY, dZ};
+
+	int iBest = (-1);
+	double dBestDist2 = DBL_MAX;
+
+	NearestRange(0, m_nPoints, dPos, iBest, dBestDist2);
+
+	if (pdDist2 != NULL) {
+		(*pdDist2) = dBestDist2;
+	}
+	return iBest;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SphericalKDTree::NearestRange(
+	int iBegin,
+	int iEnd,
+	const double * dPos,
+	int & iBest,
+	double & dBestDist2
+) const {
+	if (iBegin >= iEnd) {
+		return;
+	}
+
+	int iMid = (iBegin + iEnd) / 2;
+	const double * dNode = &(m_vecCoord[3*iMid]);
+
+	double dDist2 = Dist2(dNode, dPos);
+	int ix = m_vecIndex[iMid];
+	if ((dDist2 < dBestDist2) ||
+	    ((dDist2 == dBestDist2) && (ix < iBest))
+	) {
+		iBest = ix;
+		dBestDist2 = dDist2;
+	}
+
+	int iDim = m_vecSplitDim[iMid];
+	double dDiff = dPos[iDim] - dNode[iDim];
+
+	if (dDiff <= 0.0) {
+		NearestRange(iBegin, iMid, dPos, iBest, dBestDist2);
+		if (dDiff * dDiff <= dBestDist2) {
+			NearestRange(iMid+1, iEnd, dPos, iBest, dBestDist2);
+		}
+	} else {
+		NearestRange(iMid+1, iEnd, dPos, iBest, dBestDist2);
+		if (dDiff * dDiff <= dBestDist2) {
+			NearestRange(iBegin, iMid, dPos, iBest, dBestDist2);
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+int SphericalKDTree::NearestK(
+	double dX,
+	double dY,
+	double dZ,
+	int nK,
+	int * piIndices,
+	double * pdDist2
+) const {
+	if (nK <= 0) {
+		return 0;
+	}
+
+	const double dPos[3] = {dX, dY, dZ};
+
+	int nFound = 0;
+	NearestKRange(0, m_nPoints, dPos, nK, nFound, piIndices, pdDist2);
+
+	return nFound;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SphericalKDTree::NearestKRange(
+	int iBegin,
+	int iEnd,
+	const double * dPos,
+	int nK,
+	int & nFound,
+	int * piIndices,
+	double * pdDist2
+) const {
+	if (iBegin >= iEnd) {
+		return;
+	}
+
+	int iMid = (iBegin + iEnd) / 2;
+	const double * dNode = &(m_vecCoord[3*iMid]);
+
+	double dDist2 = Dist2(dNode, dPos);
+	int ix = m_vecIndex[iMid];
+
+	// Insert into the sorted list of best points
+	if ((nFound < nK) ||
+	    (dDist2 < pdDist2[nK-1]) ||
+	    ((dDist2 == pdDist2[nK-1]) && (ix < piIndices[nK-1]))
+	) {
+		int n = (nFound < nK)?(nFound):(nK-1);
+		for (; n > 0; n--) {
+			if ((pdDist2[n-1] < dDist2) ||
+			    ((pdDist2[n-1] == dDist2) && (piIndices[n-1] < ix))
+			) {
+				break;
+			}
+			pdDist2[n] = pdDist2[n-1];
+			piIndices[n] = piIndices[n-1];
+		}
+		pdDist2[n] = dDist2;
+		piIndices[n] = ix;
+
+		if (nFound < nK) {
+			nFound++;
+		}
+	}
+
+	int iDim = m_vecSplitDim[iMid];
+	double dDiff = dPos[iDim] - dNode[iDim];
+
+	int iNearBegin = iBegin;
+	int iNearEnd = iMid;
+	int iFarBegin = iMid+1;
+	int iFarEnd = iEnd;
+	if (dDiff > 0.0) {
+		std::swap(iNearBegin, iFarBegin);
+		std::swap(iNearEnd, iFarEnd);
+	}
+
+	NearestKRange(
+		iNearBegin, iNearEnd, dPos, nK, nFound, piIndices, pdDist2);
+
+	if ((nFound < nK) || (dDiff * dDiff <= pdDist2[nK-1])) {
+		NearestKRange(
+			iFarBegin, iFarEnd, dPos, nK, nFound, piIndices, pdDist2);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+int SphericalKDTree::WithinRadius(
+	double dX,
+	double dY,
+	double dZ,
+	double dChordRadius,
+	std::vector<int> & vecIndices
+) const {
+	const double dPos[3] = {dX, dY, dZ};
+
+	vecIndices.clear();
+
+	WithinRadiusRange(
+		0, m_nPoints, dPos, dChordRadius * dChordRadius, vecIndices);
+
+	std::sort(vecIndices.begin(), vecIndices.end());
+
+	return static_cast<int>(vecIndices.size());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SphericalKDTree::WithinRadiusRange(
+	int iBegin,
+	int iEnd,
+	const double * dPos,
+	double dRadius2,
+	std::vector<int> & vecIndices
+) const {
+	if (iBegin >= iEnd) {
+		return;
+	}
+
+	int iMid = (iBegin + iEnd) / 2;
+	const double * dNode = &(m_vecCoord[3*iMid]);
+
+	if (Dist2(dNode, dPos) <= dRadius2) {
+		vecIndices.push_back(m_vecIndex[iMid]);
+	}
+
+	int iDim = m_vecSplitDim[iMid];
+	double dDiff = dPos[iDim] - dNode[iDim];
+
+	if ((dDiff <= 0.0) || (dDiff * dDiff <= dRadius2)) {
+		WithinRadiusRange(iBegin, iMid, dPos, dRadius2, vecIndices);
+	}
+	if ((dDiff >= 0.0) || (dDiff * dDiff <= dRadius2)) {
+		WithinRadiusRange(iMid+1, iEnd, dPos, dRadius2, vecIndices);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SphericalKDTree::NearestKBatch(
+	int nQueries,
+	const double * dX,
+	const double * dY,
+	const double * dZ,
+	int nK,
+	std::vector<int> & vecResultOffset,
+	std::vector<int> & vecResultIndex,
+	std::vector<double> * pvecResultDist2
+) const {
+
+	// Every query returns the same number of points
+	int nFound = (nK < m_nPoints)?(nK):(m_nPoints);
+	if (nFound < 0) {
+		nFound = 0;
+	}
+
+	vecResultOffset.resize(nQueries + 1);
+	for (int q = 0; q <= nQueries; q++) {
+		vecResultOffset[q] = q * nFound;
+	}
+
+	vecResultIndex.resize(nQueries * nFound);
+
+	std::vector<double> vecDist2Local;
+	std::vector<double> & vecDist2 =
+		(pvecResultDist2 != NULL)?(*pvecResultDist2):(vecDist2Local);
+
+	vecDist2.resize(nQueries * nFound);
+
+	if (nFound == 0) {
+		return;
+	}
+
+#pragma omp parallel for schedule(static)
+	for (int q = 0; q < nQueries; q++) {
+		NearestK(
+			dX[q], dY[q], dZ[q],
+			nFound,
+			&(vecResultIndex[q * nFound]),
+			&(vecDist2[q * nFound]));
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SphericalKDTree::WithinRadiusBatch(
+	int nQueries,
+	const double * dX,
+	const double * dY,
+	const double * dZ,
+	double dChordRadius,
+	std::vector<size_t> & vecResultOffset,
+	std::vector<int> & vecResultIndex
+) const {
+
+	// Number of points found for each query
+	std::vector<int> vecResultCount(nQueries, 0);
+
+	vecResultOffset.resize(nQueries + 1);
+	vecResultOffset[0] = 0;
+
+#pragma omp parallel
+{
+	// Queries evaluated by this thread and their results, in query order
+	std::vector<int> vecThreadQueries;
+	std::vector<int> vecThreadResults;
+
+	std::vector<int> vecIndices;
+
+#pragma omp for schedule(dynamic, 64)
+	for (int q = 0; q < nQueries; q++) {
+		int nFound =
+			WithinRadius(dX[q], dY[q], dZ[q], dChordRadius, vecIndices);
+
+		vecThreadQueries.push_back(q);
+		vecThreadResults.insert(
+			vecThreadResults.end(), vecIndices.begin(), vecIndices.end());
+
+		vecResultCount[q] = nFound;
+	}
+
+	// Allocate the result array once all counts are known
+#pragma omp single
+{
+	for (int q = 0; q < nQueries; q++) {
+		vecResultOffset[q+1] = vecResultOffset[q] + vecResultCount[q];
+	}
+	vecResultIndex.resize(vecResultOffset[nQueries]);
+}
+
+	// Merge thread-local results
+	size_t ixThread = 0;
+	for (int r = 0; r < vecThreadQueries.size(); r++) {
+		int q = vecThreadQueries[r];
+		size_t ixResult = vecResultOffset[q];
+		for (int l = 0; l < vecResultCount[q]; l++) {
+			vecResultIndex[ixResult + l] = vecThreadResults[ixThread];
+			ixThread++;
+		}
+	}
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
@@ -0,0 +1,232 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+///	\file    SphericalKDTree.h
+///	\author  Paul Ullrich
+///	\version October 16, 2026
+///
+///	<remarks>
+///		Copyright 2000-2018 Paul Ullrich
+///
+///		This file is distributed as part of the Tempest source code package.
+///		Permission is granted to use, copy, modify and distribute this
+///		source code and its documentation under the terms of the GNU General
+///		Public License.  This software is provided "as is" without express
+///		or implied warranty.
+///	</remarks>
+
+#ifndef _SPHERICALKDTREE_H_
+#define _SPHERICALKDTREE_H_
+
+#include <cstddef>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		A static three-dimensional kd-tree over points on the unit sphere.
+///		The tree is built in bulk and stored with an implicit layout: the
+///		points are permuted so that the median of each index range is the
+///		splitting node of that range.  Queries write into caller-provided
+///		buffers and do not allocate, and since the tree is never modified
+///		after it is built, concurrent queries from multiple threads are
+///		safe.  Distances are squared Euclidean (chord) distances and ties
+///		are broken in favor of the smallest point index.
+///	</summary>
+class SphericalKDTree {
+
+public:
+	///	<summary>
+	///		Default constructor.
+	///	</summary>
+	SphericalKDTree() :
+		m_nPoints(0)
+	{ }
+
+public:
+	///	<summary>
+	///		Build the tree from arrays of Cartesian coordinates.  Points
+	///		are identified in queries by their index in these arrays.
+	///	</summary>
+	void Build(
+		int nPoints,
+		const double * dX,
+		const double * dY,
+		const double * dZ
+	);
+
+	///	<summary>
+	///		Build the tree from arrays of latitude and longitude (in
+	///		radians).
+	///	</summary>
+	void BuildFromLatLon(
+		int nPoints,
+		const double * dLat,
+		const double * dLon
+	);
+
+	///	<summary>
+	///		Clear the tree.
+	///	</summary>
+	void Clear();
+
+	///	<summary>
+	///		Get the number of points in the tree.
+	///	</summary>
+	int GetSize() const {
+		return m_nPoints;
+	}
+
+public:
+	///	<summary>
+	///		Find the point nearest to the given point.  Returns (-1) if
+	///		the tree is empty.  If pdDist2 is non-NULL the squared chord
+	///		distance to the nearest point is stored there.
+	///	</summary>
+	int Nearest(
+		double dX,
+		double dY,
+		double dZ,
+		double * pdDist2 = NULL
+	) const;
+
+	///	<summary>
+	///		Find the k points nearest to the given point.  The indices and
+	///		squared chord distances are written to piIndices and pdDist2
+	///		(each of length at least nK) in order of increasing distance.
+	///		Returns the number of points found, which is less than nK only
+	///		if the tree contains fewer than nK points.
+	///	</summary>
+	int NearestK(
+		double dX,
+		double dY,
+		double dZ,
+		int nK,
+		int * piIndices,
+		double * pdDist2
+	) const;
+
+	///	<summary>
+	///		Find all points within the given chord distance (inclusive) of
+	///		the given point.  The indices are written to vecIndices, which
+	///		is cleared first and keeps its capacity between calls, in
+	///		order of increasing index.  Returns the number of points found.
+	///	</summary>
+	int WithinRadius(
+		double dX,
+		double dY,
+		double dZ,
+		double dChordRadius,
+		std::vector<int> & vecIndices
+	) const;
+
+public:
+	///	<summary>
+	///		Find the nK nearest points to each of nQueries query points.
+	///		Results are returned in compressed sparse row form: the
+	///		neighbors of query q are vecResultIndex[vecResultOffset[q]]
+	///		through vecResultIndex[vecResultOffset[q+1]-1], in order of
+	///		increasing distance.  If pvecResultDist2 is non-NULL it is
+	///		filled with the corresponding squared chord distances.  Queries
+	///		are evaluated in parallel.
+	///	</summary>
+	void NearestKBatch(
+		int nQueries,
+		const double * dX,
+		const double * dY,
+		const double * dZ,
+		int nK,
+		std::vector<int> & vecResultOffset,
+		std::vector<int> & vecResultIndex,
+		std::vector<double> * pvecResultDist2 = NULL
+	) const;
+
+	///	<summary>
+	///		Find all points within the given chord distance (inclusive) of
+	///		each of nQueries query points.  Results are returned in
+	///		compressed sparse row form as in NearestKBatch, with the
+	///		neighbors of each query in order of increasing index.  Offsets
+	///		are of type size_t since the total number of points found is
+	///		not bounded by the number of queries.  Queries are evaluated
+	///		in parallel.
+	///	</summary>
+	void WithinRadiusBatch(
+		int nQueries,
+		const double * dX,
+		const double * dY,
+		const double * dZ,
+		double dChordRadius,
+		std::vector<size_t> & vecResultOffset,
+		std::vector<int> & vecResultIndex
+	) const;
+
+protected:
+	///	<summary>
+	///		Recursively build the tree on the index range [iBegin, iEnd).
+	///	</summary>
+	void BuildRange(
+		int iBegin,
+		int iEnd
+	);
+
+	///	<summary>
+	///		Recursive nearest neighbor search on the range [iBegin, iEnd).
+	///	</summary>
+	void NearestRange(
+		int iBegin,
+		int iEnd,
+		const double * dPos,
+		int & iBest,
+		double & dBestDist2
+	) const;
+
+	///	<summary>
+	///		Recursive k-nearest neighbor search on the range [iBegin, iEnd).
+	///		The nFound best points are kept sorted by increasing distance.
+	///	</summary>
+	void NearestKRange(
+		int iBegin,
+		int iEnd,
+		const double * dPos,
+		int nK,
+		int & nFound,
+		int * piIndices,
+		double * pdDist2
+	) const;
+
+	///	<summary>
+	///		Recursive radius search on the range [iBegin, iEnd).
+	///	</summary>
+	void WithinRadiusRange(
+		int iBegin,
+		int iEnd,
+		const double * dPos,
+		double dRadius2,
+		std::vector<int> & vecIndices
+	) const;
+
+protected:
+	///	<summary>
+	///		Number of points in the tree.
+	///	</summary>
+	int m_nPoints;
+
+	///	<summary>
+	///		Coordinates of the points in tree order (interleaved xyz).
+	///	</summary>
+	std::vector<double> m_vecCoord;
+
+	///	<summary>
+	///		Original index of each point in tree order.
+	///	</summary>
+	std::vector<int> m_vecIndex;
+
+	///	<summary>
+	///		Splitting dimension of each node in tree order.
+	///	</summary>
+	std::vector<unsigned char> m_vecSplitDim;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+#endif
+
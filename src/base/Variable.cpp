@@ -15,14 +15,118 @@
 ///	</remarks>
 
 #include "Variable.h"
+#include "NetCDFUtilities.h"
+#include "FusedDataOp.h"
+#include "NcFilePool.h"
 
-#include <set>
+#include <cstdlib>
+
+///////////////////////////////////////////////////////////////////////////////
+// NcFileVector
+///////////////////////////////////////////////////////////////////////////////
+
+NcFileVector::NcFileVector() {
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+NcFileVector::~NcFileVector() {
+	NcFileVector::clear();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void NcFileVector::clear() {
+	std::lock_guard<std::recursive_mutex> lock(GetNetCDFMutex());
+
+	m_vecFilenames.clear();
+	m_vecHandles.clear();
+	m_mapVars.clear();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void NcFileVector::AddFile(
+	const std::string & strFilename
+) {
+	std::lock_guard<std::recursive_mutex> lock(GetNetCDFMutex());
+
+	m_vecFilenames.push_back(strFilename);
+	m_vecHandles.push_back(std::shared_ptr<NcFileHandle>());
+	m_mapVars.clear();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void NcFileVector::AddSharedFile(
+	const std::shared_ptr<NcFileHandle> & pHandle
+) {
+	std::lock_guard<std::recursive_mutex> lock(GetNetCDFMutex());
+
+	m_vecFilenames.push_back(pHandle->GetFilename());
+	m_vecHandles.push_back(pHandle);
+	m_mapVars.clear();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+NcFileHandle & NcFileVector::GetHandle(
+	size_t i
+) {
+	if (i >= m_vecFilenames.size()) {
+		_EXCEPTION2("File index %i out of range (%i files)",
+			static_cast<int>(i), static_cast<int>(m_vecFilenames.size()));
+	}
+	if (!m_vecHandles[i]) {
+		m_vecHandles[i] =
+			std::make_shared<NcFileHandle>(m_vecFilenames[i]);
+	}
+	return *(m_vecHandles[i]);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+NcFile * NcFileVector::GetFile(
+	size_t i
+) {
+	std::lock_guard<std::recursive_mutex> lock(GetNetCDFMutex());
+
+	return GetHandle(i).GetFile();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+NcVar * NcFileVector::FindVar(
+	const std::string & strName
+) {
+	std::lock_guard<std::recursive_mutex> lock(GetNetCDFMutex());
+
+	std::unordered_map<std::string, NcVar *>::const_iterator iter =
+		m_mapVars.find(strName);
+	if (iter != m_mapVars.end()) {
+		return iter->second;
+	}
+
+	for (size_t i = 0; i < m_vecFilenames.size(); i++) {
+		NcVar * var = GetHandle(i).GetVar(strName);
+		if (var != NULL) {
+			m_mapVars.insert(
+				std::pair<std::string, NcVar *>(strName, var));
+			return var;
+		}
+	}
+
+	return NULL;
+}
 
 ///////////////////////////////////////////////////////////////////////////////
 // VariableRegistry
 ///////////////////////////////////////////////////////////////////////////////
 
-VariableRegistry::VariableRegistry() {
+VariableRegistry::VariableRegistry() :
+	m_nTimeSlabSize(1),
+	m_sTimeSlabMemory(0)
+{
 	m_domDataOp.Add("_VECMAG");
 	m_domDataOp.Add("_ABS");
 	m_domDataOp.Add("_AVG");
@@ -30,6 +134,7 @@ VariableRegistry::VariableRegistry() {
 	m_domDataOp.Add("_DIV");
 	m_domDataOp.Add("_LAT");
 	m_domDataOp.Add("_F");
+	m_domDataOp.Add("_MEAN");
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -39,16 +144,89 @@ VariableRegistry::~VariableRegistry() {
 
 ///////////////////////////////////////////////////////////////////////////////
 
-int VariableRegistry::FindOrRegister(
+int VariableRegistry::FindOrRegisterVariable(
 	const Variable & var
 ) {
-	for (int i = 0; i < m_vecVariables.size(); i++) {
-		if (m_vecVariables[i] == var) {
-			return i;
-		}
+	std::string strKey = var.GetRegistryKey();
+
+	std::unordered_map<std::string, VariableIndex>::const_iterator iter =
+		m_mapVariableIndex.find(strKey);
+	if (iter != m_mapVariableIndex.end()) {
+		return iter->second;
 	}
+
+	VariableIndex varix = static_cast<VariableIndex>(m_vecVariables.size());
+
 	m_vecVariables.push_back(var);
-	return (m_vecVariables.size()-1);
+	m_mapVariableIndex.insert(
+		std::pair<std::string, VariableIndex>(strKey, varix));
+
+	m_vecRetained.push_back(false);
+	m_vecConsumers.push_back(0);
+	m_vecPendingTime.push_back(-2);
+	m_vecPendingConsumers.push_back(0);
+
+	// Count this operator as a consumer of each of its arguments
+	if (var.m_fOp) {
+		for (int i = 0; i < var.m_varArg.size(); i++) {
+			m_vecConsumers[var.m_varArg[i]]++;
+		}
+	}
+
+	return varix;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+int VariableRegistry::FindOrRegister(
+	const Variable & var
+) {
+	VariableIndex varix = FindOrRegisterVariable(var);
+	m_vecRetained[varix] = true;
+	return varix;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+int VariableRegistry::FindOrRegisterArgument(
+	const Variable & var
+) {
+	return FindOrRegisterVariable(var);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void VariableRegistry::ReleaseArgument(
+	VariableIndex varix,
+	int iTime
+) {
+	if ((varix < 0) || (varix >= m_vecVariables.size())) {
+		_EXCEPTIONT("Variable index out of range");
+	}
+
+	// First consumer evaluated at this time
+	if (m_vecPendingTime[varix] != iTime) {
+		m_vecPendingTime[varix] = iTime;
+		m_vecPendingConsumers[varix] = m_vecConsumers[varix];
+	}
+
+	m_vecPendingConsumers[varix]--;
+
+	if (m_vecPendingConsumers[varix] > 0) {
+		return;
+	}
+	if (m_vecRetained[varix]) {
+		return;
+	}
+
+	// Variables without a time dimension are only loaded once
+	Variable & var = m_vecVariables[varix];
+	if (var.m_fNoTimeInNcFile) {
+		return;
+	}
+
+	var.UnloadGridData();
+	var.m_data.Deinitialize();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -64,10 +242,106 @@ Variable & VariableRegistry::Get(
 
 ///////////////////////////////////////////////////////////////////////////////
 
+bool VariableRegistry::IsSingleUseIntermediate(
+	VariableIndex varix
+) const {
+	if ((varix < 0) || (varix >= m_vecVariables.size())) {
+		_EXCEPTIONT("Variable index out of range");
+	}
+	return ((!m_vecRetained[varix]) && (m_vecConsumers[varix] == 1));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
 void VariableRegistry::UnloadAllGridData() {
 	for (int i = 0; i < m_vecVariables.size(); i++) {
 		m_vecVariables[i].UnloadGridData();
+		m_vecPendingTime[i] = (-2);
+	}
+	m_listTimeSlabs.clear();
+	m_vecPrefetchedTimeSlabs.clear();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void VariableRegistry::SetTimeSlabSize(
+	int nTimeSlabSize,
+	size_t sTimeSlabMemory
+) {
+	if (nTimeSlabSize < 1) {
+		_EXCEPTIONT("Time slab size must be at least 1");
+	}
+
+	m_nTimeSlabSize = nTimeSlabSize;
+	m_sTimeSlabMemory = sTimeSlabMemory;
+	m_listTimeSlabs.clear();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+const float * VariableRegistry::FindTimeSlice(
+	const std::string & strKey,
+	int iTime
+) {
+	for (size_t i = 0; i < m_vecPrefetchedTimeSlabs.size(); i++) {
+		if (m_vecPrefetchedTimeSlabs[i].Contains(strKey, iTime)) {
+			return m_vecPrefetchedTimeSlabs[i].GetSlice(iTime);
+		}
+	}
+
+	std::list<VariableTimeSlab>::iterator iter = m_listTimeSlabs.begin();
+	for (; iter != m_listTimeSlabs.end(); iter++) {
+		if (iter->Contains(strKey, iTime)) {
+			m_listTimeSlabs.splice(
+				m_listTimeSlabs.begin(), m_listTimeSlabs, iter);
+			return iter->GetSlice(iTime);
+		}
+	}
+	return NULL;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+VariableTimeSlab & VariableRegistry::AllocateTimeSlab(
+	const std::string & strKey,
+	int iTimeBegin,
+	int nTimes,
+	size_t sSliceSize
+) {
+	size_t sSliceBytes = sSliceSize * sizeof(float);
+
+	// Reduce the number of time slices to fit in memory
+	if (sSliceBytes * nTimes > m_sTimeSlabMemory) {
+		nTimes = static_cast<int>(m_sTimeSlabMemory / sSliceBytes);
+		if (nTimes < 1) {
+			nTimes = 1;
+		}
+	}
+
+	// Evict least recently used slabs
+	size_t sUsedBytes = 0;
+	std::list<VariableTimeSlab>::iterator iter = m_listTimeSlabs.begin();
+	for (; iter != m_listTimeSlabs.end(); iter++) {
+		sUsedBytes += iter->m_data.GetRows() * sizeof(float);
+	}
+	while ((m_listTimeSlabs.size() != 0) &&
+	       (sUsedBytes + sSliceBytes * nTimes > m_sTimeSlabMemory)
+	) {
+		sUsedBytes -= m_listTimeSlabs.back().m_data.GetRows() * sizeof(float);
+		m_listTimeSlabs.pop_back();
 	}
+
+	// Allocate the new slab
+	m_listTimeSlabs.push_front(VariableTimeSlab());
+
+	VariableTimeSlab & slab = m_listTimeSlabs.front();
+	slab.m_strKey = strKey;
+	slab.m_iTimeBegin = iTimeBegin;
+	slab.m_nTimes = nTimes;
+	slab.m_sSliceSize = sSliceSize;
+	slab.m_data.Initialize(sSliceSize * nTimes);
+
+	return slab;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -114,6 +388,44 @@ bool Variable::operator==(
 
 ///////////////////////////////////////////////////////////////////////////////
 
+bool Variable::IsConstant() const {
+	if (m_fOp || (m_nSpecifiedDim != 0) || (m_strName.length() == 0)) {
+		return false;
+	}
+
+	char c = m_strName[0];
+	if (((c < '0') || (c > '9')) && (c != '.') && (c != '-') && (c != '+')) {
+		return false;
+	}
+
+	char * szEnd = NULL;
+	strtod(m_strName.c_str(), &szEnd);
+	return (*szEnd == '\0');
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::string Variable::GetRegistryKey() const {
+	char szBuffer[20];
+	std::string strKey = m_strName;
+	strKey += "(";
+	for (int d = 0; d < m_nSpecifiedDim; d++) {
+		if (m_fOp) {
+			sprintf(szBuffer, "%i", m_varArg[d]);
+		} else {
+			sprintf(szBuffer, "%i", m_iDim[d]);
+		}
+		strKey += szBuffer;
+		if (d != m_nSpecifiedDim-1) {
+			strKey += ",";
+		}
+	}
+	strKey += ")";
+	return strKey;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
 int Variable::ParseFromString(
 	VariableRegistry & varreg,
 	const std::string & strIn
@@ -231,7 +543,7 @@ int Variable::ParseFromString(
 			Variable var;
 			n += var.ParseFromString(varreg, strIn.substr(n));
 
-			m_varArg[m_nSpecifiedDim] = varreg.FindOrRegister(var);
+			m_varArg[m_nSpecifiedDim] = varreg.FindOrRegisterArgument(var);
 
 			m_nSpecifiedDim++;
 
@@ -283,14 +595,8 @@ NcVar * Variable::GetFromNetCDF(
 			m_strName.c_str());
 	}
 
-	// Find the NcVar in all open NcFiles
-	NcVar * var = NULL;
-	for (int i = 0; i < vecFiles.size(); i++) {
-		var = vecFiles[i]->get_var(m_strName.c_str());
-		if (var != NULL) {
-			break;
-		}
-	}
+	// Find the NcVar in the input files
+	NcVar * var = vecFiles.FindVar(m_strName);
 	if (var == NULL) {
 		_EXCEPTION1("Variable \"%s\" not found in input files",
 			m_strName.c_str());
@@ -360,7 +666,7 @@ void Variable::LoadGridData(
 	int iTime
 ) {
 	// Check if data already loaded
-	if (iTime == m_iTime) {
+	if ((iTime == m_iTime) && (!m_fPartial)) {
 		if (m_data.GetRows() != grid.GetSize()) {
 			_EXCEPTIONT("Logic error");
 		}
@@ -375,12 +681,38 @@ void Variable::LoadGridData(
 
 	//std::cout << "Loading " << ToString(varreg) << " " << iTime << std::endl;
 
+	if (IsConstant()) {
+		_EXCEPTION1("Constant \"%s\" cannot be used as a data variable",
+			m_strName.c_str());
+	}
+
 	// Allocate data
 	m_data.Initialize(grid.GetSize());
 	m_iTime = iTime;
+	m_fPartial = false;
+	m_vecNodeComputed.clear();
 
 	// Get the data directly from a variable
 	if (!m_fOp) {
+
+		// Check for this time slice in the time slabs
+		bool fUseTimeSlab =
+			((varreg.GetTimeSlabSize() > 1) && (iTime != (-1)));
+
+		std::string strKey;
+		if ((iTime != (-1)) && (fUseTimeSlab || varreg.HasTimeSlabs())) {
+			strKey = ToString(varreg);
+
+			const float * pSlice = varreg.FindTimeSlice(strKey, iTime);
+			if (pSlice != NULL) {
+				memcpy(&(m_data[0]), pSlice, grid.GetSize() * sizeof(float));
+				return;
+			}
+		}
+
+		// Other threads may be reading from NetCDF files
+		std::lock_guard<std::recursive_mutex> lock(GetNetCDFMutex());
+
 		// Get pointer to variable
 		NcVar * var = GetFromNetCDF(vecFiles, iTime);
 		if (var == NULL) {
@@ -441,6 +773,32 @@ void Variable::LoadGridData(
 			nDataSize[nVarDims-1] = nSize;
 		}
 
+		// Load a block of consecutive time slices into a new time slab
+		if (fUseTimeSlab && !m_fNoTimeInNcFile) {
+			int nTimes = var->get_dim(0)->size() - iTime;
+			if (nTimes > varreg.GetTimeSlabSize()) {
+				nTimes = varreg.GetTimeSlabSize();
+			}
+
+			VariableTimeSlab & slab =
+				varreg.AllocateTimeSlab(
+					strKey, iTime, nTimes, grid.GetSize());
+
+			nDataSize[0] = slab.m_nTimes;
+
+			var->get(&(slab.m_data[0]), &(nDataSize[0]));
+
+			NcError err;
+			if (err.get_err() != NC_NOERR) {
+				_EXCEPTION1("NetCDF Fatal Error (%i)", err.get_err());
+			}
+
+			memcpy(&(m_data[0]), slab.GetSlice(iTime),
+				grid.GetSize() * sizeof(float));
+
+			return;
+		}
+
 		// Load the data
 		var->get(&(m_data[0]), &(nDataSize[0]));
 
@@ -459,11 +817,42 @@ void Variable::LoadGridData(
 			_EXCEPTION1("Unexpected operator \"%s\"", m_strName.c_str());
 		}
 
-		// Build argument list
+		// Fuse nested elementwise operators
+		BuildFusedOp(varreg);
+
+		// Evaluate the fused operator
+		if (m_pFusedOp != NULL) {
+			const VariableIndexVector & vecInputs = m_pFusedOp->GetInputs();
+
+			std::vector<DataVector<float> const *> vecInputData;
+			for (int i = 0; i < vecInputs.size(); i++) {
+				Variable & var = varreg.Get(vecInputs[i]);
+				var.LoadGridData(varreg, vecFiles, grid, iTime);
+
+				vecInputData.push_back(&var.GetData());
+			}
+
+			m_pFusedOp->Apply(grid, vecInputData, m_data);
+
+			const VariableIndexVector & vecConsumedArgs =
+				m_pFusedOp->GetConsumedArguments();
+			for (int i = 0; i < vecConsumedArgs.size(); i++) {
+				varreg.ReleaseArgument(vecConsumedArgs[i], iTime);
+			}
+			return;
+		}
+
+		// Build argument list; constants are passed by value
 		std::vector<std::string> strArg;
 		std::vector<DataVector<float> const *> vecArgData;
 		for (int i = 0; i < m_varArg.size(); i++) {
 			Variable & var = varreg.Get(m_varArg[i]);
+			if (var.IsConstant()) {
+				strArg.push_back(var.m_strName);
+				vecArgData.push_back(NULL);
+				continue;
+			}
+
 			var.LoadGridData(varreg, vecFiles, grid, iTime);
 
 			strArg.push_back("");
@@ -472,104 +861,137 @@ void Variable::LoadGridData(
 
 		// Apply the DataOp
 		pop->Apply(grid, strArg, vecArgData, m_data);
-	}
-/*
-	// Evaluate the mean operator
-	} else if (m_strName == "_MEAN") {
-		if (m_varArg.size() != 2) {
-			_EXCEPTION1("_MEAN expects two arguments: %i given",
-				m_varArg.size());
-		}
 
-		// Obtain field and distance
-		Variable & varField = varreg.Get(m_varArg[0]);
-		Variable & varDist = varreg.Get(m_varArg[1]);
+		// Release intermediates that have no remaining consumers
+		for (int i = 0; i < m_varArg.size(); i++) {
+			varreg.ReleaseArgument(m_varArg[i], iTime);
+		}
+	}
+}
 
-		varField.LoadGridData(varreg, vecFiles, grid, iTime);
+///////////////////////////////////////////////////////////////////////////////
 
-		// Load distance (in degrees) and convert to radians
-		double dDist = atof(varDist.m_strName.c_str());
+void Variable::LoadGridDataOnNodes(
+	VariableRegistry & varreg,
+	NcFileVector & vecFiles,
+	const SimpleGrid & grid,
+	int iTime,
+	const std::vector<int> & vecNodes
+) {
+	// NetCDF variables are always loaded on all nodes
+	if (!m_fOp) {
+		LoadGridData(varreg, vecFiles, grid, iTime);
+		return;
+	}
 
-		if ((dDist < 0.0) || (dDist > 360.0)) {
-			_EXCEPTION1("Distance argument in _MEAN out of range\n"
-				"Expected [0,360], found %1.3e", dDist);
+	// Check if data already loaded on all nodes
+	if ((iTime == m_iTime) && (!m_fPartial)) {
+		if (m_data.GetRows() != grid.GetSize()) {
+			_EXCEPTIONT("Logic error");
 		}
+		return;
+	}
 
-		// Calculate mean of field
-		m_data.Zero();
+	// Get the associated operator
+	DataOp * pop = varreg.GetDataOp(m_strName);
+	if (pop == NULL) {
+		_EXCEPTION1("Unexpected operator \"%s\"", m_strName.c_str());
+	}
 
-		if (grid.m_vecConnectivity.size() != m_data.GetRows()) {
-			_EXCEPTIONT("Invalid grid connectivity array");
-		}
+	BuildFusedOp(varreg);
 
-		for (int i = 0; i < m_data.GetRows(); i++) {
-			std::set<int> setNodesVisited;
-			std::set<int> setNodesToVisit;
-			setNodesToVisit.insert(i);
+	if ((m_pFusedOp == NULL) && (!pop->SupportsApplyOnNodes())) {
+		LoadGridData(varreg, vecFiles, grid, iTime);
+		return;
+	}
 
-			double dLat0 = grid.m_dLat[i];
-			double dLon0 = grid.m_dLon[i];
+	// Begin a new time slice with no nodes computed
+	if ((iTime != m_iTime) || (m_data.GetRows() != grid.GetSize())) {
+		m_data.Initialize(grid.GetSize());
+		m_iTime = iTime;
+		m_fPartial = true;
+		m_vecNodeComputed.assign(grid.GetSize(), false);
+	}
 
-			while (setNodesToVisit.size() != 0) {
+	// Nodes that have not been computed at this time
+	std::vector<int> vecNewNodes;
+	for (int n = 0; n < vecNodes.size(); n++) {
+		int ix = vecNodes[n];
+		if ((ix < 0) || (ix >= static_cast<int>(grid.GetSize()))) {
+			_EXCEPTION1("Node index (%i) out of range", ix);
+		}
+		if (!m_vecNodeComputed[ix]) {
+			vecNewNodes.push_back(ix);
+		}
+	}
+	if (vecNewNodes.size() == 0) {
+		return;
+	}
 
-				// Next node to explore
-				int j = *(setNodesToVisit.begin());
+	// Evaluate the fused operator; inputs are only needed on these nodes
+	if (m_pFusedOp != NULL) {
+		const VariableIndexVector & vecInputs = m_pFusedOp->GetInputs();
 
-				setNodesToVisit.erase(setNodesToVisit.begin());
-				setNodesVisited.insert(j);
+		std::vector<DataVector<float> const *> vecInputData;
+		for (int i = 0; i < vecInputs.size(); i++) {
+			Variable & var = varreg.Get(vecInputs[i]);
+			var.LoadGridDataOnNodes(
+				varreg, vecFiles, grid, iTime, vecNewNodes);
 
-				// Update the mean
-				m_data[i] += varField.m_data[j];
+			vecInputData.push_back(&var.GetData());
+		}
 
-				// Find additional neighbors to explore
-				for (int k = 0; k < grid.m_vecConnectivity[j].size(); k++) {
-					int l = grid.m_vecConnectivity[j][k];
+		m_pFusedOp->ApplyOnNodes(grid, vecInputData, vecNewNodes, m_data);
 
-					// Check if already visited
-					if (setNodesVisited.find(l) != setNodesVisited.end()) {
-						continue;
-					}
+	// Evaluate the DataOp; arguments of elementwise operators are only
+	// needed on these nodes
+	} else {
+		bool fElementwise =
+			(dynamic_cast<DataOp_Elementwise *>(pop) != NULL);
 
-					// Test that this node satisfies the distance criteria
-					double dLat1 = grid.m_dLat[l];
-					double dLon1 = grid.m_dLon[l];
+		std::vector<std::string> strArg;
+		std::vector<DataVector<float> const *> vecArgData;
+		for (int i = 0; i < m_varArg.size(); i++) {
+			Variable & var = varreg.Get(m_varArg[i]);
+			if (var.IsConstant()) {
+				strArg.push_back(var.m_strName);
+				vecArgData.push_back(NULL);
+				continue;
+			}
 
-					double dR =
-						sin(dLat0) * sin(dLat1)
-						+ cos(dLat0) * cos(dLat1) * cos(dLon1 - dLon0);
+			if (fElementwise) {
+				var.LoadGridDataOnNodes(
+					varreg, vecFiles, grid, iTime, vecNewNodes);
+			} else {
+				var.LoadGridData(varreg, vecFiles, grid, iTime);
+			}
 
-					if (dR >= 1.0) {
-						dR = 0.0;
-					} else if (dR <= -1.0) {
-						dR = 180.0;
-					} else {
-						dR = 180.0 / M_PI * acos(dR);
-					}
-					if (dR != dR) {
-						_EXCEPTIONT("NaN value detected");
-					}
+			strArg.push_back("");
+			vecArgData.push_back(&var.GetData());
+		}
 
-					if (dR > dDist) {
-						continue;
-					}
+		pop->ApplyOnNodes(grid, strArg, vecArgData, vecNewNodes, m_data);
+	}
 
-					// Add node to visit
-					setNodesToVisit.insert(l);
-				}
-			}
+	for (int n = 0; n < vecNewNodes.size(); n++) {
+		m_vecNodeComputed[vecNewNodes[n]] = true;
+	}
+}
 
-			// Average data to obtain mean
-			if (setNodesVisited.size() == 0) {
-				_EXCEPTIONT("Logic error");
-			}
+///////////////////////////////////////////////////////////////////////////////
 
-			m_data[i] /= static_cast<float>(setNodesVisited.size());
-		}
+void Variable::BuildFusedOp(
+	VariableRegistry & varreg
+) {
+	if (m_fFusedOpBuilt) {
+		return;
+	}
 
-	} else {
-		_EXCEPTION1("Unexpected operator \"%s\"", m_strName.c_str());
+	std::shared_ptr<FusedDataOp> pFusedOp(new FusedDataOp);
+	if (pFusedOp->Build(varreg, *this)) {
+		m_pFusedOp = pFusedOp;
 	}
-*/
+	m_fFusedOpBuilt = true;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -578,6 +1000,7 @@ void Variable::UnloadGridData() {
 
 	// Force data to be loaded within this structure
 	m_iTime = (-2);
+	m_fPartial = false;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
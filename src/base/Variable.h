@@ -24,54 +24,133 @@
 #include "DataOp.h"
 
 #include <vector>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
 
 ///////////////////////////////////////////////////////////////////////////////
 
-class NcFileVector : public std::vector<NcFile *> {
+class NcFileHandle;
+
+///	<summary>
+///		A vector of NetCDF input files.  Files added by name are opened
+///		the first time they are accessed; files added with AddSharedFile()
+///		belong to a NcFilePool and are only released when the vector is
+///		cleared.  Variables are resolved to a file once by FindVar() and
+///		the result is cached for later lookups.
+///
+///		Access to the files is serialized by GetNetCDFMutex(), so a
+///		NcFileVector may be shared with an AsyncVariableReader.
+///	</summary>
+class NcFileVector {
 private:
 	///	<summary>
-	///		Copy constructor.
+	///		Copy constructor (not implemented).
 	///	</summary>
-	NcFileVector(const NcFileVector & vecFiles) {
-	}
+	NcFileVector(const NcFileVector &);
 
 	///	<summary>
-	///		Assignment operator.
+	///		Assignment operator (not implemented).
 	///	</summary>
-	NcFileVector & operator= (const NcFileVector & vecFiles) {
-		return (*this);
-	}
+	NcFileVector & operator= (const NcFileVector &);
 
 public:
 	///	<summary>
 	///		Default constructor.
 	///	</summary>
-	NcFileVector() :
-		std::vector<NcFile *>()
-	{ }
+	NcFileVector();
 
 	///	<summary>
 	///		Destructor.
 	///	</summary>
-	~NcFileVector() {
-		NcFileVector::clear();
-	}
+	~NcFileVector();
 
 	///	<summary>
 	///		Clear the contents of this NcFileVector.
 	///	</summary>
-	void clear() {
-		for (int i = 0; i < size(); i++) {
-			(*this)[i]->close();
-			delete (*this)[i];
-		}
+	void clear();
+
+	///	<summary>
+	///		Get the number of files.
+	///	</summary>
+	size_t size() const {
+		return m_vecFilenames.size();
+	}
+
+	///	<summary>
+	///		Add a file by name.  The file is not opened until it is first
+	///		accessed.
+	///	</summary>
+	void AddFile(
+		const std::string & strFilename
+	);
+
+	///	<summary>
+	///		Add a file shared with a NcFilePool.
+	///	</summary>
+	void AddSharedFile(
+		const std::shared_ptr<NcFileHandle> & pHandle
+	);
+
+	///	<summary>
+	///		Get the name of the i-th file.
+	///	</summary>
+	const std::string & GetFilename(size_t i) const {
+		return m_vecFilenames[i];
 	}
+
+	///	<summary>
+	///		Get the i-th file, opening it if necessary.
+	///	</summary>
+	NcFile * GetFile(size_t i);
+
+	///	<summary>
+	///		Get the i-th file, opening it if necessary.
+	///	</summary>
+	NcFile * operator[](size_t i) {
+		return GetFile(i);
+	}
+
+	///	<summary>
+	///		Find the variable with the given name in the first file that
+	///		contains it, or NULL if no file contains this variable.  Files
+	///		are opened in order until the variable is found.
+	///	</summary>
+	NcVar * FindVar(
+		const std::string & strName
+	);
+
+protected:
+	///	<summary>
+	///		Get the handle of the i-th file, opening it if necessary.
+	///		Must be called with GetNetCDFMutex() held.
+	///	</summary>
+	NcFileHandle & GetHandle(size_t i);
+
+protected:
+	///	<summary>
+	///		Names of the files.
+	///	</summary>
+	std::vector<std::string> m_vecFilenames;
+
+	///	<summary>
+	///		Handles of the files (NULL for files that have not been opened).
+	///	</summary>
+	std::vector< std::shared_ptr<NcFileHandle> > m_vecHandles;
+
+	///	<summary>
+	///		Variables that have been resolved by FindVar().
+	///	</summary>
+	std::unordered_map<std::string, NcVar *> m_mapVars;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
 
 class Variable;
 
+class FusedDataOp;
+
 typedef std::vector<Variable> VariableVector;
 
 typedef int VariableIndex;
@@ -80,6 +159,79 @@ class VariableIndexVector : public std::vector<VariableIndex> {};
 
 ///////////////////////////////////////////////////////////////////////////////
 
+///	<summary>
+///		A block of consecutive time slices of a NetCDF variable.
+///	</summary>
+class VariableTimeSlab {
+
+public:
+	///	<summary>
+	///		Constructor.
+	///	</summary>
+	VariableTimeSlab() :
+		m_iTimeBegin(0),
+		m_nTimes(0),
+		m_sSliceSize(0)
+	{ }
+
+	///	<summary>
+	///		Check if the given time slice of the given variable is stored
+	///		in this slab.
+	///	</summary>
+	bool Contains(
+		const std::string & strKey,
+		int iTime
+	) const {
+		return ((iTime >= m_iTimeBegin) &&
+		        (iTime < m_iTimeBegin + m_nTimes) &&
+		        (strKey == m_strKey));
+	}
+
+	///	<summary>
+	///		Get a pointer to the given time slice.
+	///	</summary>
+	const float * GetSlice(int iTime) const {
+		return &(m_data[(iTime - m_iTimeBegin) * m_sSliceSize]);
+	}
+
+public:
+	///	<summary>
+	///		Key identifying the variable.
+	///	</summary>
+	std::string m_strKey;
+
+	///	<summary>
+	///		First time index stored in this slab.
+	///	</summary>
+	int m_iTimeBegin;
+
+	///	<summary>
+	///		Number of time slices stored in this slab.
+	///	</summary>
+	int m_nTimes;
+
+	///	<summary>
+	///		Number of values in each time slice.
+	///	</summary>
+	size_t m_sSliceSize;
+
+	///	<summary>
+	///		Data in this slab, ordered by time.
+	///	</summary>
+	DataVector<float> m_data;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		A registry of variables, stored as an expression graph in which
+///		each distinct variable or subexpression appears exactly once.
+///		Operator arguments are referenced by index, so a subexpression
+///		shared by several expressions is evaluated once per time slice.
+///		Variables that are only referenced as operator arguments are
+///		intermediates: their data is released once every operator that
+///		consumes them has been evaluated at the current time slice.
+///	</summary>
 class VariableRegistry {
 
 public:
@@ -96,36 +248,182 @@ public:
 public:
 	///	<summary>
 	///		Register a variable.  Or return an index if the Variable already
-	///		exists in the registry.
+	///		exists in the registry.  The data of variables registered with
+	///		this function is retained after it is loaded.
 	///	</summary>
 	int FindOrRegister(const Variable & var);
 
+	///	<summary>
+	///		Register a variable that is an argument of an operator.  Or
+	///		return an index if the Variable already exists in the registry.
+	///		Unless the variable is also registered with FindOrRegister(),
+	///		its data is released once all of its consumers are evaluated.
+	///	</summary>
+	int FindOrRegisterArgument(const Variable & var);
+
+	///	<summary>
+	///		Indicate that an operator consuming the given variable has been
+	///		evaluated at the given time.  The data of an intermediate
+	///		variable is released after its last consumer.
+	///	</summary>
+	void ReleaseArgument(
+		VariableIndex varix,
+		int iTime
+	);
+
+	///	<summary>
+	///		Check if the given variable is an intermediate that is consumed
+	///		by exactly one operator.
+	///	</summary>
+	bool IsSingleUseIntermediate(VariableIndex varix) const;
+
 	///	<summary>
 	///		Get the variable with the specified index.
 	///	</summary>
 	Variable & Get(VariableIndex varix);
 
 	///	<summary>
-	///		Unload all data.
+	///		Unload all data.  This also clears all time slabs.
 	///	</summary>
 	void UnloadAllGridData();
 
+public:
+	///	<summary>
+	///		Set the number of consecutive time slices that are read in a
+	///		single request whenever a time slice of a NetCDF variable is
+	///		loaded, and the maximum memory (in bytes) used to hold them.
+	///		Later loads of any slice in the block are served from memory.
+	///		A size of 1 (the default) disables read-ahead.
+	///	</summary>
+	void SetTimeSlabSize(
+		int nTimeSlabSize,
+		size_t sTimeSlabMemory
+	);
+
+	///	<summary>
+	///		Get the number of time slices read in a single request.
+	///	</summary>
+	int GetTimeSlabSize() const {
+		return m_nTimeSlabSize;
+	}
+
+	///	<summary>
+	///		Get the maximum memory used by time slabs, in bytes.
+	///	</summary>
+	size_t GetTimeSlabMemory() const {
+		return m_sTimeSlabMemory;
+	}
+
+	///	<summary>
+	///		Check if any time slabs are stored.
+	///	</summary>
+	bool HasTimeSlabs() const {
+		return ((m_listTimeSlabs.size() != 0) ||
+		        (m_vecPrefetchedTimeSlabs.size() != 0));
+	}
+
+	///	<summary>
+	///		Replace the time slabs that have been read by another thread
+	///		(such as an AsyncVariableReader).  The contents of vecSlabs
+	///		are swapped into the registry.  These slabs are not subject
+	///		to the memory limit and are kept until they are replaced.
+	///	</summary>
+	void SetPrefetchedTimeSlabs(
+		std::vector<VariableTimeSlab> & vecSlabs
+	) {
+		m_vecPrefetchedTimeSlabs.swap(vecSlabs);
+	}
+
+	///	<summary>
+	///		Find the given time slice of a variable in the stored time
+	///		slabs.  Returns NULL if the slice is not available.
+	///	</summary>
+	const float * FindTimeSlice(
+		const std::string & strKey,
+		int iTime
+	);
+
+	///	<summary>
+	///		Allocate a new time slab for the given variable, evicting the
+	///		least recently used slabs as needed to stay within the memory
+	///		limit.  The number of time slices may be reduced from nTimes
+	///		to fit within the limit, but is always at least one.
+	///	</summary>
+	VariableTimeSlab & AllocateTimeSlab(
+		const std::string & strKey,
+		int iTimeBegin,
+		int nTimes,
+		size_t sSliceSize
+	);
+
 public:
 	///	<summary>
 	///		Get the DataOp with the specified name.
 	///	</summary>
 	DataOp * GetDataOp(const std::string & strName);
 
+protected:
+	///	<summary>
+	///		Register a variable, or return its index if it already exists.
+	///	</summary>
+	int FindOrRegisterVariable(const Variable & var);
+
 private:
 	///	<summary>
 	///		Array of variables.
 	///	</summary>
 	VariableVector m_vecVariables;
 
+	///	<summary>
+	///		Map from the key of each variable to its index.
+	///	</summary>
+	std::unordered_map<std::string, VariableIndex> m_mapVariableIndex;
+
+	///	<summary>
+	///		Flag indicating the data of each variable is retained.
+	///	</summary>
+	std::vector<bool> m_vecRetained;
+
+	///	<summary>
+	///		Number of times each variable appears as an operator argument.
+	///	</summary>
+	std::vector<int> m_vecConsumers;
+
+	///	<summary>
+	///		Time at which consumers of each variable are being counted.
+	///	</summary>
+	std::vector<int> m_vecPendingTime;
+
+	///	<summary>
+	///		Number of consumers of each variable not yet evaluated at the
+	///		time in m_vecPendingTime.
+	///	</summary>
+	std::vector<int> m_vecPendingConsumers;
+
 	///	<summary>
 	///		Map of data operators.
 	///	</summary>
 	DataOpManager m_domDataOp;
+
+	///	<summary>
+	///		Number of time slices read in a single request.
+	///	</summary>
+	int m_nTimeSlabSize;
+
+	///	<summary>
+	///		Maximum memory used by time slabs, in bytes.
+	///	</summary>
+	size_t m_sTimeSlabMemory;
+
+	///	<summary>
+	///		Time slabs, from most recently to least recently used.
+	///	</summary>
+	std::list<VariableTimeSlab> m_listTimeSlabs;
+
+	///	<summary>
+	///		Time slabs read by another thread.
+	///	</summary>
+	std::vector<VariableTimeSlab> m_vecPrefetchedTimeSlabs;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -150,7 +448,9 @@ public:
 		m_strName(),
 		m_nSpecifiedDim(0),
 		m_fNoTimeInNcFile(false),
-		m_iTime(-2)
+		m_iTime(-2),
+		m_fPartial(false),
+		m_fFusedOpBuilt(false)
 	{
 		memset(m_iDim, 0, MaxArguments * sizeof(int));
 	}
@@ -161,6 +461,18 @@ public:
 	///	</summary>
 	bool operator==(const Variable & var);
 
+	///	<summary>
+	///		Get a key that uniquely identifies this variable within its
+	///		VariableRegistry.  Operator arguments are identified by index.
+	///	</summary>
+	std::string GetRegistryKey() const;
+
+	///	<summary>
+	///		Check if this variable is a numerical constant, such as the
+	///		distance argument of _MEAN, rather than a NetCDF variable.
+	///	</summary>
+	bool IsConstant() const;
+
 public:
 	///	<summary>
 	///		Parse the variable information from a string.  Return the index
@@ -196,11 +508,39 @@ public:
 		int iTime = (-1)
 	);
 
+	///	<summary>
+	///		Load a data block from the NcFileVector, only evaluating
+	///		operators on the given nodes (which must be sorted in
+	///		increasing order without duplicates).  Nodes evaluated by
+	///		earlier calls at the same time are not evaluated again.
+	///		Values on other nodes are undefined until LoadGridData() is
+	///		called.  NetCDF variables and operators that cannot be applied
+	///		on a subset of nodes are loaded on all nodes.
+	///	</summary>
+	void LoadGridDataOnNodes(
+		VariableRegistry & varreg,
+		NcFileVector & vecFiles,
+		const SimpleGrid & grid,
+		int iTime,
+		const std::vector<int> & vecNodes
+	);
+
 	///	<summary>
 	///		Unload the current data block.
 	///	</summary>
 	void UnloadGridData();
 
+protected:
+	///	<summary>
+	///		Attempt to fuse this operator with its nested elementwise
+	///		arguments on first evaluation, once all variables have been
+	///		registered.
+	///	</summary>
+	void BuildFusedOp(
+		VariableRegistry & varreg
+	);
+
+public:
 	///	<summary>
 	///		Get the data associated with this variable.
 	///	</summary>
@@ -245,10 +585,33 @@ public:
 	///	</summary>
 	int m_iTime;
 
+	///	<summary>
+	///		Flag indicating the data at m_iTime has only been computed on
+	///		the nodes flagged in m_vecNodeComputed.
+	///	</summary>
+	bool m_fPartial;
+
+	///	<summary>
+	///		Bitmap of the nodes on which the data has been computed, if
+	///		m_fPartial is set.
+	///	</summary>
+	std::vector<bool> m_vecNodeComputed;
+
 	///	<summary>
 	///		Data associated with this Variable.
 	///	</summary>
 	DataVector<float> m_data;
+
+	///	<summary>
+	///		Flag indicating fusion of this operator has been attempted.
+	///	</summary>
+	bool m_fFusedOpBuilt;
+
+	///	<summary>
+	///		Fused kernel evaluating this operator and its nested
+	///		elementwise arguments, or NULL if there is nothing to fuse.
+	///	</summary>
+	std::shared_ptr<FusedDataOp> m_pFusedOp;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -20,6 +20,7 @@
 
 #include "DataVector.h"
 #include "DataMatrix.h"
+#include "SphericalKDTree.h"
 
 #include "netcdfcpp.h"
 #include "NetCDFUtilities.h"
@@ -29,8 +30,8 @@
 #include <cstdio>
 #include <cmath>
 #include <vector>
-#include <queue>
-#include <set>
+#include <string>
+#include <algorithm>
 
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -111,11 +112,15 @@ void GetTimeIndices(
 ///////////////////////////////////////////////////////////////////////////////
 
 ///	<summary>
-///		Find the maximum value of a field near the given point.
+///		Find the average and maximum value of a field near the given point.
 ///	</summary>
 ///	<param name="dMaxDist">
 ///		Maximum distance from the initial point in degrees.
 ///	</param>
+///	<param name="piStencil">
+///		Candidate grid points (as lat-lon indices flattened to iLat*nLon+iLon)
+///		that lie within approximately dMaxDist of the initial point.
+///	</param>
 void FindLocalAverage(
 	const DataMatrix<float> & data,
 	const DataVector<double> & dataLat,
@@ -123,6 +128,8 @@ void FindLocalAverage(
 	int iLat,
 	int iLon,
 	double dMaxDist,
+	const int * piStencil,
+	int nStencil,
 	float & dAverage,
 	float & dMaxValue
 ) {
@@ -131,17 +138,9 @@ void FindLocalAverage(
 		_EXCEPTIONT("MaxDist must be less than 180.0");
 	}
 
-	// Number of latitudes and longitudes
-	const int nLat = dataLat.GetRows();
+	// Number of longitudes
 	const int nLon = dataLon.GetRows();
 
-	// Queue of nodes that remain to be visited
-	std::queue< std::pair<int, int> > queueNodes;
-	queueNodes.push( std::pair<int, int>(iLat, iLon) );
-
-	// Set of nodes that have already been visited
-	std::set< std::pair<int, int> > setNodesVisited;
-
 	// Latitude and longitude at the origin
 	double dLat0 = dataLat[iLat];
 	double dLon0 = dataLon[iLon];
@@ -156,19 +155,13 @@ void FindLocalAverage(
 	// Reset maximum value
 	dMaxValue = data[iLat][iLon];
 
-	// Loop through all latlon elements
-	while (queueNodes.size() != 0) {
-		std::pair<int, int> pr = queueNodes.front();
-		queueNodes.pop();
-
-		if (setNodesVisited.find(pr) != setNodesVisited.end()) {
-			continue;
-		}
-
-		setNodesVisited.insert(pr);
+	// Loop through all candidate elements
+	for (int s = 0; s < nStencil; s++) {
+		int j = piStencil[s] / nLon;
+		int i = piStencil[s] % nLon;
 
-		double dLatThis = dataLat[pr.first];
-		double dLonThis = dataLon[pr.second];
+		double dLatThis = dataLat[j];
+		double dLonThis = dataLon[i];
 
 		// Great circle distance to this element
 		double dR =
@@ -194,35 +187,10 @@ void FindLocalAverage(
 		float dLocalArea = cos(dLatThis);
 
 		dArea += dLocalArea;
-		dSum += data[pr.first][pr.second] * dLocalArea;
-
-		if (data[pr.first][pr.second] > dMaxValue) {
-			dMaxValue = data[pr.first][pr.second];
-		}
-
-		// Add all neighbors of this point
-		std::pair<int,int> prWest(pr.first, (pr.second + nLon - 1) % nLon);
-		if (setNodesVisited.find(prWest) == setNodesVisited.end()) {
-			queueNodes.push(prWest);
-		}
-
-		std::pair<int,int> prEast(pr.first, (pr.second + 1) % nLon);
-		if (setNodesVisited.find(prEast) == setNodesVisited.end()) {
-			queueNodes.push(prEast);
-		}
-
-		std::pair<int,int> prNorth(pr.first + 1, pr.second);
-		if ((prNorth.first < nLat) &&
-			(setNodesVisited.find(prNorth) == setNodesVisited.end())
-		) {
-			queueNodes.push(prNorth);
-		}
+		dSum += data[j][i] * dLocalArea;
 
-		std::pair<int,int> prSouth(pr.first - 1, pr.second);
-		if ((prSouth.first >= 0) &&
-			(setNodesVisited.find(prSouth) == setNodesVisited.end())
-		) {
-			queueNodes.push(prSouth);
+		if (data[j][i] > dMaxValue) {
+			dMaxValue = data[j][i];
 		}
 	}
 
@@ -411,8 +379,13 @@ try {
 			strOutputFile.c_str());
 	}
 
-	// PRECT data matrix
-	DataMatrix<float> dPRECT(nLat, nLon);
+	// Read all nodes from the input file
+	AnnounceStartBlock("Reading nodes");
+
+	std::vector<std::string> vecNodeLines;
+	std::vector<int> vecNodeTime;
+	std::vector<int> vecNodeLat;
+	std::vector<int> vecNodeLon;
 
 	// Loop through all lines of input file
 	for (;;) {
@@ -490,6 +463,87 @@ try {
 			_EXCEPTION1("Time index (%i) out of range", iTime);
 		}
 
+		vecNodeLines.push_back(szSecondBuffer);
+		vecNodeTime.push_back(iTime);
+		vecNodeLat.push_back(iLat);
+		vecNodeLon.push_back(iLon);
+	}
+
+	int nNodes = vecNodeLines.size();
+
+	Announce("%i nodes found", nNodes);
+	AnnounceEndBlock("Done");
+
+	// Build a kd-tree of grid points
+	AnnounceStartBlock("Building kd-tree of grid points");
+
+	std::vector<double> vecGridLat(nLat * nLon);
+	std::vector<double> vecGridLon(nLat * nLon);
+	for (int j = 0; j < nLat; j++) {
+	for (int i = 0; i < nLon; i++) {
+		vecGridLat[j * nLon + i] = dataLat[j];
+		vecGridLon[j * nLon + i] = dataLon[i];
+	}
+	}
+
+	SphericalKDTree kdGrid;
+	kdGrid.BuildFromLatLon(nLat * nLon, vecGridLat.data(), vecGridLon.data());
+
+	// Chord distance, padded so that points exactly at dMaxDist are
+	// retained; the great circle test in FindLocalAverage is exact
+	double dSearchDist = dMaxDist * (1.0 + 1.0e-8) + 1.0e-8;
+	if (dSearchDist > 180.0) {
+		dSearchDist = 180.0;
+	}
+	double dChordDist = 2.0 * sin(0.5 * dSearchDist / 180.0 * M_PI);
+
+	AnnounceEndBlock("Done");
+
+	// PRECT data matrix
+	AnnounceStartBlock("Computing node data");
+
+	DataMatrix<float> dPRECT(nLat, nLon);
+
+	// Grid points near each node are found with one batched query per
+	// chunk of nodes, which bounds the memory used by the stencils
+	const int NodeChunkSize = 1024;
+
+	std::vector<double> vecNodeX(NodeChunkSize);
+	std::vector<double> vecNodeY(NodeChunkSize);
+	std::vector<double> vecNodeZ(NodeChunkSize);
+
+	std::vector<size_t> vecStencilOffset;
+	std::vector<int> vecStencilIndex;
+
+	int iChunkBegin = 0;
+
+	// Loop through all nodes
+	for (int n = 0; n < nNodes; n++) {
+
+		// Find grid points near the next chunk of nodes
+		if (n % NodeChunkSize == 0) {
+			iChunkBegin = n;
+			int nChunkNodes = std::min(NodeChunkSize, nNodes - n);
+
+			for (int m = 0; m < nChunkNodes; m++) {
+				double dLat = dataLat[vecNodeLat[n+m]];
+				double dLon = dataLon[vecNodeLon[n+m]];
+
+				vecNodeX[m] = cos(dLon) * cos(dLat);
+				vecNodeY[m] = sin(dLon) * cos(dLat);
+				vecNodeZ[m] = sin(dLat);
+			}
+
+			kdGrid.WithinRadiusBatch(
+				nChunkNodes,
+				vecNodeX.data(), vecNodeY.data(), vecNodeZ.data(),
+				dChordDist,
+				vecStencilOffset,
+				vecStencilIndex);
+		}
+
+		int iTime = vecNodeTime[n];
+
 		// Find the correct file
 		int iFile = (-1);
 		for (int f = 0; f < vecTimes.size()-1; f++) {
@@ -519,14 +573,19 @@ try {
 			dPRECT,
 			dataLat,
 			dataLon,
-			iLat,
-			iLon,
+			vecNodeLat[n],
+			vecNodeLon[n],
 			dMaxDist,
+			vecStencilIndex.data() + vecStencilOffset[n - iChunkBegin],
+			static_cast<int>(
+				vecStencilOffset[n - iChunkBegin + 1]
+				- vecStencilOffset[n - iChunkBegin]),
 			dAverage,
 			dMaxValue);
 
 		// Write to file
-		fprintf(fpout, "%s,\t%1.5e,\t%1.5e\n", szSecondBuffer, dAverage, dMaxValue);
+		fprintf(fpout, "%s,\t%1.5e,\t%1.5e\n",
+			vecNodeLines[n].c_str(), dAverage, dMaxValue);
 	}
 
 	fclose(fp);
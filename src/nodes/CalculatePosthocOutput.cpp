@@ -19,6 +19,7 @@
 #include "Announce.h"
 #include "Variable.h"
 #include "AutoCurator.h"
+#include "GraphSearchWorkspace.h"
 #include "DataMatrix.h"
 
 #include "netcdfcpp.h"
@@ -192,9 +193,9 @@ public:
 		}
 
 		// Check grid index
-		if (ix0 >= grid.m_vecConnectivity.size()) {
+		if (ix0 >= grid.GetSize()) {
 			_EXCEPTION2("Grid index (%i) out of range (< %i)",
-				ix0, static_cast<int>(grid.m_vecConnectivity.size()));
+				ix0, static_cast<int>(grid.GetSize()));
 		}
 
 		// Central lat/lon and Cartesian coord
@@ -209,28 +210,21 @@ public:
 		std::vector< std::vector<double> > dVelocities;
 		dVelocities.resize(m_nBins);
 
-		// Queue of nodes that remain to be visited
-		std::queue<int> queueNodes;
-		for (int n = 0; n < grid.m_vecConnectivity[ix0].size(); n++) {
-			queueNodes.push(grid.m_vecConnectivity[ix0][n]);
-		}
-
-		// Set of nodes that have already been visited
-		std::set<int> setNodesVisited;
+		// Nodes that remain to be visited
+		GraphSearchWorkspace & ws = GraphSearchWorkspace::GetForThread();
+		ws.Begin(grid.GetSize(), ix0);
 
 		// Loop through all latlon elements
-		while (queueNodes.size() != 0) {
-			int ix = queueNodes.front();
-			queueNodes.pop();
-
-			if (setNodesVisited.find(ix) != setNodesVisited.end()) {
-				continue;
-			}
-
-			setNodesVisited.insert(ix);
+		while (!ws.Empty()) {
+			int ix = ws.Pop();
 
 			// Don't perform calculation on central node
 			if (ix == ix0) {
+				const SimpleGrid::NeighborRange neighbors =
+					grid.GetNeighbors(ix0);
+				for (int n = 0; n < neighbors.size(); n++) {
+					ws.Visit(neighbors[n]);
+				}
 				continue;
 			}
 
@@ -324,8 +318,10 @@ public:
 			}
 
 			// Add all neighbors of this point
-			for (int n = 0; n < grid.m_vecConnectivity[ix].size(); n++) {
-				queueNodes.push(grid.m_vecConnectivity[ix][n]);
+			const SimpleGrid::NeighborRange neighbors =
+				grid.GetNeighbors(ix);
+			for (int n = 0; n < neighbors.size(); n++) {
+				ws.Visit(neighbors[n]);
 			}
 		}
 
@@ -588,6 +584,9 @@ try {
 	// Input list of data files
 	std::string strInputDataList;
 
+	// Persistent index of the times in the data files
+	std::string strInputDataIndex;
+
 	// Connectivity file
 	std::string strConnectivity;
 
@@ -613,6 +612,7 @@ try {
 		CommandLineStringD(strInputFileType, "in_file_type", "SN", "[DCU|SN]");
 		CommandLineString(strInputData, "in_data", "");
 		CommandLineString(strInputDataList, "in_data_list", "");
+		CommandLineString(strInputDataIndex, "in_data_index", "");
 		CommandLineString(strConnectivity, "in_connect", "");
 		CommandLineBool(fRegional, "regional");
 
@@ -678,6 +678,9 @@ try {
 
 	// Curate input data
 	AnnounceStartBlock("Autocurating data");
+	if (strInputDataIndex.length() != 0) {
+		autocurator.SetIndexFile(strInputDataIndex);
+	}
 	if (strInputData.length() != 0) {
 		autocurator.IndexFiles(strInputData);
 
@@ -698,6 +701,7 @@ try {
 			autocurator.IndexFiles(strFileLine);
 		}
 	}
+	autocurator.WriteIndexFile();
 	AnnounceEndBlock("Done");
 
 	// Check for connectivity file
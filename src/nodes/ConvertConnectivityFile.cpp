@@ -0,0 +1,81 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+///	\file    ConvertConnectivityFile.cpp
+///	\author  Paul Ullrich
+///	\version October 16, 2026
+///
+///	<remarks>
+///		Copyright 2000-2018 Paul Ullrich
+///
+///		This file is distributed as part of the Tempest source code package.
+///		Permission is granted to use, copy, modify and distribute this
+///		source code and its documentation under the terms of the GNU General
+///		Public License.  This software is provided "as is" without express
+///		or implied warranty.
+///	</remarks>
+
+#include "CommandLine.h"
+#include "Exception.h"
+#include "Announce.h"
+
+#include "SimpleGrid.h"
+
+#include <string>
+
+///////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char** argv) {
+
+try {
+	// Input connectivity file
+	std::string strInputFile;
+
+	// Output connectivity file
+	std::string strOutputFile;
+
+	// Store unit vectors in the output file
+	bool fUnitVectors;
+
+	// Parse the command line
+	BeginCommandLine()
+		CommandLineString(strInputFile, "in_connect", "");
+		CommandLineString(strOutputFile, "out_connect", "");
+		CommandLineBool(fUnitVectors, "unitvectors");
+
+		ParseCommandLine(argc, argv);
+	EndCommandLine(argv)
+
+	AnnounceBanner();
+
+	// Check arguments
+	if (strInputFile == "") {
+		_EXCEPTIONT("No input connectivity file (--in_connect) specified");
+	}
+	if (strOutputFile == "") {
+		_EXCEPTIONT("No output connectivity file (--out_connect) specified");
+	}
+
+	// Load the grid
+	SimpleGrid grid;
+
+	AnnounceStartBlock("Loading connectivity file");
+	grid.FromFile(strInputFile);
+	Announce("Grid points: %lu", grid.GetSize());
+	Announce("Connectivity entries: %lu",
+		grid.m_vecConnectivityIndex.size());
+	AnnounceEndBlock("Done");
+
+	// Write the binary grid
+	AnnounceStartBlock("Writing binary connectivity file");
+	grid.ToBinaryFile(strOutputFile, fUnitVectors);
+	AnnounceEndBlock("Done");
+
+	AnnounceBanner();
+
+} catch(Exception & e) {
+	Announce(e.ToString().c_str());
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
@@ -23,18 +23,26 @@
 #include "TimeObj.h"
 #include "NodeOutputOp.h"
 #include "SimpleGridUtilities.h"
+#include "GraphSearchWorkspace.h"
+#include "RadiusStencilCache.h"
+#include "AsyncVariableReader.h"
+#include "MPIFileScheduler.h"
+#include "ContourTree.h"
 
-#include "kdtree.h"
+#include "SphericalKDTree.h"
 
 #include "netcdfcpp.h"
 
 #include <cstdlib>
 #include <cstdio>
+#include <climits>
 #include <cmath>
 #include <vector>
 #include <string>
 #include <set>
 #include <queue>
+#include <algorithm>
+#include <chrono>
 
 #if defined(TEMPEST_MPIOMP)
 #include <mpi.h>
@@ -327,11 +335,12 @@ public:
 ///////////////////////////////////////////////////////////////////////////////
 
 ///	<summary>
-///		Parse the list of input files.
+///		Parse the list of input files.  Files are opened when they are
+///		first accessed.
 ///	</summary>
 void ParseInputFiles(
 	const std::string & strInputFile,
-	std::vector<NcFile *> & vecFiles
+	NcFileVector & vecFiles
 ) {
 	int iLast = 0;
 	for (int i = 0; i <= strInputFile.length(); i++) {
@@ -341,14 +350,7 @@ void ParseInputFiles(
 			std::string strFile =
 				strInputFile.substr(iLast, i - iLast);
 
-			NcFile * pNewFile = new NcFile(strFile.c_str());
-
-			if (!pNewFile->is_valid()) {
-				_EXCEPTION1("Cannot open input file \"%s\"",
-					strFile.c_str());
-			}
-
-			vecFiles.push_back(pNewFile);
+			vecFiles.AddFile(strFile);
 			iLast = i+1;
 		}
 	}
@@ -361,6 +363,45 @@ void ParseInputFiles(
 
 ///////////////////////////////////////////////////////////////////////////////
 
+///	<summary>
+///		Find the origin of the closed contour search about this point,
+///		which is the local minimum (for positive dDeltaAmt) or maximum (for
+///		negative dDeltaAmt) within dMinMaxDist.
+///	</summary>
+template <typename real>
+int FindClosedContourOrigin(
+	const SimpleGrid & grid,
+	const DataVector<real> & dataState,
+	const int ix0,
+	double dDeltaAmt,
+	double dMinMaxDist,
+	RadiusStencilCache * pStencilCache
+) {
+	if (dMinMaxDist == 0.0) {
+		return ix0;
+	}
+
+	// Find a local minimum / maximum
+	int ixOrigin;
+	real dValue;
+	float dR;
+
+	FindLocalMinMax<real>(
+		grid,
+		(dDeltaAmt > 0.0),
+		dataState,
+		ix0,
+		dMinMaxDist,
+		ixOrigin,
+		dValue,
+		dR,
+		pStencilCache);
+
+	return ixOrigin;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
 ///	<summary>
 ///		Determine if the given field has a closed contour about this point.
 ///	</summary>
@@ -371,7 +412,8 @@ bool HasClosedContour(
 	const int ix0,
 	double dDeltaAmt,
 	double dDeltaDist,
-	double dMinMaxDist
+	double dMinMaxDist,
+	RadiusStencilCache * pStencilCache
 ) {
 	// Verify arguments
 	if (dDeltaAmt == 0.0) {
@@ -382,82 +424,42 @@ bool HasClosedContour(
 	}
 
 	// Find min/max near point
-	int ixOrigin;
-
-	if (dMinMaxDist == 0.0) {
-		ixOrigin = ix0;
-
-	// Find a local minimum / maximum
-	} else {
-		real dValue;
-		float dR;
-
-		FindLocalMinMax<real>(
+	int ixOrigin =
+		FindClosedContourOrigin<real>(
 			grid,
-			(dDeltaAmt > 0.0),
 			dataState,
 			ix0,
+			dDeltaAmt,
 			dMinMaxDist,
-			ixOrigin,
-			dValue,
-			dR);
-	}
+			pStencilCache);
 
 	//printf("%lu %lu : %lu %lu : %1.5f %1.5f\n", ix0 % grid.m_nGridDim[1], ix0 / grid.m_nGridDim[1], ixOrigin % grid.m_nGridDim[1], ixOrigin / grid.m_nGridDim[1], dataState[ix0], dataState[ixOrigin]);
 
-	// Set of visited nodes
-	std::set<int> setNodesVisited;
-
-	// Set of nodes to visit
-	std::queue<int> queueToVisit;
-	queueToVisit.push(ixOrigin);
+	// Nodes to visit
+	GraphSearchWorkspace & ws = GraphSearchWorkspace::GetForThread();
+	ws.Begin(grid.GetSize(), ixOrigin);
 
 	// Reference value
 	real dRefValue = dataState[ixOrigin];
 
-	const double dLat0 = grid.m_dLat[ixOrigin];
-	const double dLon0 = grid.m_dLon[ixOrigin];
+	// Distance threshold
+	const SimpleGrid::DistanceThreshold distDelta(dDeltaDist);
 
 	Announce(2, "Checking (%lu) : (%1.5f %1.5f)",
-		ixOrigin, dLat0, dLon0);
+		ixOrigin, grid.m_dLat[ixOrigin], grid.m_dLon[ixOrigin]);
 
 	// Build up nodes
-	while (queueToVisit.size() != 0) {
-		int ix = queueToVisit.front();
-		queueToVisit.pop();
-
-		if (setNodesVisited.find(ix) != setNodesVisited.end()) {
-			continue;
-		}
-
-		setNodesVisited.insert(ix);
-
-		// Great circle distance to this element
-		double dLatThis = grid.m_dLat[ix];
-		double dLonThis = grid.m_dLon[ix];
-
-		double dR =
-			sin(dLat0) * sin(dLatThis)
-			+ cos(dLat0) * cos(dLatThis) * cos(dLonThis - dLon0);
+	while (!ws.Empty()) {
+		int ix = ws.Pop();
 
-		if (dR >= 1.0) {
-			dR = 0.0;
-		} else if (dR <= -1.0) {
-			dR = 180.0;
-		} else {
-			dR = 180.0 / M_PI * acos(dR);
-		}
-		if (dR != dR) {
-			_EXCEPTIONT("NaN value detected");
+		if (AnnounceGetVerbosityLevel() >= 2) {
+			Announce(2, "-- (%lu) : (%1.5f %1.5f) : dx %1.5f",
+				ix, grid.m_dLat[ix], grid.m_dLon[ix],
+				grid.GreatCircleDistance(ixOrigin, ix));
 		}
 
-		Announce(2, "-- (%lu) : (%1.5f %1.5f) : dx %1.5f",
-			ix, dLatThis, dLonThis, dR);
-
-		//printf("-- (%lu %lu) %1.5f %1.5f\n", ix % grid.m_nGridDim[1], ix / grid.m_nGridDim[1], dR, dataState[ix] - dRefValue);
-
 		// Check great circle distance
-		if (dR > dDeltaDist) {
+		if (!grid.IsWithinDistance(ixOrigin, ix, distDelta)) {
 			Announce(2, "Failed criteria; returning");
 			AnnounceEndBlock(2, NULL);
 			return false;
@@ -477,8 +479,10 @@ bool HasClosedContour(
 		}
 
 		// Add all neighbors of this point
-		for (int n = 0; n < grid.m_vecConnectivity[ix].size(); n++) {
-			queueToVisit.push(grid.m_vecConnectivity[ix][n]);
+		const SimpleGrid::NeighborRange neighbors =
+			grid.GetNeighbors(ix);
+		for (int n = 0; n < neighbors.size(); n++) {
+			ws.Visit(neighbors[n]);
 		}
 	}
 
@@ -490,6 +494,53 @@ bool HasClosedContour(
 
 ///////////////////////////////////////////////////////////////////////////////
 
+///	<summary>
+///		Determine if the given value satisfies the threshold operation.
+///	</summary>
+bool SatisfiesThresholdOp(
+	const ThresholdOp::Operation op,
+	const double dValue,
+	const double dTargetValue
+) {
+	if (op == ThresholdOp::GreaterThan) {
+		if (dValue > dTargetValue) {
+			return true;
+		}
+
+	} else if (op == ThresholdOp::LessThan) {
+		if (dValue < dTargetValue) {
+			return true;
+		}
+
+	} else if (op == ThresholdOp::GreaterThanEqualTo) {
+		if (dValue >= dTargetValue) {
+			return true;
+		}
+
+	} else if (op == ThresholdOp::LessThanEqualTo) {
+		if (dValue <= dTargetValue) {
+			return true;
+		}
+
+	} else if (op == ThresholdOp::EqualTo) {
+		if (dValue == dTargetValue) {
+			return true;
+		}
+
+	} else if (op == ThresholdOp::NotEqualTo) {
+		if (dValue != dTargetValue) {
+			return true;
+		}
+
+	} else {
+		_EXCEPTIONT("Invalid operation");
+	}
+
+	return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
 ///	<summary>
 ///		Determine if the given field satisfies the threshold.
 ///	</summary>
@@ -500,109 +551,414 @@ bool SatisfiesThreshold(
 	const int ix0,
 	const ThresholdOp::Operation op,
 	const double dTargetValue,
-	const double dMaxDist
+	const double dMaxDist,
+	RadiusStencilCache * pStencilCache
 ) {
 	// Verify that dMaxDist is less than 180.0
 	if (dMaxDist > 180.0) {
 		_EXCEPTIONT("MaxDist must be less than 180.0");
 	}
 
-	// Queue of nodes that remain to be visited
-	std::queue<int> queueNodes;
-	queueNodes.push(ix0);
+	// Scan the cached stencil
+	const int * pStencil;
+	int nStencilSize;
+
+	if ((dMaxDist != 0.0) &&
+	    (pStencilCache != NULL) &&
+	    (pStencilCache->GetStencil(ix0, dMaxDist, pStencil, nStencilSize))
+	) {
+		for (int s = 0; s < nStencilSize; s++) {
+			if (SatisfiesThresholdOp(
+				op, dataState[pStencil[s]], dTargetValue)
+			) {
+				return true;
+			}
+		}
+		return false;
+	}
 
-	// Set of nodes that have already been visited
-	std::set<int> setNodesVisited;
+	// Nodes that remain to be visited
+	GraphSearchWorkspace & ws = GraphSearchWorkspace::GetForThread();
+	ws.Begin(grid.GetSize(), ix0);
 
-	// Latitude and longitude at the origin
-	double dLat0 = grid.m_dLat[ix0];
-	double dLon0 = grid.m_dLon[ix0];
+	// Distance threshold
+	const SimpleGrid::DistanceThreshold distMax(dMaxDist);
 
 	// Loop through all latlon elements
-	while (queueNodes.size() != 0) {
-		int ix = queueNodes.front();
-		queueNodes.pop();
+	while (!ws.Empty()) {
+		int ix = ws.Pop();
 
-		if (setNodesVisited.find(ix) != setNodesVisited.end()) {
+		// Distance to this element
+		if ((ix != ix0) && !grid.IsWithinDistance(ix0, ix, distMax)) {
 			continue;
 		}
 
-		setNodesVisited.insert(ix);
-
-		// Great circle distance to this element
-		double dLatThis = grid.m_dLat[ix];
-		double dLonThis = grid.m_dLon[ix];
-
-		double dR =
-			sin(dLat0) * sin(dLatThis)
-			+ cos(dLat0) * cos(dLatThis) * cos(dLonThis - dLon0);
+		// Value at this location
+		double dValue = dataState[ix];
 
-		if (dR >= 1.0) {
-			dR = 0.0;
-		} else if (dR <= -1.0) {
-			dR = 180.0;
-		} else {
-			dR = 180.0 / M_PI * acos(dR);
+		// Apply operator
+		if (SatisfiesThresholdOp(op, dValue, dTargetValue)) {
+			return true;
 		}
-		if (dR != dR) {
-			_EXCEPTIONT("NaN value detected");
+
+		// Special case: zero distance
+		if (dMaxDist == 0.0) {
+			return false;
 		}
 
-		if ((ix != ix0) && (dR > dMaxDist)) {
-			continue;
+		// Add all neighbors of this point
+		const SimpleGrid::NeighborRange neighbors =
+			grid.GetNeighbors(ix);
+		for (int n = 0; n < neighbors.size(); n++) {
+			ws.Visit(neighbors[n]);
 		}
+	}
 
-		// Value at this location
-		double dValue = dataState[ix];
+	return false;
+}
 
-		// Apply operator
-		if (op == ThresholdOp::GreaterThan) {
-			if (dValue > dTargetValue) {
-				return true;
-			}
+///////////////////////////////////////////////////////////////////////////////
 
-		} else if (op == ThresholdOp::LessThan) {
-			if (dValue < dTargetValue) {
-				return true;
-			}
+///	<summary>
+///		Load the data of a variable that is only read within the given
+///		distance of the candidates.  With lazy evaluation, operators are
+///		only evaluated on these nodes unless they cover most of the grid.
+///	</summary>
+void LoadGridDataNearCandidates(
+	Variable & var,
+	VariableRegistry & varreg,
+	NcFileVector & vecFiles,
+	const SimpleGrid & grid,
+	int iTime,
+	const std::set<int> & setCandidates,
+	double dDist,
+	bool fLazyEvaluation
+) {
+	if ((!fLazyEvaluation) || (!var.m_fOp)) {
+		var.LoadGridData(varreg, vecFiles, grid, iTime);
+		return;
+	}
 
-		} else if (op == ThresholdOp::GreaterThanEqualTo) {
-			if (dValue >= dTargetValue) {
-				return true;
-			}
+	// Flag all nodes reachable from a candidate through nodes within the
+	// distance; a small tolerance guards against roundoff in searches
+	// about nodes other than the candidate
+	std::vector<bool> vecNear(grid.GetSize(), false);
 
-		} else if (op == ThresholdOp::LessThanEqualTo) {
-			if (dValue <= dTargetValue) {
-				return true;
-			}
+	const SimpleGrid::DistanceThreshold distMax(dDist + 1.0e-6);
 
-		} else if (op == ThresholdOp::EqualTo) {
-			if (dValue == dTargetValue) {
-				return true;
+	GraphSearchWorkspace & ws = GraphSearchWorkspace::GetForThread();
+
+	std::set<int>::const_iterator iterCandidate = setCandidates.begin();
+	for (; iterCandidate != setCandidates.end(); iterCandidate++) {
+		int ix0 = *iterCandidate;
+
+		ws.Begin(grid.GetSize(), ix0);
+		while (!ws.Empty()) {
+			int ix = ws.Pop();
+
+			if ((ix != ix0) && !grid.IsWithinDistance(ix0, ix, distMax)) {
+				continue;
 			}
 
-		} else if (op == ThresholdOp::NotEqualTo) {
-			if (dValue != dTargetValue) {
-				return true;
+			vecNear[ix] = true;
+
+			const SimpleGrid::NeighborRange neighbors =
+				grid.GetNeighbors(ix);
+			for (int n = 0; n < neighbors.size(); n++) {
+				ws.Visit(neighbors[n]);
 			}
+		}
+	}
+
+	std::vector<int> vecNodes;
+	for (int ix = 0; ix < vecNear.size(); ix++) {
+		if (vecNear[ix]) {
+			vecNodes.push_back(ix);
+		}
+	}
+
+	// Evaluating most of the grid node-by-node is slower than a full pass
+	if (2 * vecNodes.size() >= grid.GetSize()) {
+		var.LoadGridData(varreg, vecFiles, grid, iTime);
+	} else {
+		var.LoadGridDataOnNodes(varreg, vecFiles, grid, iTime, vecNodes);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		Rethrow the exception raised by the earliest candidate, if any, so
+///		that parallel runs report the same error as serial runs.
+///	</summary>
+void ThrowFirstCandidateError(
+	const std::vector< std::pair<int, Exception> > & vecErrors
+) {
+	if (vecErrors.size() == 0) {
+		return;
+	}
+
+	int iFirst = 0;
+	for (int i = 1; i < vecErrors.size(); i++) {
+		if (vecErrors[i].first < vecErrors[iFirst].first) {
+			iFirst = i;
+		}
+	}
+	throw vecErrors[iFirst].second;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		Evaluate a function at all candidates.  Candidates are evaluated in
+///		parallel with OpenMP (serially when verbose output is requested,
+///		since the function may report its progress).  The results do not
+///		depend on the number of threads.
+///	</summary>
+template <typename T, class Function>
+void EvaluateAtCandidates(
+	const std::vector<int> & vecCandidates,
+	const Function & func,
+	std::vector<T> & vecResult
+) {
+	const int nCandidates = static_cast<int>(vecCandidates.size());
+
+	vecResult.resize(nCandidates);
+
+	// Exceptions raised by worker threads, with the candidate raising them
+	std::vector< std::pair<int, Exception> > vecErrors;
+
+#pragma omp parallel for schedule(dynamic, 16) \
+	if (AnnounceGetVerbosityLevel() < 2)
+	for (int i = 0; i < nCandidates; i++) {
+	try {
+		vecResult[i] = func(vecCandidates[i]);
 
+	} catch(Exception & e) {
+#pragma omp critical
+		vecErrors.push_back(std::pair<int, Exception>(i, e));
+	}
+	}
+
+	ThrowFirstCandidateError(vecErrors);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		Remove those candidates for which a criterion does not equal
+///		fKeepValue, given the value of the criterion at each of the
+///		candidates in vecCandidates (in order).  Returns the number of
+///		rejected candidates.
+///	</summary>
+int RemoveCandidates(
+	std::set<int> & setCandidates,
+	const std::vector<int> & vecCandidates,
+	const std::vector<char> & vecCriterion,
+	bool fKeepValue
+) {
+	int nRejected = 0;
+
+	// Rebuild the set of candidates in order
+	setCandidates.clear();
+	for (int i = 0; i < vecCandidates.size(); i++) {
+		if (static_cast<bool>(vecCriterion[i]) == fKeepValue) {
+			setCandidates.insert(setCandidates.end(), vecCandidates[i]);
 		} else {
-			_EXCEPTIONT("Invalid operation");
+			nRejected++;
 		}
+	}
 
-		// Special case: zero distance
-		if (dMaxDist == 0.0) {
+	return nRejected;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		Evaluate a criterion at all candidates and remove those candidates
+///		for which the criterion does not equal fKeepValue.  Returns the
+///		number of rejected candidates.
+///	</summary>
+template <class Criterion>
+int FilterCandidates(
+	std::set<int> & setCandidates,
+	const Criterion & criterion,
+	bool fKeepValue
+) {
+	std::vector<int> vecCandidates(
+		setCandidates.begin(), setCandidates.end());
+
+	std::vector<char> vecCriterion;
+	EvaluateAtCandidates<char>(vecCandidates, criterion, vecCriterion);
+
+	return RemoveCandidates(
+		setCandidates, vecCandidates, vecCriterion, fKeepValue);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		A criterion applied to the candidates (a threshold, closed contour
+///		or no closed contour operation), along with measured statistics of
+///		its cost and selectivity.  Since a candidate must satisfy all
+///		criteria, the order in which they are applied does not affect the
+///		result, but applying cheap and selective criteria first reduces
+///		the number of candidates evaluated by expensive criteria.
+///	</summary>
+class CandidateCriterion {
+
+public:
+	///	<summary>
+	///		Type of criterion.
+	///	</summary>
+	enum Type {
+		Threshold,
+		ClosedContour,
+		NoClosedContour
+	};
+
+public:
+	///	<summary>
+	///		Constructor.
+	///	</summary>
+	CandidateCriterion(
+		Type eType,
+		int ix
+	) :
+		m_eType(eType),
+		m_ix(ix),
+		m_nEvaluated(0),
+		m_nRejected(0),
+		m_dTime(0.0),
+		m_dLoadTime(0.0)
+	{ }
+
+	///	<summary>
+	///		Check if statistics are available for this criterion.
+	///	</summary>
+	bool IsMeasured() const {
+		return (m_nEvaluated != 0);
+	}
+
+	///	<summary>
+	///		Get the measured time per candidate evaluated, in seconds.
+	///	</summary>
+	double GetCostPerCandidate() const {
+		if (m_nEvaluated == 0) {
+			return 0.0;
+		}
+		return m_dTime / static_cast<double>(m_nEvaluated);
+	}
+
+	///	<summary>
+	///		Get the measured fraction of candidates evaluated that were
+	///		rejected.
+	///	</summary>
+	double GetRejectionRate() const {
+		if (m_nEvaluated == 0) {
+			return 0.0;
+		}
+		return static_cast<double>(m_nRejected)
+			/ static_cast<double>(m_nEvaluated);
+	}
+
+	///	<summary>
+	///		Comparator ordering criteria so as to minimize the expected
+	///		cost of applying all criteria, assuming independent rejections.
+	///		This is the order of increasing cost per candidate divided by
+	///		rejection rate.  Criteria that have not rejected any candidates
+	///		follow, and criteria that have not evaluated any candidates are
+	///		placed last; both are equivalent among themselves, so a stable
+	///		sort keeps their original order.
+	///	</summary>
+	static bool LessExpectedCost(
+		const CandidateCriterion & critA,
+		const CandidateCriterion & critB
+	) {
+		int iClassA = critA.GetOrderClass();
+		int iClassB = critB.GetOrderClass();
+		if (iClassA != iClassB) {
+			return (iClassA < iClassB);
+		}
+		if (iClassA != 0) {
 			return false;
 		}
 
-		// Add all neighbors of this point
-		for (int n = 0; n < grid.m_vecConnectivity[ix].size(); n++) {
-			queueNodes.push(grid.m_vecConnectivity[ix][n]);
+		// Both rejection rates are positive
+		return (critA.GetCostPerCandidate() * critB.GetRejectionRate()
+			< critB.GetCostPerCandidate() * critA.GetRejectionRate());
+	}
+
+	///	<summary>
+	///		Get the class of this criterion in LessExpectedCost(): 0 if it
+	///		has rejected candidates, 1 if it has evaluated candidates but
+	///		not rejected any and 2 if it has not evaluated any candidates.
+	///	</summary>
+	int GetOrderClass() const {
+		if (!IsMeasured()) {
+			return 2;
 		}
+		if (m_nRejected == 0) {
+			return 1;
+		}
+		return 0;
 	}
 
-	return false;
-}
+	///	<summary>
+	///		Get a description of this criterion.
+	///	</summary>
+	std::string ToString(
+		VariableRegistry & varreg,
+		const std::vector<ThresholdOp> & vecThresholdOp,
+		const std::vector<ClosedContourOp> & vecClosedContourOp,
+		const std::vector<ClosedContourOp> & vecNoClosedContourOp
+	) const {
+		if (m_eType == Threshold) {
+			return "thresh. "
+				+ varreg.Get(vecThresholdOp[m_ix].m_varix).m_strName;
+		} else if (m_eType == ClosedContour) {
+			return "contour "
+				+ varreg.Get(vecClosedContourOp[m_ix].m_varix).m_strName;
+		} else {
+			return "nocontour "
+				+ varreg.Get(vecNoClosedContourOp[m_ix].m_varix).m_strName;
+		}
+	}
+
+public:
+	///	<summary>
+	///		Type of criterion.
+	///	</summary>
+	Type m_eType;
+
+	///	<summary>
+	///		Index of the operation in the vector of operations of this type.
+	///	</summary>
+	int m_ix;
+
+	///	<summary>
+	///		Number of candidates evaluated.
+	///	</summary>
+	long m_nEvaluated;
+
+	///	<summary>
+	///		Number of candidates rejected.
+	///	</summary>
+	long m_nRejected;
+
+	///	<summary>
+	///		Total time spent applying this criterion to the candidates, in
+	///		seconds.  This excludes loading the data of the criterion.
+	///	</summary>
+	double m_dTime;
+
+	///	<summary>
+	///		Total time spent loading the data of this criterion, in seconds.
+	///		This does not depend on the number of candidates and is not
+	///		part of the cost per candidate.
+	///	</summary>
+	double m_dLoadTime;
+};
 
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -629,6 +985,12 @@ public:
 		nTimeStride(1),
 		fRegional(false),
 		fOutputHeader(false),
+		nStencilCacheMB(0),
+		nReadThreadDepth(0),
+		fLazyEvaluation(false),
+		fTimeParallel(false),
+		nReorderCriteriaTimes(0),
+		strContourEngine("bfs"),
 		iVerbosityLevel(0)
 	{ }
 
@@ -681,6 +1043,24 @@ public:
 	// Output header
 	bool fOutputHeader;
 
+	// Memory budget for the stencil cache (in MB)
+	int nStencilCacheMB;
+
+	// Number of time slices read ahead in a background thread
+	int nReadThreadDepth;
+
+	// Only evaluate operators near candidates
+	bool fLazyEvaluation;
+
+	// Distribute the time slices of each input file among MPI ranks
+	bool fTimeParallel;
+
+	// Number of time slices after which criteria are reordered by cost
+	int nReorderCriteriaTimes;
+
+	// Engine for closed contour criteria (bfs, tree or crosscheck)
+	std::string strContourEngine;
+
 	// Verbosity level
 	int iVerbosityLevel;
 
@@ -688,6 +1068,64 @@ public:
 
 ///////////////////////////////////////////////////////////////////////////////
 
+#if defined(TEMPEST_MPIOMP)
+///	<summary>
+///		Append the output buffered by all ranks other than the root rank to
+///		the output file of the root rank, in rank order.  Since each rank
+///		processes a contiguous block of time slices, the result is in time
+///		order.
+///	</summary>
+void GatherTimeParallelOutput(
+	FILE * fpOutput,
+	int nMPIRank,
+	int nMPISize
+) {
+	const int TagSize = 1;
+	const int TagData = 2;
+
+	// Send buffered output to the root rank
+	if (nMPIRank != 0) {
+		fflush(fpOutput);
+		long lSize = ftell(fpOutput);
+		if (lSize < 0) {
+			_EXCEPTIONT("Unable to determine size of buffered output");
+		}
+		if (lSize > static_cast<long>(INT_MAX)) {
+			_EXCEPTIONT("Buffered output exceeds 2GB");
+		}
+
+		std::vector<char> vecBuffer(lSize);
+		rewind(fpOutput);
+		if (fread(vecBuffer.data(), 1, lSize, fpOutput)
+		    != static_cast<size_t>(lSize)
+		) {
+			_EXCEPTIONT("Unable to read buffered output");
+		}
+
+		int nSize = static_cast<int>(lSize);
+		MPI_Send(&nSize, 1, MPI_INT, 0, TagSize, MPI_COMM_WORLD);
+		MPI_Send(vecBuffer.data(), nSize, MPI_CHAR, 0, TagData, MPI_COMM_WORLD);
+
+	// Receive buffered output from all other ranks in order
+	} else {
+		std::vector<char> vecBuffer;
+		for (int r = 1; r < nMPISize; r++) {
+			int nSize;
+			MPI_Recv(&nSize, 1, MPI_INT, r, TagSize,
+				MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+
+			vecBuffer.resize(nSize);
+			MPI_Recv(vecBuffer.data(), nSize, MPI_CHAR, r, TagData,
+				MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+
+			fwrite(vecBuffer.data(), 1, nSize, fpOutput);
+		}
+	}
+}
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+
 void DetectCyclonesUnstructured(
 	int iFile,
 	const std::string & strInputFiles,
@@ -702,7 +1140,11 @@ void DetectCyclonesUnstructured(
 	}
 
 	AnnounceSetOutputBuffer(param.fpLog);
-	AnnounceOutputOnAllRanks();
+	if (param.fTimeParallel) {
+		AnnounceOnlyOutputOnRankZero();
+	} else {
+		AnnounceOutputOnAllRanks();
+	}
 
 	// Check minimum longitude / latitude
 	if ((param.dMinLongitude < 0.0) || (param.dMinLongitude >= 360.0)) {
@@ -764,6 +1206,49 @@ void DetectCyclonesUnstructured(
 		nLat = grid.m_dLat.GetRows();
 	}
 
+	// Cache of stencils for the fixed distances used by operators
+	RadiusStencilCache * pStencilCache = NULL;
+
+	if (param.nStencilCacheMB > 0) {
+		pStencilCache = new RadiusStencilCache(
+			grid,
+			static_cast<size_t>(param.nStencilCacheMB) * 1024 * 1024);
+
+		for (int tc = 0; tc < vecThresholdOp.size(); tc++) {
+			pStencilCache->RegisterDistance(
+				vecThresholdOp[tc].m_dDistance);
+		}
+		for (int ccc = 0; ccc < vecClosedContourOp.size(); ccc++) {
+			pStencilCache->RegisterDistance(
+				vecClosedContourOp[ccc].m_dMinMaxDist);
+		}
+		for (int ccc = 0; ccc < vecNoClosedContourOp.size(); ccc++) {
+			pStencilCache->RegisterDistance(
+				vecNoClosedContourOp[ccc].m_dMinMaxDist);
+		}
+		for (int outc = 0; outc < vecOutputOp.size(); outc++) {
+			pStencilCache->RegisterDistance(
+				vecOutputOp[outc].m_dDistance);
+		}
+	}
+
+	// Contour tree for closed contour criteria
+	ContourTree * pContourTree = NULL;
+
+	if ((param.strContourEngine != "bfs") &&
+	    ((vecClosedContourOp.size() != 0) ||
+	     (vecNoClosedContourOp.size() != 0))
+	) {
+		pContourTree = new ContourTree(grid);
+
+		if (!pContourTree->IsApplicable()) {
+			Announce("WARNING: Grid connectivity is not symmetric; "
+				"using bfs contour engine");
+			delete pContourTree;
+			pContourTree = NULL;
+		}
+	}
+
 	// Get time dimension
 	NcDim * dimTime = vecFiles[0]->get_dim("time");
 	if (dimTime == NULL) {
@@ -806,14 +1291,54 @@ void DetectCyclonesUnstructured(
 			"Expected \"float\", \"double\" or \"int\"");
 	}
 
-	// Open output file
-	FILE * fpOutput = fopen(strOutputFile.c_str(), "w");
-	if (fpOutput == NULL) {
-		_EXCEPTION1("Could not open output file \"%s\"",
-			strOutputFile.c_str());
+	// Time slices processed by this rank
+	int iTimeBegin = 0;
+	int iTimeEnd = nTime;
+
+	bool fRootRank = true;
+
+#if defined(TEMPEST_MPIOMP)
+	int nMPIRank = 0;
+	int nMPISize = 1;
+
+	if (param.fTimeParallel) {
+		MPI_Comm_rank(MPI_COMM_WORLD, &nMPIRank);
+		MPI_Comm_size(MPI_COMM_WORLD, &nMPISize);
+
+		// Each rank processes a contiguous block of the strided time
+		// slices, so that reads from the input files remain sequential
+		int nStridedTimes =
+			(nTime + param.nTimeStride - 1) / param.nTimeStride;
+
+		int iBlockBegin = static_cast<int>(
+			static_cast<long>(nStridedTimes) * nMPIRank / nMPISize);
+		int iBlockEnd = static_cast<int>(
+			static_cast<long>(nStridedTimes) * (nMPIRank + 1) / nMPISize);
+
+		iTimeBegin = iBlockBegin * param.nTimeStride;
+		iTimeEnd = std::min(nTime, iBlockEnd * param.nTimeStride);
+
+		fRootRank = (nMPIRank == 0);
+	}
+#endif
+
+	// Open output file; with time parallelism only the root rank writes
+	// to the output file and the other ranks buffer their output
+	FILE * fpOutput = NULL;
+	if (fRootRank) {
+		fpOutput = fopen(strOutputFile.c_str(), "w");
+		if (fpOutput == NULL) {
+			_EXCEPTION1("Could not open output file \"%s\"",
+				strOutputFile.c_str());
+		}
+	} else {
+		fpOutput = tmpfile();
+		if (fpOutput == NULL) {
+			_EXCEPTIONT("Could not open temporary output file");
+		}
 	}
 
-	if (param.fOutputHeader) {
+	if (param.fOutputHeader && fRootRank) {
 		fprintf(fpOutput, "#year\tmonth\tday\tcount\thour\n");
 
 		if (grid.m_nGridDim.size() == 1) {
@@ -829,36 +1354,86 @@ void DetectCyclonesUnstructured(
 		fprintf(fpOutput, "\n");
 	}
 
+	// Parse time information
+	NcAtt * attTimeUnits = varTime->get_att("units");
+	if (attTimeUnits == NULL) {
+		_EXCEPTIONT("Variable \"time\" has no \"units\" attribute");
+	}
+
+	std::string strTimeUnits = attTimeUnits->as_string(0);
+
+	Time::CalendarType eCalendarType = Time::CalendarStandard;
+	NcAtt * attTimeCalendar = varTime->get_att("calendar");
+	if (attTimeCalendar != NULL) {
+		eCalendarType = Time::CalendarTypeFromString(attTimeCalendar->as_string(0));
+		if (eCalendarType == Time::CalendarUnknown) {
+			_EXCEPTIONT("Unknown calendar type associated with variable \"time\"");
+		}
+	}
+
+	// Read input data in a background thread
+	AsyncVariableReader reader(
+		varreg, vecFiles, grid, std::max(param.nReadThreadDepth, 1));
+
+	if (param.nReadThreadDepth > 0) {
+		reader.AddVariable(param.ixSearchBy);
+		for (int tc = 0; tc < vecThresholdOp.size(); tc++) {
+			reader.AddVariable(vecThresholdOp[tc].m_varix);
+		}
+		for (int ccc = 0; ccc < vecClosedContourOp.size(); ccc++) {
+			reader.AddVariable(vecClosedContourOp[ccc].m_varix);
+		}
+		for (int ccc = 0; ccc < vecNoClosedContourOp.size(); ccc++) {
+			reader.AddVariable(vecNoClosedContourOp[ccc].m_varix);
+		}
+		for (int outc = 0; outc < vecOutputOp.size(); outc++) {
+			reader.AddVariable(vecOutputOp[outc].m_varix);
+		}
+
+		std::vector<int> vecTimes;
+		for (int t = iTimeBegin; t < iTimeEnd; t += param.nTimeStride) {
+			vecTimes.push_back(t);
+		}
+		reader.Start(vecTimes);
+	}
+
+	// Criteria in the order in which they are applied; initially all
+	// thresholds, then closed contours, then no closed contours
+	std::vector<CandidateCriterion> vecCriteria;
+	for (int tc = 0; tc < vecThresholdOp.size(); tc++) {
+		vecCriteria.push_back(
+			CandidateCriterion(CandidateCriterion::Threshold, tc));
+	}
+	for (int ccc = 0; ccc < vecClosedContourOp.size(); ccc++) {
+		vecCriteria.push_back(
+			CandidateCriterion(CandidateCriterion::ClosedContour, ccc));
+	}
+	for (int ccc = 0; ccc < vecNoClosedContourOp.size(); ccc++) {
+		vecCriteria.push_back(
+			CandidateCriterion(CandidateCriterion::NoClosedContour, ccc));
+	}
+
+	// Number of time slices processed
+	int nTimesProcessed = 0;
+
 	// Loop through all times
-	for (int t = 0; t < nTime; t += param.nTimeStride) {
+	for (int t = iTimeBegin; t < iTimeEnd; t += param.nTimeStride) {
 
 		char szStartBlock[128];
 		sprintf(szStartBlock, "Time %i", t);
 		AnnounceStartBlock(szStartBlock);
 
+		// Wait for input data from the reader thread
+		if (param.nReadThreadDepth > 0) {
+			reader.WaitForTime(t);
+		}
+
 		// Load the data for the search variable
 		Variable & varSearchBy = varreg.Get(param.ixSearchBy);
 		varSearchBy.LoadGridData(varreg, vecFiles, grid, t);
 
 		const DataVector<float> & dataSearch = varSearchBy.GetData();
 
-		// Parse time information
-		NcAtt * attTimeUnits = varTime->get_att("units");
-		if (attTimeUnits == NULL) {
-			_EXCEPTIONT("Variable \"time\" has no \"units\" attribute");
-		}
-
-		std::string strTimeUnits = attTimeUnits->as_string(0);
-
-		Time::CalendarType eCalendarType = Time::CalendarStandard;
-		NcAtt * attTimeCalendar = varTime->get_att("calendar");
-		if (attTimeCalendar != NULL) {
-			eCalendarType = Time::CalendarTypeFromString(attTimeCalendar->as_string(0));
-			if (eCalendarType == Time::CalendarUnknown) {
-				_EXCEPTIONT("Unknown calendar type associated with variable \"time\"");
-			}
-		}
-
 		Time time(eCalendarType);
 		time.FromCFCompliantUnitsOffsetDouble(strTimeUnits, dTime[t]);
 
@@ -954,194 +1529,261 @@ void DetectCyclonesUnstructured(
 				2.0 * sin(0.5 * param.dMergeDist / 180.0 * M_PI);
 
 			// Create a new KD Tree containing all nodes
-			kdtree * kdMerge = kd_create(3);
-
-			std::set<int>::const_iterator iterCandidate
-				= setCandidates.begin();
-			for (; iterCandidate != setCandidates.end(); iterCandidate++) {
-				double dLat = grid.m_dLat[*iterCandidate];
-				double dLon = grid.m_dLon[*iterCandidate];
-
-				double dX = cos(dLon) * cos(dLat);
-				double dY = sin(dLon) * cos(dLat);
-				double dZ = sin(dLat);
-
-				kd_insert3(kdMerge, dX, dY, dZ, (void*)(&(*iterCandidate)));
+			std::vector<int> vecCandidates(
+				setCandidates.begin(), setCandidates.end());
+
+			std::vector<double> vecX(vecCandidates.size());
+			std::vector<double> vecY(vecCandidates.size());
+			std::vector<double> vecZ(vecCandidates.size());
+			for (int i = 0; i < vecCandidates.size(); i++) {
+				double dLat = grid.m_dLat[vecCandidates[i]];
+				double dLon = grid.m_dLon[vecCandidates[i]];
+
+				vecX[i] = cos(dLon) * cos(dLat);
+				vecY[i] = sin(dLon) * cos(dLat);
+				vecZ[i] = sin(dLat);
 			}
 
-			// Loop through all candidates find set of nearest neighbors
-			iterCandidate = setCandidates.begin();
-			for (; iterCandidate != setCandidates.end(); iterCandidate++) {
-				double dLat = grid.m_dLat[*iterCandidate];
-				double dLon = grid.m_dLon[*iterCandidate];
+			SphericalKDTree kdMerge;
+			kdMerge.Build(
+				vecCandidates.size(), vecX.data(), vecY.data(), vecZ.data());
 
-				double dX = cos(dLon) * cos(dLat);
-				double dY = sin(dLon) * cos(dLat);
-				double dZ = sin(dLat);
+			// Find all neighbors of all candidates within dSphDist
+			std::vector<size_t> vecNeighborOffset;
+			std::vector<int> vecNeighborIndex;
+			kdMerge.WithinRadiusBatch(
+				vecCandidates.size(),
+				vecX.data(), vecY.data(), vecZ.data(),
+				dSphDist,
+				vecNeighborOffset,
+				vecNeighborIndex);
 
-				// Find all neighbors within dSphDist
-				kdres * kdresMerge =
-					kd_nearest_range3(kdMerge, dX, dY, dZ, dSphDist);
+			// Loop through all candidates find set of nearest neighbors
+			for (int i = 0; i < vecCandidates.size(); i++) {
+				const int * piNeighbors =
+					vecNeighborIndex.data() + vecNeighborOffset[i];
+				int nNeighbors = static_cast<int>(
+					vecNeighborOffset[i+1] - vecNeighborOffset[i]);
 
-				// Number of neighbors
-				int nNeighbors = kd_res_size(kdresMerge);
 				if (nNeighbors == 0) {
-					setNewCandidates.insert(*iterCandidate);
+					setNewCandidates.insert(vecCandidates[i]);
 
 				} else {
 					double dValue =
-						static_cast<double>(dataSearch[*iterCandidate]);
+						static_cast<double>(dataSearch[vecCandidates[i]]);
 
 					bool fExtrema = true;
-					for (;;) {
-						int * ppr = (int *)(kd_res_item_data(kdresMerge));
+					for (int n = 0; n < nNeighbors; n++) {
+						int ixNeighbor = vecCandidates[piNeighbors[n]];
 
 						if (param.fSearchByMinima) {
-							if (static_cast<double>(dataSearch[*ppr]) < dValue) {
+							if (static_cast<double>(dataSearch[ixNeighbor]) < dValue) {
 								fExtrema = false;
 								break;
 							}
 
 						} else {
-							if (static_cast<double>(dataSearch[*ppr]) > dValue) {
+							if (static_cast<double>(dataSearch[ixNeighbor]) > dValue) {
 								fExtrema = false;
 								break;
 							}
 						}
-
-						int iHasMore = kd_res_next(kdresMerge);
-						if (!iHasMore) {
-							break;
-						}
 					}
 
 					if (fExtrema) {
-						setNewCandidates.insert(*iterCandidate);
+						setNewCandidates.insert(vecCandidates[i]);
 					} else {
 						nRejectedMerge++;
 					}
 				}
-
-				kd_res_free(kdresMerge);
 			}
 
-			// Destroy the KD Tree
-			kd_free(kdMerge);
-
 			// Update set of pressure minima
 			setCandidates = setNewCandidates;
 		}
 
-		// Eliminate based on thresholds
-		for (int tc = 0; tc < vecThresholdOp.size(); tc++) {
+		// Eliminate based on thresholds, closed contours and no closed
+		// contours, in the order of vecCriteria
+		for (int c = 0; c < vecCriteria.size(); c++) {
+			CandidateCriterion & crit = vecCriteria[c];
 
-			std::set<int> setNewCandidates;
+			const int nEvaluated = static_cast<int>(setCandidates.size());
 
-			// Load the search variable data
-			Variable & var = varreg.Get(vecThresholdOp[tc].m_varix);
-			var.LoadGridData(varreg, vecFiles, grid, t);
-			const DataVector<float> & dataState = var.GetData();
+			std::chrono::steady_clock::time_point tpLoad =
+				std::chrono::steady_clock::now();
 
-			// Loop through all pressure minima
-			std::set<int>::const_iterator iterCandidate
-				= setCandidates.begin();
+			// Time at which the data of the criterion has been loaded
+			std::chrono::steady_clock::time_point tpStart;
 
-			for (; iterCandidate != setCandidates.end(); iterCandidate++) {
+			int nRejected = 0;
 
-				// Determine if the threshold is satisfied
-				bool fSatisfiesThreshold =
-					SatisfiesThreshold<float>(
-						grid,
-						dataState,
-						*iterCandidate,
-						vecThresholdOp[tc].m_eOp,
-						vecThresholdOp[tc].m_dValue,
-						vecThresholdOp[tc].m_dDistance
-					);
-
-				// If not rejected, add to new pressure minima array
-				if (fSatisfiesThreshold) {
-					setNewCandidates.insert(*iterCandidate);
-				} else {
-					vecRejectedThreshold[tc]++;
-				}
-			}
+			// Threshold
+			if (crit.m_eType == CandidateCriterion::Threshold) {
+				const ThresholdOp & op = vecThresholdOp[crit.m_ix];
 
-			setCandidates = setNewCandidates;
-		}
+				// Load the search variable data
+				Variable & var = varreg.Get(op.m_varix);
+				LoadGridDataNearCandidates(
+					var, varreg, vecFiles, grid, t,
+					setCandidates,
+					op.m_dDistance,
+					param.fLazyEvaluation);
+				const DataVector<float> & dataState = var.GetData();
 
-		// Eliminate based on closed contours
-		for (int ccc = 0; ccc < vecClosedContourOp.size(); ccc++) {
-			std::set<int> setNewCandidates;
+				tpStart = std::chrono::steady_clock::now();
 
-			// Load the search variable data
-			Variable & var = varreg.Get(vecClosedContourOp[ccc].m_varix);
-			var.LoadGridData(varreg, vecFiles, grid, t);
-			const DataVector<float> & dataState = var.GetData();
+				// Loop through all pressure minima
+				nRejected = FilterCandidates(
+					setCandidates,
+					[&](int ix) {
+						return SatisfiesThreshold<float>(
+							grid,
+							dataState,
+							ix,
+							op.m_eOp,
+							op.m_dValue,
+							op.m_dDistance,
+							pStencilCache);
+					},
+					true);
+
+				vecRejectedThreshold[crit.m_ix] += nRejected;
+
+			// Closed contour or no closed contour
+			} else {
+				const bool fNoClosedContour =
+					(crit.m_eType == CandidateCriterion::NoClosedContour);
+
+				const ClosedContourOp & op =
+					(fNoClosedContour)?
+						(vecNoClosedContourOp[crit.m_ix]):
+						(vecClosedContourOp[crit.m_ix]);
+
+				// Load the search variable data
+				Variable & var = varreg.Get(op.m_varix);
+				LoadGridDataNearCandidates(
+					var, varreg, vecFiles, grid, t,
+					setCandidates,
+					op.m_dMinMaxDist + op.m_dDistance,
+					param.fLazyEvaluation);
+				const DataVector<float> & dataState = var.GetData();
+
+				tpStart = std::chrono::steady_clock::now();
+
+				// Determine if there is a closed contour about each
+				// candidate, with a flood fill from each candidate
+				std::vector<int> vecCandidates(
+					setCandidates.begin(), setCandidates.end());
+
+				std::vector<char> vecHasClosedContour;
+
+				if ((pContourTree == NULL) ||
+				    (param.strContourEngine == "crosscheck")
+				) {
+					EvaluateAtCandidates<char>(
+						vecCandidates,
+						[&](int ix) {
+							return HasClosedContour<float>(
+								grid,
+								dataState,
+								ix,
+								op.m_dDeltaAmount,
+								op.m_dDistance,
+								op.m_dMinMaxDist,
+								pStencilCache);
+						},
+						vecHasClosedContour);
+				}
 
-			// Loop through all pressure minima
-			std::set<int>::const_iterator iterCandidate
-				= setCandidates.begin();
+				// or with a single sweep through the contour tree
+				if (pContourTree != NULL) {
+					std::vector<int> vecOrigins;
+					EvaluateAtCandidates<int>(
+						vecCandidates,
+						[&](int ix) {
+							return FindClosedContourOrigin<float>(
+								grid,
+								dataState,
+								ix,
+								op.m_dDeltaAmount,
+								op.m_dMinMaxDist,
+								pStencilCache);
+						},
+						vecOrigins);
+
+					std::vector<char> vecTreeHasClosedContour;
+					pContourTree->FindClosedContours(
+						dataState,
+						vecOrigins,
+						op.m_dDeltaAmount,
+						op.m_dDistance,
+						vecTreeHasClosedContour);
+
+					// Verify both engines agree
+					if (param.strContourEngine == "crosscheck") {
+						for (int i = 0; i < vecCandidates.size(); i++) {
+							if (static_cast<bool>(vecHasClosedContour[i])
+							    != static_cast<bool>(vecTreeHasClosedContour[i])
+							) {
+								int ix = vecCandidates[i];
+								_EXCEPTION5("Contour engines disagree at "
+									"candidate %i (%1.5f, %1.5f): "
+									"bfs %i, tree %i",
+									ix,
+									grid.m_dLon[ix] * 180.0 / M_PI,
+									grid.m_dLat[ix] * 180.0 / M_PI,
+									static_cast<int>(vecHasClosedContour[i] != 0),
+									static_cast<int>(vecTreeHasClosedContour[i] != 0));
+							}
+						}
+					}
 
-			for (; iterCandidate != setCandidates.end(); iterCandidate++) {
+					vecHasClosedContour.swap(vecTreeHasClosedContour);
+				}
 
-				// Determine if a closed contour is present
-				bool fHasClosedContour =
-					HasClosedContour<float>(
-						grid,
-						dataState,
-						*iterCandidate,
-						vecClosedContourOp[ccc].m_dDeltaAmount,
-						vecClosedContourOp[ccc].m_dDistance,
-						vecClosedContourOp[ccc].m_dMinMaxDist
-					);
-
-				// If not rejected, add to new pressure minima array
-				if (fHasClosedContour) {
-					setNewCandidates.insert(*iterCandidate);
+				// Reject candidates without a closed contour, or with a
+				// closed contour for no closed contour criteria
+				nRejected = RemoveCandidates(
+					setCandidates,
+					vecCandidates,
+					vecHasClosedContour,
+					!fNoClosedContour);
+
+				if (fNoClosedContour) {
+					vecRejectedNoClosedContour[crit.m_ix] += nRejected;
 				} else {
-					vecRejectedClosedContour[ccc]++;
+					vecRejectedClosedContour[crit.m_ix] += nRejected;
 				}
 			}
 
-			setCandidates = setNewCandidates;
+			// Update statistics of this criterion
+			crit.m_nEvaluated += nEvaluated;
+			crit.m_nRejected += nRejected;
+			crit.m_dTime +=
+				std::chrono::duration<double>(
+					std::chrono::steady_clock::now() - tpStart).count();
+			crit.m_dLoadTime +=
+				std::chrono::duration<double>(tpStart - tpLoad).count();
 		}
 
-		// Eliminate based on no closed contours
-		for (int ccc = 0; ccc < vecNoClosedContourOp.size(); ccc++) {
-			std::set<int> setNewCandidates;
-
-			// Load the search variable data
-			Variable & var = varreg.Get(vecNoClosedContourOp[ccc].m_varix);
-			var.LoadGridData(varreg, vecFiles, grid, t);
-			const DataVector<float> & dataState = var.GetData();
-
-			// Loop through all pressure minima
-			std::set<int>::const_iterator iterCandidate
-				= setCandidates.begin();
-
-			for (; iterCandidate != setCandidates.end(); iterCandidate++) {
-
-				// Determine if a closed contour is present
-				bool fHasClosedContour =
-					HasClosedContour<float>(
-						grid,
-						dataState,
-						*iterCandidate,
-						vecNoClosedContourOp[ccc].m_dDeltaAmount,
-						vecNoClosedContourOp[ccc].m_dDistance,
-						vecNoClosedContourOp[ccc].m_dMinMaxDist
-					);
-
-				// If a closed contour is present, reject this candidate
-				if (fHasClosedContour) {
-					vecRejectedNoClosedContour[ccc]++;
-				} else {
-					setNewCandidates.insert(*iterCandidate);
-				}
+		// Reorder criteria by expected cost once statistics are available
+		nTimesProcessed++;
+		if (nTimesProcessed == param.nReorderCriteriaTimes) {
+			std::stable_sort(
+				vecCriteria.begin(),
+				vecCriteria.end(),
+				CandidateCriterion::LessExpectedCost);
+
+			AnnounceStartBlock("Reordered criteria");
+			for (int c = 0; c < vecCriteria.size(); c++) {
+				Announce("%i: %s", c,
+					vecCriteria[c].ToString(
+						varreg,
+						vecThresholdOp,
+						vecClosedContourOp,
+						vecNoClosedContourOp).c_str());
 			}
-
-			setCandidates = setNewCandidates;
+			AnnounceEndBlock("Done");
 		}
 
 		Announce("Total candidates: %i", setCandidates.size());
@@ -1200,25 +1842,44 @@ void DetectCyclonesUnstructured(
 			}
 
 			//DataMatrix<float> dOutput(setCandidates.size(), vecOutputOp.size());
+			std::vector<int> vecCandidates(
+				setCandidates.begin(), setCandidates.end());
+
 			for (int outc = 0; outc < vecOutputOp.size(); outc++) {
 
+				// Load the output variable data
+				Variable & var = varreg.Get(vecOutputOp[outc].m_varix);
+				LoadGridDataNearCandidates(
+					var, varreg, vecFiles, grid, t,
+					setCandidates,
+					vecOutputOp[outc].m_dDistance,
+					param.fLazyEvaluation);
+				const DataVector<float> & dataState = var.GetData();
+
 				// Loop through all pressure minima
-				std::set<int>::const_iterator iterCandidate
-					= setCandidates.begin();
+				const int nCandidates = static_cast<int>(vecCandidates.size());
+
+				std::vector< std::pair<int, Exception> > vecErrors;
 
-				iCandidateIx = 0;
-				for (; iterCandidate != setCandidates.end(); iterCandidate++) {
+#pragma omp parallel for schedule(dynamic, 16) \
+	if (AnnounceGetVerbosityLevel() < 2)
+				for (int i = 0; i < nCandidates; i++) {
+				try {
 					ApplyOutputOp<float>(
 						vecOutputOp[outc],
 						grid,
-						varreg,
-						vecFiles,
-						t,
-						*iterCandidate,
-						vecOutputValue[iCandidateIx][outc]);
+						dataState,
+						vecCandidates[i],
+						vecOutputValue[i][outc],
+						pStencilCache);
 
-					iCandidateIx++;
+				} catch(Exception & e) {
+#pragma omp critical
+					vecErrors.push_back(std::pair<int, Exception>(i, e));
+				}
 				}
+
+				ThrowFirstCandidateError(vecErrors);
 			}
 
 			// Output all candidates
@@ -1253,8 +1914,52 @@ void DetectCyclonesUnstructured(
 		AnnounceEndBlock("Done");
 	}
 
+	// Report statistics of all criteria
+	if (param.nReorderCriteriaTimes > 0) {
+		AnnounceStartBlock("Criteria statistics");
+		for (int c = 0; c < vecCriteria.size(); c++) {
+			const CandidateCriterion & crit = vecCriteria[c];
+
+			Announce("%s: evaluated %li, rejected %li (%1.1f%%), "
+				"%1.3f s (%1.3e s per candidate), "
+				"load %1.3f s (%1.3e s per time slice)",
+				crit.ToString(
+					varreg,
+					vecThresholdOp,
+					vecClosedContourOp,
+					vecNoClosedContourOp).c_str(),
+				crit.m_nEvaluated,
+				crit.m_nRejected,
+				100.0 * crit.GetRejectionRate(),
+				crit.m_dTime,
+				crit.GetCostPerCandidate(),
+				crit.m_dLoadTime,
+				crit.m_dLoadTime
+					/ static_cast<double>(std::max(nTimesProcessed, 1)));
+		}
+		AnnounceEndBlock("Done");
+	}
+
+#if defined(TEMPEST_MPIOMP)
+	// Append the output of all other ranks in time order
+	if (param.fTimeParallel) {
+		GatherTimeParallelOutput(fpOutput, nMPIRank, nMPISize);
+	}
+#endif
+
 	fclose(fpOutput);
 
+	if (pStencilCache != NULL) {
+		Announce("Stencil cache used %1.1f MB",
+			static_cast<double>(pStencilCache->GetMemoryUsed())
+				/ (1024.0 * 1024.0));
+		delete pStencilCache;
+	}
+
+	if (pContourTree != NULL) {
+		delete pContourTree;
+	}
+
 	// Reset the Announce buffer
 	AnnounceSetOutputBuffer(stdout);
 	AnnounceOnlyOutputOnRankZero();
@@ -1312,6 +2017,12 @@ try {
 	// Output commands
 	std::string strOutputCmd;
 
+	// Number of time slices to read at once
+	int nReadAhead;
+
+	// Memory used for time slices read ahead (in MB)
+	int nReadAheadMB;
+
 	// Parse the command line
 	BeginCommandLine()
 		CommandLineString(strInputFile, "in_data", "");
@@ -1334,6 +2045,14 @@ try {
 		CommandLineInt(dcuparam.nTimeStride, "timestride", 1);
 		CommandLineBool(dcuparam.fRegional, "regional");
 		CommandLineBool(dcuparam.fOutputHeader, "out_header");
+		CommandLineInt(dcuparam.nStencilCacheMB, "stencil_cache_mb", 0);
+		CommandLineInt(dcuparam.nReadThreadDepth, "readthread_depth", 0);
+		CommandLineBool(dcuparam.fLazyEvaluation, "lazy_eval");
+		CommandLineBool(dcuparam.fTimeParallel, "time_parallel");
+		CommandLineInt(dcuparam.nReorderCriteriaTimes, "reorder_criteria", 0);
+		CommandLineStringD(dcuparam.strContourEngine, "contour_engine", "bfs", "[bfs|tree|crosscheck]");
+		CommandLineInt(nReadAhead, "readahead", 1);
+		CommandLineInt(nReadAheadMB, "readahead_mb", 1024);
 		CommandLineInt(dcuparam.iVerbosityLevel, "verbosity", 0);
 
 		ParseCommandLine(argc, argv);
@@ -1344,9 +2063,30 @@ try {
 	// Create Variable registry
 	VariableRegistry varreg;
 
+	// Read ahead multiple time slices
+	if (nReadAhead < 1) {
+		_EXCEPTIONT("--readahead must be at least 1");
+	}
+	if (nReadAheadMB < 0) {
+		_EXCEPTIONT("--readahead_mb must be nonnegative");
+	}
+
+	varreg.SetTimeSlabSize(
+		nReadAhead,
+		static_cast<size_t>(nReadAheadMB) * 1024 * 1024);
+
 	// Set verbosity level
 	AnnounceSetVerbosityLevel(dcuparam.iVerbosityLevel);
 
+	// Check contour engine
+	if ((dcuparam.strContourEngine != "bfs") &&
+	    (dcuparam.strContourEngine != "tree") &&
+	    (dcuparam.strContourEngine != "crosscheck")
+	) {
+		_EXCEPTIONT("--contour_engine must be one of \"bfs\", \"tree\""
+			" or \"crosscheck\"");
+	}
+
 	// Check input
 	if ((strInputFile.length() == 0) && (strInputFileList.length() == 0)) {
 		_EXCEPTIONT("No input data file (--in_data) or (--in_data_list)"
@@ -1592,12 +2332,9 @@ try {
 	dcuparam.dMinLongitude *= M_PI / 180.0;
 
 #if defined(TEMPEST_MPIOMP)
-	// Spread files across nodes
+	// Rank of this process
 	int nMPIRank;
 	MPI_Comm_rank(MPI_COMM_WORLD, &nMPIRank);
-
-	int nMPISize;
-	MPI_Comm_size(MPI_COMM_WORLD, &nMPISize);
 #endif
 
 	AnnounceStartBlock("Begin search operation");
@@ -1613,13 +2350,24 @@ try {
 		Announce("Logs will be written to logXXXXXX.txt");
 	}
 
+	// Distribute files among ranks on demand; with time parallelism all
+	// ranks process every file
+	MPIFileScheduler scheduler(vecInputFiles);
+
 	// Loop over all files to be processed
-	for (int f = 0; f < vecInputFiles.size(); f++) {
-#if defined(TEMPEST_MPIOMP)
-		if (f % nMPISize != nMPIRank) {
-			continue;
+	int iNextFile = 0;
+	for (;;) {
+		int f;
+		if (dcuparam.fTimeParallel) {
+			if (iNextFile == vecInputFiles.size()) {
+				break;
+			}
+			f = iNextFile++;
+
+		} else if (!scheduler.Next(f)) {
+			break;
 		}
-#endif
+
 		// Generate output file name
 		std::string strOutputFile;
 		if (vecInputFiles.size() == 1) {
@@ -1648,7 +2396,19 @@ try {
 			}
 
 			std::string strLogFile = "log" + std::string(szFileIndex) + ".txt";
-			dcuparam.fpLog = fopen(strLogFile.c_str(), "w");
+
+			// With time parallelism only the root rank writes the log
+			bool fWriteLog = true;
+#if defined(TEMPEST_MPIOMP)
+			if (dcuparam.fTimeParallel && (nMPIRank != 0)) {
+				fWriteLog = false;
+			}
+#endif
+			if (fWriteLog) {
+				dcuparam.fpLog = fopen(strLogFile.c_str(), "w");
+			} else {
+				dcuparam.fpLog = stdout;
+			}
 		}
 
 		// Perform DetectCyclonesUnstructured
@@ -1661,17 +2421,39 @@ try {
 			dcuparam);
 
 		// Close the log file
-		if (vecInputFiles.size() != 1) {
+		if (dcuparam.fpLog != stdout) {
 			fclose(dcuparam.fpLog);
 		}
 	}
 
 	AnnounceEndBlock("Done");
 
+	if (!dcuparam.fTimeParallel) {
+		scheduler.Summarize();
+	}
+	scheduler.Free();
+
 	AnnounceBanner();
 
 } catch(Exception & e) {
 	Announce(e.ToString().c_str());
+
+#if defined(TEMPEST_MPIOMP)
+	// Other ranks may be waiting for this rank in a collective operation
+	// or for its output
+	int nMPISize;
+	MPI_Comm_size(MPI_COMM_WORLD, &nMPISize);
+	if (nMPISize > 1) {
+		// Announce may be restricted to rank 0, so report the error
+		// of this rank before aborting
+		int nMPIRank;
+		MPI_Comm_rank(MPI_COMM_WORLD, &nMPIRank);
+		fprintf(stderr, "[rank %i] %s\n", nMPIRank, e.ToString().c_str());
+
+		fflush(NULL);
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	}
+#endif
 }
 
 #if defined(TEMPEST_MPIOMP)
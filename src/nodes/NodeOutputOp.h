@@ -158,24 +158,23 @@ public:
 
 ///////////////////////////////////////////////////////////////////////////////
 
+///	<summary>
+///		Apply the output operator at the given candidate.  The data of the
+///		output variable must be loaded on all nodes within the operator
+///		distance of the candidate.
+///	</summary>
 template <typename real>
 void ApplyOutputOp(
 	const OutputOp & op,
 	const SimpleGrid & grid,
-	VariableRegistry & varreg,
-	NcFileVector & vecFiles,
-	int ixTime,
+	const DataVector<float> & dataState,
 	int ixCandidate,
-	std::string & strResult
+	std::string & strResult,
+	RadiusStencilCache * pStencilCache = NULL
 ) {
 	static const char * szFormat = "%3.6e";
 	char buf[100];
 
-	// Load the search variable data
-	Variable & var = varreg.Get(op.m_varix);
-	var.LoadGridData(varreg, vecFiles, grid, ixTime);
-	const DataVector<float> & dataState = var.GetData();
-
 	// Return values from the output operators
 	int ixExtremum;
 	float dValue;
@@ -190,7 +189,8 @@ void ApplyOutputOp(
 			op.m_dDistance,
 			ixExtremum,
 			dValue,
-			dRMax);
+			dRMax,
+			pStencilCache);
 
 		sprintf(buf, szFormat, dValue);
 		strResult = buf;
@@ -204,7 +204,8 @@ void ApplyOutputOp(
 			op.m_dDistance,
 			ixExtremum,
 			dValue,
-			dRMax);
+			dRMax,
+			pStencilCache);
 
 		sprintf(buf, szFormat, dRMax);
 		strResult = buf;
@@ -218,7 +219,8 @@ void ApplyOutputOp(
 			op.m_dDistance,
 			ixExtremum,
 			dValue,
-			dRMax);
+			dRMax,
+			pStencilCache);
 
 		sprintf(buf, szFormat, dValue);
 		strResult = buf;
@@ -232,7 +234,8 @@ void ApplyOutputOp(
 			op.m_dDistance,
 			ixExtremum,
 			dValue,
-			dRMax);
+			dRMax,
+			pStencilCache);
 
 		sprintf(buf, szFormat, dRMax);
 		strResult = buf;
@@ -243,7 +246,8 @@ void ApplyOutputOp(
 			dataState,
 			ixCandidate,
 			op.m_dDistance,
-			dValue);
+			dValue,
+			pStencilCache);
 
 		sprintf(buf, szFormat, dValue);
 		strResult = buf;
@@ -18,7 +18,7 @@
 #include "Exception.h"
 #include "Announce.h"
 
-#include "kdtree.h"
+#include "SphericalKDTree.h"
 
 #include <cstdlib>
 #include <cstdio>
@@ -704,29 +704,31 @@ try {
 	// Create kdtree at each time
 	AnnounceStartBlock("Creating KD trees at each time level");
 
-	// Null pointer
-	int * noptr = NULL;
-
 	// Vector of lat/lon values
 	std::vector< std::vector<Node> > vecNodes;
 	vecNodes.resize(vecTimes.size());
 
 	// Vector of KD trees
-	std::vector<kdtree *> vecKDTrees;
+	std::vector<SphericalKDTree> vecKDTrees;
 	vecKDTrees.resize(vecTimes.size());
 
+	std::vector<double> vecX;
+	std::vector<double> vecY;
+	std::vector<double> vecZ;
+
 	for (int t = 0; t < vecTimes.size(); t++) {
 
 		// Create a new kdtree
 		if (vecCandidates[t].size() == 0) {
-			vecKDTrees[t] = NULL;
 			continue;
 		}
 
-		vecKDTrees[t] = kd_create(3);
-
 		vecNodes[t].resize(vecCandidates[t].size());
 
+		vecX.resize(vecCandidates[t].size());
+		vecY.resize(vecCandidates[t].size());
+		vecZ.resize(vecCandidates[t].size());
+
 		// Insert all points at this time level
 		for (int i = 0; i < vecCandidates[t].size(); i++) {
 			double dLat = atof(vecCandidates[t][i][iLatIndex].c_str());
@@ -746,8 +748,14 @@ try {
 			vecNodes[t][i].y = dY;
 			vecNodes[t][i].z = dZ;
 
-			kd_insert3(vecKDTrees[t], dX, dY, dZ, reinterpret_cast<void*>(noptr+i));
+			vecX[i] = dX;
+			vecY[i] = dY;
+			vecZ[i] = dZ;
 		}
+
+		vecKDTrees[t].Build(
+			vecCandidates[t].size(),
+			vecX.data(), vecY.data(), vecZ.data());
 	}
 
 	AnnounceEndBlock("Done");
@@ -758,16 +766,38 @@ try {
 	std::vector<PathSegmentSet> vecPathSegmentsSet;
 	vecPathSegmentsSet.resize(vecTimes.size()-1);
 
+	// Nearest node at each later time level, in CSR form
+	std::vector< std::vector<int> > vecNearestOffset(nMaxGapSize+2);
+	std::vector< std::vector<int> > vecNearestIndex(nMaxGapSize+2);
+
 	// Insert nodes from this time level
 	for (int t = 0; t < vecTimes.size()-1; t++) {
 
+		// Find nearest nodes at all later time levels in one batch each
+		int nNodes = vecCandidates[t].size();
+
+		vecX.resize(nNodes);
+		vecY.resize(nNodes);
+		vecZ.resize(nNodes);
+		for (int i = 0; i < nNodes; i++) {
+			vecX[i] = vecNodes[t][i].x;
+			vecY[i] = vecNodes[t][i].y;
+			vecZ[i] = vecNodes[t][i].z;
+		}
+
+		for (int g = 1; g <= nMaxGapSize+1; g++) {
+			if (t+g >= vecTimes.size()) {
+				break;
+			}
+			vecKDTrees[t+g].NearestKBatch(
+				nNodes, vecX.data(), vecY.data(), vecZ.data(), 1,
+				vecNearestOffset[g],
+				vecNearestIndex[g]);
+		}
+
 		// Loop through all points at the current time level
 		for (int i = 0; i < vecCandidates[t].size(); i++) {
 
-			double dX = vecNodes[t][i].x;
-			double dY = vecNodes[t][i].y;
-			double dZ = vecNodes[t][i].z;
-
 			double dLat = vecNodes[t][i].lat;
 			double dLon = vecNodes[t][i].lon;
 
@@ -776,22 +806,11 @@ try {
 					break;
 				}
 
-				if (vecKDTrees[t+g] == NULL) {
+				if (vecKDTrees[t+g].GetSize() == 0) {
 					continue;
 				}
 
-				kdres * set = kd_nearest3(vecKDTrees[t+g], dX, dY, dZ);
-
-				if (kd_res_size(set) == 0) {
-					kd_res_free(set);
-					break;
-				}
-
-				int iRes =
-					  reinterpret_cast<int*>(kd_res_item_data(set))
-					- reinterpret_cast<int*>(noptr);
-
-				kd_res_free(set);
+				int iRes = vecNearestIndex[g][vecNearestOffset[g][i]];
 
 				// Great circle distance between points
 				double dLonC = vecNodes[t+g][iRes].lon;
@@ -1080,7 +1099,7 @@ try {
 	AnnounceStartBlock("Cleanup");
 
 	for (int t = 0; t < vecKDTrees.size(); t++) {
-		kd_free(vecKDTrees[t]);
+		vecKDTrees[t].Clear();
 	}
 
 	AnnounceEndBlock("Done");